@@ -0,0 +1,72 @@
+#-------------------------------------------------
+#
+# End to end download benchmark. Runs ThreadDownloadEngines
+# against an in-process mock board server and reports
+# images/s, MB/s, latency percentiles, peak RSS and the
+# heap use per completed request. With --decode it runs
+# the HTML entity decoder microbenchmark instead.
+#
+#-------------------------------------------------
+
+QT += core network
+QT -= gui widgets
+
+# Next to the console, so the PluginManager finds the plugins directory
+win32:TARGET = ../../fourchan-dl-bench
+else:TARGET = ../fourchan-dl-bench
+
+TEMPLATE = app
+CONFIG   += console
+CONFIG   -= app_bundle
+
+SOURCES += main.cpp \
+    mockboardserver.cpp \
+    enginebench.cpp \
+    heapstats.cpp \
+    decodebench.cpp \
+    ../gui/supervisednetworkreply.cpp \
+    ../gui/requesthandler.cpp \
+    ../gui/pluginmanager.cpp \
+    ../gui/downloadrequest.cpp \
+    ../gui/downloadmanager.cpp \
+    ../gui/blacklist.cpp \
+    ../gui/networkaccessmanager.cpp \
+    ../gui/folderindex.cpp \
+    ../gui/parsermetrics.cpp \
+    ../gui/boardwatchengine.cpp \
+    ../gui/downloadworker.cpp \
+    ../gui/threaddownloadengine.cpp \
+    ../gui/HtmlEntities.cpp \
+    ../gui/appsettings.cpp \
+    ../gui/downloadmetrics.cpp \
+    ../gui/settingssnapshot.cpp
+
+include(../gui/QsLog.pri)
+
+# GetProcessMemoryInfo() for the peak RSS
+win32: LIBS += -lpsapi
+
+HEADERS += \
+    mockboardserver.h \
+    enginebench.h \
+    heapstats.h \
+    decodebench.h \
+    ../gui/supervisednetworkreply.h \
+    ../gui/structs.h \
+    ../gui/requesthandler.h \
+    ../gui/pluginmanager.h \
+    ../gui/ParserPluginInterface.h \
+    ../gui/downloadrequest.h \
+    ../gui/downloadmanager.h \
+    ../gui/defines.h \
+    ../gui/blacklist.h \
+    ../gui/networkaccessmanager.h \
+    ../gui/folderindex.h \
+    ../gui/parsermetrics.h \
+    ../gui/boardwatchengine.h \
+    ../gui/downloadworker.h \
+    ../gui/threaddownloadengine.h \
+    ../gui/HtmlEntities.h \
+    ../gui/appsettings.h \
+    ../gui/downloadmetrics.h \
+    ../gui/settingssnapshot.h
@@ -0,0 +1,170 @@
+#include "decodebench.h"
+
+#include <QElapsedTimer>
+#include <QRegExp>
+#include <QTextStream>
+#include <QtDebug>
+
+#include <functional>
+
+#include "HtmlEntities.h"
+#include "heapstats.h"
+
+DecodeBench::DecodeBench(int iterations) :
+    iterations(iterations)
+{
+    comments = makeComments(200);
+}
+
+static void discardMessage(QtMsgType, const QMessageLogContext&, const QString&) {
+}
+
+void DecodeBench::run() {
+    QTextStream out(stdout);
+    QtMessageHandler previousHandler;
+    qint64 characters;
+    int differing;
+
+    struct Decoder {
+        const char* name;
+        std::function<void(QString*)> decode;
+    };
+    const Decoder decoders[] = {
+        { "decodeStr", HTML::decodeStr },
+        { "regex (old)", legacyDecodeStr }
+    };
+
+    characters = 0;
+    differing = 0;
+    foreach (const QString& comment, comments) {
+        QString a(comment);
+        QString b(comment);
+
+        characters += comment.size();
+        HTML::decodeStr(&a);
+        legacyDecodeStr(&b);
+        if (a != b)
+            differing++;
+    }
+
+    out << QString("%1 comments, %2 characters on average, %3 passes\n")
+           .arg(comments.count())
+           .arg(characters / comments.count())
+           .arg(iterations);
+    out << QString("%1 %2 %3 %4\n")
+           .arg("decoder", -12)
+           .arg("ns/comment", 12)
+           .arg("Mchar/s", 10)
+           .arg("allocs/comment", 15);
+
+    previousHandler = qInstallMessageHandler(discardMessage);
+    for (const Decoder& decoder : decoders) {
+        QElapsedTimer timer;
+        HeapStats before, after;
+        qint64 ns, decoded;
+
+        before = heapStats();
+        timer.start();
+        for (int i=0; i<iterations; i++) {
+            foreach (const QString& comment, comments) {
+                QString str(comment);
+
+                decoder.decode(&str);
+            }
+        }
+        ns = timer.nsecsElapsed();
+        after = heapStats();
+
+        decoded = (qint64)iterations * comments.count();
+        out << QString("%1 %2 %3 %4\n")
+               .arg(decoder.name, -12)
+               .arg((double)ns / decoded, 12, 'f', 0)
+               .arg(ns > 0 ? characters * 1000.0 * iterations / ns : 0.0, 10, 'f', 1)
+               .arg((double)(after.allocations - before.allocations) / decoded, 15, 'f', 2);
+        out.flush();
+    }
+    qInstallMessageHandler(previousHandler);
+
+    if (differing > 0)
+        out << differing << " of " << comments.count() << " comments decode differently, the old decoder has no &#x..; and cuts code points above U+FFFF\n";
+}
+
+/*
+ * Comments the way the 4chan API delivers them: quote links, greentext,
+ * apostrophes and quotes as entities, now and then a plain line without any.
+ */
+QStringList DecodeBench::makeComments(int count) {
+    const char* const fragments[] = {
+        "<a href=\"#p%1\" class=\"quotelink\">&gt;&gt;%1</a><br>",
+        "<span class=\"quote\">&gt;be me</span><br>",
+        "<span class=\"quote\">&gt;tfw no &quot;source&quot;</span><br>",
+        "I don&#039;t think that&#039;s how it works",
+        "Tom &amp; Jerry &amp; friends<br>",
+        "anyone got the sauce? it&#039;s for a friend<br>",
+        "&quot;Nice&quot; thread, OP. Saved &hellip; all of it<br>",
+        "Prices went from &pound;5 to &euro;10 &mdash; again<br>",
+        "caf&eacute; na&iuml;ve r&eacute;sum&eacute;<br>",
+        "just a normal line without anything special in it<br>",
+        "<wbr>https://example.org/some/long/path?with=query&amp;and=more<br>",
+        "&#x1F600; &#128512; &lt;3<br>"
+    };
+    const int fragmentCount = sizeof(fragments) / sizeof(fragments[0]);
+    QStringList ret;
+    uint seed;
+
+    seed = 1;
+    for (int i=0; i<count; i++) {
+        QString comment;
+        int parts;
+
+        seed = seed * 1103515245 + 12345;
+        parts = 2 + (seed >> 16) % 8;
+        for (int j=0; j<parts; j++) {
+            QString fragment;
+
+            seed = seed * 1103515245 + 12345;
+            fragment = fragments[(seed >> 16) % fragmentCount];
+            if (fragment.contains("%1"))
+                fragment = fragment.arg(40000000 + i * 7 + j);
+            comment += fragment;
+        }
+        ret << comment;
+    }
+
+    return ret;
+}
+
+// HTML::decodeStr() before the single pass decoder, unchanged
+void DecodeBench::legacyDecodeStr(QString* str)
+{
+    int index = 0;
+    QChar decodedChar;
+    QStringList res;
+    QRegExp entityParser("(&([a-zA-Z]+);)",Qt::CaseInsensitive);
+    QRegExp directCharParser("(&#([0-9]+);)",Qt::CaseInsensitive);
+
+
+    qDebug() << "Checking" << *str;
+    while (index > -1) {
+        index = directCharParser.indexIn(*str,index+1);
+        res = directCharParser.capturedTexts();
+        if (index != -1) {
+            decodedChar = QChar(directCharParser.cap(2).toInt());
+            str->replace(res.at(1), decodedChar);
+            qDebug() << *str;
+        }
+    }
+
+    index = 0;
+    while((index = entityParser.indexIn(*str,index)) != -1)
+    {
+        index++;
+        decodedChar = HTML::resolveEntity(entityParser.cap(2));
+        qDebug() << "Decoding in " << entityParser.cap(1) << ":" << entityParser.cap(2) << " to " << decodedChar << "(" << decodedChar.isNull()<<")";
+        if (!decodedChar.isNull()) {
+            qDebug() << "Replacing in " << entityParser.cap(1) << ":" << entityParser.cap(2) << " to " << decodedChar;
+            str->replace(entityParser.cap(1),QString(decodedChar));
+        }
+    }
+
+}
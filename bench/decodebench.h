@@ -0,0 +1,30 @@
+#ifndef DECODEBENCH_H
+#define DECODEBENCH_H
+
+#include <QString>
+#include <QStringList>
+
+/**
+ * Runs HTML::decodeStr() and the regex based decoder it replaced over
+ * generated 4chan style comments and reports the throughput and the heap
+ * allocations per comment of both.
+ *
+ * The old decoder logs with qDebug() on every match. Its messages are
+ * formatted as before but discarded, so the console stays readable.
+ */
+class DecodeBench
+{
+public:
+    explicit DecodeBench(int iterations);
+
+    void run();
+
+private:
+    int iterations;
+    QStringList comments;
+
+    static QStringList makeComments(int count);
+    static void legacyDecodeStr(QString* str);
+};
+
+#endif // DECODEBENCH_H
@@ -0,0 +1,168 @@
+#include "enginebench.h"
+
+#include <QDir>
+#include <QNetworkProxy>
+#include <QTextStream>
+
+#include <algorithm>
+
+#include "downloadmetrics.h"
+
+EngineBench::EngineBench(MockBoardConfig config, QString outDir, int timeoutSeconds, QObject *parent) :
+    QObject(parent),
+    config(config),
+    outDir(outDir)
+{
+    clock.start();
+    server = new MockBoardServer(config, clock);
+    server->moveToThread(&serverThread);
+    serverThread.setObjectName("mockboard");
+
+    timeout = new QTimer(this);
+    timeout->setSingleShot(true);
+    timeout->setInterval(timeoutSeconds * 1000);
+
+    connect(&serverThread, SIGNAL(finished()), server, SLOT(deleteLater()));
+    connect(timeout, SIGNAL(timeout()), this, SLOT(timedOut()));
+}
+
+EngineBench::~EngineBench() {
+    // The engines hold parsers of the plugin manager, they go first
+    qDeleteAll(engines);
+    engines.clear();
+
+    if (serverThread.isRunning()) {
+        QMetaObject::invokeMethod(server, "close", Qt::BlockingQueuedConnection);
+        serverThread.quit();
+        serverThread.wait();
+    }
+    else {
+        delete server;
+    }
+}
+
+/**
+ * Starts the server, routes all requests through it and starts one engine
+ * per thread. Returns false if any of that fails.
+ */
+bool EngineBench::start() {
+    quint16 port;
+
+    serverThread.start();
+    QMetaObject::invokeMethod(server, "listen", Qt::BlockingQueuedConnection, Q_RETURN_ARG(quint16, port));
+    if (port == 0) {
+        QTextStream(stdout) << "Could not start the mock board server\n";
+        return false;
+    }
+
+    // The board urls stay as they are, so the 4chan plugin parses the pages
+    QNetworkProxy::setApplicationProxy(QNetworkProxy(QNetworkProxy::HttpProxy, "127.0.0.1", port));
+
+    // Only what the downloads add counts, not the server's image buffer or Qt's setup
+    resetHeapPeak();
+    heapAtStart = heapStats();
+
+    downloadManager = std::make_shared<DownloadManager>();
+    pluginManager = std::make_shared<PluginManager>(downloadManager);
+
+    for (int i=0; i<config.threads; i++) {
+        ThreadDownloadEngine* engine;
+        int thread;
+
+        thread = config.firstThread + i;
+        engine = new ThreadDownloadEngine(downloadManager, pluginManager, this);
+        engine->setUrl(QString("http://boards.4chan.org/b/thread/%1").arg(thread));
+        engine->setSavepath(QDir(outDir).filePath(QString::number(thread)));
+        engines.append(engine);
+
+        connect(engine, SIGNAL(imageAvailable(QString)), this, SLOT(imageSaved(QString)));
+        connect(engine, SIGNAL(finished()), this, SLOT(engineFinished()));
+    }
+
+    foreach (ThreadDownloadEngine* engine, engines) {
+        if (!engine->start()) {
+            QTextStream(stdout) << "Could not start " << engine->url() << ": " << engine->lastError() << "\n";
+            return false;
+        }
+    }
+
+    downloadManager->resumeDownloads();
+    timeout->start();
+
+    return true;
+}
+
+void EngineBench::imageSaved(QString filename) {
+    qint64 servedAt;
+
+    servedAt = server->pageServedAt(MockBoardServer::threadOfImage(filename));
+    if (servedAt != -1)
+        latencies.append(clock.elapsed() - servedAt);
+}
+
+void EngineBench::engineFinished() {
+    // An engine finishes again if it is told to reload, the run is over by then
+    if (!timeout->isActive())
+        return;
+
+    finishedEngines.insert(sender());
+
+    if (finishedEngines.count() == engines.count()) {
+        timeout->stop();
+        report(true);
+        emit done(0);
+    }
+}
+
+void EngineBench::timedOut() {
+    report(false);
+    emit done(1);
+}
+
+void EngineBench::report(bool complete) {
+    QTextStream out(stdout);
+    MockBoardStats stats;
+    HeapStats heap;
+    qint64 completed;
+    qint64 images;
+    qint64 bytes;
+    qint64 ms;
+    qint64 p50, p99;
+
+    ms = clock.elapsed();
+    images = 0;
+    bytes = 0;
+    foreach (ThreadDownloadEngine* engine, engines) {
+        images += engine->savedImages();
+        bytes += engine->savedBytes();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    p50 = latencies.isEmpty() ? 0 : latencies.at((latencies.count() - 1) * 50 / 100);
+    p99 = latencies.isEmpty() ? 0 : latencies.at((latencies.count() - 1) * 99 / 100);
+    stats = server->stats();
+    heap = heapStats();
+    // A truncated response is requested again, it is not a completed request
+    completed = qMax<qint64>(1, stats.requests - stats.truncated);
+
+    if (!complete)
+        out << "Timed out, " << finishedEngines.count() << " of " << engines.count() << " threads finished\n";
+
+    out << QString("threads       %1 x %2 images of %3 KB\n").arg(config.threads).arg(config.imagesPerThread).arg(config.imageSize / 1024);
+    out << QString("images        %1 of %2 in %3 s\n").arg(images).arg(config.threads * config.imagesPerThread).arg(ms / 1000.0, 0, 'f', 2);
+    out << QString("images/s      %1\n").arg(ms > 0 ? images * 1000.0 / ms : 0.0, 0, 'f', 1);
+    out << QString("MB/s          %1\n").arg(ms > 0 ? bytes / 1000.0 / ms : 0.0, 0, 'f', 2);
+    out << QString("latency       p50 %1 ms, p99 %2 ms\n").arg(p50).arg(p99);
+    out << QString("peak RSS      %1 MB\n").arg(DownloadMetrics::peakRss() / 1024.0, 0, 'f', 1);
+    out << QString("allocations   %1 per request, %2 KB per request\n")
+           .arg((double)(heap.allocations - heapAtStart.allocations) / completed, 0, 'f', 1)
+           .arg((heap.allocatedBytes - heapAtStart.allocatedBytes) / 1024.0 / completed, 0, 'f', 1);
+    if (heap.peakLiveBytes != -1) {
+        out << QString("heap peak     %1 MB above start, %2 KB per request\n")
+               .arg((heap.peakLiveBytes - heapAtStart.liveBytes) / 1048576.0, 0, 'f', 1)
+               .arg((heap.peakLiveBytes - heapAtStart.liveBytes) / 1024.0 / completed, 0, 'f', 1);
+    }
+    out << QString("server        %1 requests, %2 MB\n").arg(stats.requests).arg(stats.bytes / 1000000.0, 0, 'f', 1);
+    out << QString("faults        %1 errors, %2 truncated, %3 redirects\n").arg(stats.errors).arg(stats.truncated).arg(stats.redirects);
+    out.flush();
+}
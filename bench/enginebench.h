@@ -0,0 +1,64 @@
+#ifndef ENGINEBENCH_H
+#define ENGINEBENCH_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+
+#include <memory>
+
+#include "downloadmanager.h"
+#include "pluginmanager.h"
+#include "threaddownloadengine.h"
+#include "mockboardserver.h"
+#include "heapstats.h"
+
+/**
+ * Downloads every thread of a MockBoardServer with one ThreadDownloadEngine
+ * each, the way the console does, and reports images/s, MB/s, the latency
+ * percentiles of the images, the peak RSS and the heap use per completed
+ * request, see heapstats.h.
+ *
+ * The latency of an image runs from the first time the server handed out the
+ * complete thread page listing it until the engine saved it. Queueing,
+ * retries and redirects count against it.
+ */
+class EngineBench : public QObject
+{
+    Q_OBJECT
+public:
+    explicit EngineBench(MockBoardConfig config, QString outDir, int timeoutSeconds, QObject *parent = nullptr);
+    ~EngineBench();
+
+    bool start();
+
+private:
+    MockBoardConfig config;
+    QString outDir;
+    QElapsedTimer clock;
+    QThread serverThread;
+    MockBoardServer* server;
+    std::shared_ptr<DownloadManager> downloadManager;
+    std::shared_ptr<PluginManager> pluginManager;
+    QList<ThreadDownloadEngine*> engines;
+    QSet<QObject*> finishedEngines;
+    QVector<qint64> latencies;
+    QTimer* timeout;
+    HeapStats heapAtStart;
+
+    void report(bool complete);
+
+private slots:
+    void imageSaved(QString filename);
+    void engineFinished();
+    void timedOut();
+
+signals:
+    void done(int exitCode);
+};
+
+#endif // ENGINEBENCH_H
@@ -0,0 +1,137 @@
+#include "heapstats.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<qint64> allocationCount(0);
+static std::atomic<qint64> allocatedBytes(0);
+static std::atomic<qint64> liveBytes(0);
+static std::atomic<qint64> peakLiveBytes(0);
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+
+static void allocated(void* p, size_t size) {
+    qint64 live;
+    qint64 peak;
+
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (p == 0)
+        return;
+
+    live = liveBytes.fetch_add(malloc_usable_size(p), std::memory_order_relaxed) + malloc_usable_size(p);
+    peak = peakLiveBytes.load(std::memory_order_relaxed);
+    while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        ;
+}
+
+static void released(void* p) {
+    if (p != 0)
+        liveBytes.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+}
+
+// Wrapping malloc and friends catches Qt's containers, which do not allocate
+// through operator new. Aligned allocations are not wrapped, they are rare in Qt.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void __libc_free(void* p);
+
+void* malloc(size_t size) {
+    void* p;
+
+    p = __libc_malloc(size);
+    allocated(p, size);
+
+    return p;
+}
+
+void* calloc(size_t n, size_t size) {
+    void* p;
+
+    p = __libc_calloc(n, size);
+    allocated(p, n * size);
+
+    return p;
+}
+
+void* realloc(void* p, size_t size) {
+    void* q;
+    size_t old;
+
+    old = p != 0 ? malloc_usable_size(p) : 0;
+    q = __libc_realloc(p, size);
+    if (q != 0 || size == 0)
+        liveBytes.fetch_sub(old, std::memory_order_relaxed);
+    allocated(q, size);
+
+    return q;
+}
+
+void free(void* p) {
+    released(p);
+    __libc_free(p);
+}
+}
+
+HeapStats heapStats() {
+    HeapStats ret;
+
+    ret.allocations = allocationCount.load();
+    ret.allocatedBytes = allocatedBytes.load();
+    ret.liveBytes = liveBytes.load();
+    ret.peakLiveBytes = peakLiveBytes.load();
+
+    return ret;
+}
+#else
+void* operator new(std::size_t size) {
+    void* p;
+
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    p = std::malloc(size ? size : 1);
+    if (p == 0)
+        throw std::bad_alloc();
+
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+HeapStats heapStats() {
+    HeapStats ret;
+
+    ret.allocations = allocationCount.load();
+    ret.allocatedBytes = allocatedBytes.load();
+    ret.liveBytes = -1;
+    ret.peakLiveBytes = -1;
+
+    return ret;
+}
+#endif
+
+void resetHeapPeak() {
+    peakLiveBytes.store(liveBytes.load());
+}
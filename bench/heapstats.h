@@ -0,0 +1,24 @@
+#ifndef HEAPSTATS_H
+#define HEAPSTATS_H
+
+#include <QtGlobal>
+
+struct HeapStats
+{
+    qint64 allocations = 0;     // malloc, calloc and realloc calls
+    qint64 allocatedBytes = 0;  // bytes requested by them
+    qint64 liveBytes = 0;       // allocated and not yet freed, -1 if not tracked
+    qint64 peakLiveBytes = 0;   // highest liveBytes since resetHeapPeak(), -1 if not tracked
+};
+
+/**
+ * Heap counters of the whole process, Qt and the plugins included. On glibc
+ * they come from malloc wrappers and cover everything. Elsewhere only
+ * operator new is counted, so QByteArray and QString bodies are missing and
+ * the live bytes are not tracked at all.
+ */
+HeapStats heapStats();
+// Starts a new peak at the current live bytes
+void resetHeapPeak();
+
+#endif // HEAPSTATS_H
@@ -0,0 +1,117 @@
+#include <QCoreApplication>
+#include <QDir>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include "appsettings.h"
+#include "decodebench.h"
+#include "enginebench.h"
+#include "QsLog.h"
+#include "QsLogDest.h"
+
+/*
+ * fourchan-dl-bench [--threads N] [--images N] [--size KB] [--latency MS]
+ *                   [--errors %] [--truncate %] [--redirects %] [--seed N]
+ *                   [--connections N] [--timeout S] [--out DIR]
+ * fourchan-dl-bench --decode PASSES
+ *
+ * Downloads synthetic 4chan threads from an in-process mock server with the
+ * real download pipeline. The fault rates apply to the first request of each
+ * url only, so every run can complete. The files go to a temporary directory
+ * that is removed afterwards, unless --out is given.
+ *
+ * For the memory use of the reply -> RequestHandler path, compare the heap
+ * lines of a run with large bodies, e.g. "--size 2048 --images 20", between
+ * two builds. The allocated KB per request shows every deep copy of a body,
+ * the heap peak how long the bodies stay alive. Both include the mock
+ * server's socket buffers, which are the same for every build.
+ *
+ * --decode runs the HTML entity decoder over generated comments instead, see
+ * DecodeBench.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QTextStream out(stdout);
+    QTemporaryDir tempDir;
+    MockBoardConfig config;
+    QString outDir;
+    QString workingDir;
+    int connections;
+    int timeoutSeconds;
+    int decodePasses;
+    int exitCode;
+
+    QsLogging::Logger& logger = QsLogging::Logger::instance();
+    QsLogging::DestinationPtr debugDestination(
+       QsLogging::DestinationFactory::MakeDebugOutputDestination() );
+    logger.addDestination(debugDestination);
+    logger.setLoggingLevel(QsLogging::ErrorLevel);
+
+    connections = 20;
+    timeoutSeconds = 600;
+    decodePasses = 0;
+
+    for (int i=1; i<argc; i++) {
+        QString arg = QString::fromLocal8Bit(argv[i]);
+        QString value = QString::fromLocal8Bit(i+1 < argc ? argv[i+1] : "");
+
+        if (value.isEmpty()) {
+            out << "Missing value for " << arg << "\n";
+            return 2;
+        }
+        i++;
+
+        if (arg == "--threads")             config.threads = value.toInt();
+        else if (arg == "--images")         config.imagesPerThread = qBound(1, value.toInt(), 99999);
+        else if (arg == "--size")           config.imageSize = value.toInt() * 1024;
+        else if (arg == "--latency")        config.latencyMs = value.toInt();
+        else if (arg == "--errors")         config.errorRate = value.toInt();
+        else if (arg == "--truncate")       config.truncateRate = value.toInt();
+        else if (arg == "--redirects")      config.redirectRate = value.toInt();
+        else if (arg == "--seed")           config.seed = value.toUInt();
+        else if (arg == "--connections")    connections = value.toInt();
+        else if (arg == "--timeout")        timeoutSeconds = value.toInt();
+        else if (arg == "--out")            outDir = QDir(value).absolutePath();
+        else if (arg == "--decode")         decodePasses = qMax(1, value.toInt());
+        else {
+            out << "Unknown argument " << arg << "\n";
+            return 2;
+        }
+    }
+
+    if (decodePasses > 0) {
+        DecodeBench(decodePasses).run();
+        return 0;
+    }
+
+    if (outDir.isEmpty())
+        outDir = tempDir.path();
+    QDir().mkpath(outDir);
+
+    // settings.ini is read from the working directory, keep the user's out of it
+    workingDir = QDir::currentPath();
+    QDir::setCurrent(outDir);
+    {
+        chandl::AppSettings settings;
+
+        settings.setManagerConcurrentDownloads(connections);
+        settings.setUseThreadCache(false);
+        settings.sync();
+    }
+
+    EngineBench bench(config, outDir, timeoutSeconds);
+
+    exitCode = 2;
+    QObject::connect(&bench, &EngineBench::done, [&](int code) {
+        exitCode = code;
+        a.quit();
+    });
+
+    if (bench.start())
+        a.exec();
+
+    QDir::setCurrent(workingDir);
+
+    return exitCode;
+}
@@ -0,0 +1,243 @@
+#include "mockboardserver.h"
+
+#include <QMutexLocker>
+#include <QRegExp>
+#include <QStringList>
+#include <QTimer>
+#include <QUrl>
+
+MockBoardServer::MockBoardServer(MockBoardConfig config, QElapsedTimer clock, QObject *parent) :
+    QObject(parent),
+    config(config),
+    clock(clock)
+{
+    server = new QTcpServer(this);
+    image = QByteArray(config.imageSize, '\xab');
+
+    connect(server, SIGNAL(newConnection()), this, SLOT(acceptConnection()));
+}
+
+/**
+ * Starts listening on a free port of the loopback interface. Returns the
+ * port, 0 on failure. Call it in the thread the server lives in.
+ */
+quint16 MockBoardServer::listen() {
+    if (!server->listen(QHostAddress::LocalHost, 0))
+        return 0;
+
+    return server->serverPort();
+}
+
+void MockBoardServer::close() {
+    server->close();
+}
+
+qint64 MockBoardServer::pageServedAt(int thread) {
+    QMutexLocker lock(&mutex);
+
+    return pageServed.value(thread, -1);
+}
+
+MockBoardStats MockBoardServer::stats() {
+    QMutexLocker lock(&mutex);
+
+    return _stats;
+}
+
+int MockBoardServer::threadOfImage(QString filename) {
+    QString name;
+    qint64 tim;
+    bool ok;
+
+    name = filename.section("/", -1);
+    tim = name.section(".", 0, 0).toLongLong(&ok);
+
+    return ok ? (int)(tim / 100000) : -1;
+}
+
+void MockBoardServer::acceptConnection() {
+    QTcpSocket* socket;
+
+    while ((socket = server->nextPendingConnection()) != 0) {
+        buffers.insert(socket, QByteArray());
+
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readRequests()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
+    }
+}
+
+void MockBoardServer::readRequests() {
+    QTcpSocket* socket;
+    QByteArray head;
+    int end;
+
+    socket = qobject_cast<QTcpSocket*>(sender());
+    if (socket == 0)
+        return;
+
+    QByteArray& buffer = buffers[socket];
+    buffer.append(socket->readAll());
+
+    // Only GET requests arrive here, a request ends with its header
+    while ((end = buffer.indexOf("\r\n\r\n")) != -1) {
+        QPointer<QTcpSocket> s(socket);
+
+        head = buffer.left(end);
+        buffer.remove(0, end + 4);
+
+        if (config.latencyMs > 0)
+            QTimer::singleShot(config.latencyMs, this, [this, s, head]() { handle(s, head); });
+        else
+            handle(s, head);
+    }
+}
+
+void MockBoardServer::socketDisconnected() {
+    QTcpSocket* socket;
+
+    socket = qobject_cast<QTcpSocket*>(sender());
+    if (socket != 0) {
+        buffers.remove(socket);
+        socket->deleteLater();
+    }
+}
+
+void MockBoardServer::handle(QPointer<QTcpSocket> socket, QByteArray head) {
+    QRegExp rxThread("^/[^/]+/thread/(\\d+)\\.json$");
+    QRegExp rxImage("^/[^/]+/(\\d+)\\.jpg$");
+    QList<QByteArray> lines;
+    QUrl url;
+    QString host;
+    QString path;
+    bool moved;
+    bool truncate;
+    int r;
+
+    if (socket.isNull() || socket->state() != QAbstractSocket::ConnectedState)
+        return;
+
+    // As a proxy we get absolute urls, the Host header covers direct requests
+    lines = head.split('\n');
+    url = QUrl(QString::fromLatin1(lines.value(0).split(' ').value(1)));
+    host = url.host();
+    foreach (QByteArray line, lines) {
+        if (host.isEmpty() && line.toLower().startsWith("host:"))
+            host = QString::fromLatin1(line.mid(5).trimmed());
+    }
+
+    path = url.path();
+    moved = path.startsWith("/moved/");
+    if (moved)
+        path.remove(0, 6);
+
+    // Only the first request for a path fails, so every download completes in the end
+    truncate = false;
+    if (!moved && attempts[path]++ == 0) {
+        r = qHash(path, config.seed) % 100;
+
+        if (r < config.errorRate) {
+            mutex.lock();
+            _stats.errors++;
+            mutex.unlock();
+            send(socket, 503, "", QByteArray());
+            return;
+        }
+        r -= config.errorRate;
+
+        if (r < config.truncateRate) {
+            mutex.lock();
+            _stats.truncated++;
+            mutex.unlock();
+            truncate = true;
+        }
+        else if (r - config.truncateRate < config.redirectRate) {
+            mutex.lock();
+            _stats.redirects++;
+            mutex.unlock();
+            send(socket, 302, QString("Location: http://%1/moved%2\r\n").arg(host).arg(path).toLatin1(), QByteArray());
+            return;
+        }
+    }
+
+    if (rxThread.indexIn(path) != -1) {
+        int thread = rxThread.cap(1).toInt();
+
+        if (thread >= config.firstThread && thread < config.firstThread + config.threads) {
+            send(socket, 200, "Content-Type: application/json\r\n", threadPage(thread), truncate);
+
+            if (!truncate) {
+                QMutexLocker lock(&mutex);
+
+                if (!pageServed.contains(thread))
+                    pageServed.insert(thread, clock.elapsed());
+            }
+        }
+        else {
+            send(socket, 404, "", QByteArray());
+        }
+    }
+    else if (rxImage.indexIn(path) != -1) {
+        qint64 tim = rxImage.cap(1).toLongLong();
+        int thread = tim / 100000;
+
+        if (thread >= config.firstThread && thread < config.firstThread + config.threads
+                && tim % 100000 < config.imagesPerThread)
+            send(socket, 200, "Content-Type: image/jpeg\r\n", image, truncate);
+        else
+            send(socket, 404, "", QByteArray());
+    }
+    else {
+        // Anything else, e.g. the initial requests of the plugins
+        send(socket, 200, "Content-Type: text/html\r\n", QByteArray(), truncate);
+    }
+}
+
+// A 4chan API thread: every post has an image, the first one a subject
+QByteArray MockBoardServer::threadPage(int thread) {
+    QStringList posts;
+    qint64 tim;
+
+    for (int i=0; i<config.imagesPerThread; i++) {
+        tim = (qint64)thread * 100000 + i;
+
+        posts << QString("{\"no\":%1,%2\"com\":\"Post %3\",\"filename\":\"file%3\",\"ext\":\".jpg\",\"tim\":%4,\"fsize\":%5}")
+                 .arg(thread + i)
+                 .arg(i == 0 ? QString("\"sub\":\"Thread %1\",").arg(thread) : QString())
+                 .arg(i)
+                 .arg(tim)
+                 .arg(config.imageSize);
+    }
+
+    return QString("{\"posts\":[%1]}").arg(posts.join(",")).toUtf8();
+}
+
+void MockBoardServer::send(QTcpSocket* socket, int status, QByteArray headers, const QByteArray& body, bool truncate) {
+    QByteArray response;
+    QByteArray reason;
+    qint64 written;
+
+    switch (status) {
+    case 200: reason = "OK"; break;
+    case 302: reason = "Found"; break;
+    case 404: reason = "Not Found"; break;
+    default:  reason = "Service Unavailable"; break;
+    }
+
+    response = "HTTP/1.1 " + QByteArray::number(status) + " " + reason + "\r\n";
+    response += headers;
+    response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    response += "Connection: keep-alive\r\n\r\n";
+
+    written = socket->write(response);
+    if (truncate) {
+        written += socket->write(body.left(body.size() / 2));
+        socket->disconnectFromHost();
+    }
+    else {
+        written += socket->write(body);
+    }
+
+    QMutexLocker lock(&mutex);
+    _stats.requests++;
+    _stats.bytes += written;
+}
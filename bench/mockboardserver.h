@@ -0,0 +1,83 @@
+#ifndef MOCKBOARDSERVER_H
+#define MOCKBOARDSERVER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+struct MockBoardConfig
+{
+    int firstThread = 1000;
+    int threads = 10;
+    int imagesPerThread = 100;
+    int imageSize = 256 * 1024;
+    int latencyMs = 0;
+    // Percent of the first requests for a path that fail in one of these ways
+    int errorRate = 0;          // 503, retried by the download worker
+    int truncateRate = 0;       // full Content-Length, half the body, then the connection closes
+    int redirectRate = 0;       // 302 to the same file below /moved
+    uint seed = 0;
+};
+
+struct MockBoardStats
+{
+    qint64 requests = 0;
+    qint64 bytes = 0;
+    int errors = 0;
+    int truncated = 0;
+    int redirects = 0;
+};
+
+/**
+ * Minimal HTTP/1.1 server that answers like 4chan: thread JSON below
+ * /<board>/thread/<no>.json and images below /<board>/<tim>.jpg. It is meant
+ * to be used as HTTP proxy, so the real board urls and the 4chan parser
+ * plugin work unchanged. Lives in its own thread, so a busy event loop on the
+ * client side does not delay the responses.
+ *
+ * Image tim values are thread * 100000 + post, see threadOfImage().
+ */
+class MockBoardServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MockBoardServer(MockBoardConfig config, QElapsedTimer clock, QObject *parent = nullptr);
+
+    // Milliseconds on clock when the page of thread was first served, -1 if never
+    qint64 pageServedAt(int thread);
+    MockBoardStats stats();
+
+    static int threadOfImage(QString filename);
+
+public slots:
+    quint16 listen();
+    void close();
+
+private:
+    MockBoardConfig config;
+    QElapsedTimer clock;
+    QTcpServer* server;
+    QByteArray image;
+    QHash<QTcpSocket*, QByteArray> buffers;
+    QHash<QString, int> attempts;
+
+    QMutex mutex;               // guards the members below, read from the benchmark thread
+    QHash<int, qint64> pageServed;
+    MockBoardStats _stats;
+
+    void handle(QPointer<QTcpSocket> socket, QByteArray target);
+    QByteArray threadPage(int thread);
+    void send(QTcpSocket* socket, int status, QByteArray headers, const QByteArray& body, bool truncate = false);
+
+private slots:
+    void acceptConnection();
+    void readRequests();
+    void socketDisconnected();
+};
+
+#endif // MOCKBOARDSERVER_H
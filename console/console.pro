@@ -27,6 +27,16 @@ SOURCES += main.cpp \
     ../gui/blacklist.cpp \
     ../gui/applicationupdateinterface.cpp \
     ../gui/networkaccessmanager.cpp \
+    ../gui/folderindex.cpp \
+    ../gui/parsermetrics.cpp \
+    ../gui/boardwatchengine.cpp \
+    ../gui/sessionstore.cpp \
+    ../gui/downloadworker.cpp \
+    ../gui/threaddownloadengine.cpp \
+    ../gui/HtmlEntities.cpp \
+    ../gui/appsettings.cpp \
+    ../gui/downloadmetrics.cpp \
+    ../gui/settingssnapshot.cpp \
     ../updater/commands.cpp
 
 RESOURCES +=
@@ -41,7 +51,7 @@ BUILDDATE = __DATE__
 VERSION = 0.1.2
 DEFINES += BUILDDATE=$${BUILDDATE} PROGRAM_VERSION="\\\"$${VERSION}\\\""
 
-win32: LIBS += libole32
+win32: LIBS += libole32 -lpsapi
 
 OTHER_FILES += \ 
     fourchan-dl-win.rc \
@@ -64,4 +74,14 @@ HEADERS += \
     threadhandler.h \
     imagethread.h \
     ../gui/networkaccessmanager.h \
+    ../gui/folderindex.h \
+    ../gui/parsermetrics.h \
+    ../gui/boardwatchengine.h \
+    ../gui/sessionstore.h \
+    ../gui/downloadworker.h \
+    ../gui/threaddownloadengine.h \
+    ../gui/HtmlEntities.h \
+    ../gui/appsettings.h \
+    ../gui/downloadmetrics.h \
+    ../gui/settingssnapshot.h \
     ../updater/commands.h
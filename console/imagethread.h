@@ -2,15 +2,15 @@
 #define IMAGETHREAD_H
 
 #include <QObject>
-#include <QTimer>
 #include <QSettings>
 #include <QUrl>
 #include "blacklist.h"
-#include "requesthandler.h"
-#include "ParserPluginInterface.h"
 #include "pluginmanager.h"
+#include "threaddownloadengine.h"
+#include "sessionstore.h"
 
-extern PluginManager* pluginManager;
+extern std::shared_ptr<DownloadManager> downloadManager;
+extern std::shared_ptr<PluginManager> pluginManager;
 
 class ImageThread : public QObject
 {
@@ -20,53 +20,31 @@ public:
     QString getValues(void);
     void setValues(QString);
     void setBlackList(BlackList* bl);
-    int getTotalImagesCount() {return images.count();}
-    int getDownloadedImagesCount();
-    QString getUrl() {return _sUrl;}
+    int getTotalImagesCount() {return engine->totalImages();}
+    int getDownloadedImagesCount() {return engine->downloadedImages();}
+    QString getUrl() {return engine->url();}
+    bool isRunning() {return engine->isRunning();}
+    int getSavedImagesCount() {return engine->savedImages();}
+    qint64 getSavedBytes() {return engine->savedBytes();}
+    chandl::ThreadRecord sessionRecord();
+    void restoreSession(const chandl::ThreadRecord& record);
 
 private:
-    QTimer* timer;
-    QList<int> timeoutValues;
-    QList<_IMAGE> images;
-    QSize iconSize;
+    ThreadDownloadEngine* engine;
     QSettings* settings;
-    BlackList* _blackList;
-    QString _status;
-    RequestHandler* requestHandler;
-    ParserPluginInterface* iParser;
-    QObject* oParser;
-    QString _sUrl;
     QString _sSavepath;
 
-    bool _running;
-    bool _closeWhenFinished;
-    bool _downloading;
     bool _rescan;
     int  _rescanInterval;
     bool _saveWithOriginalFilename;
 
-    void setStatus(QString s);
-    void createSupervisedDownload(QUrl);
-    void removeSupervisedDownload(QUrl);
-    bool getUrlOfFilename(QString filename, QString * url);
-    bool isDownloadFinished();
-    bool getNextImage(QString* s);
-    bool selectParser(QUrl url=QUrl());
-    void mergeImageList(QList<_IMAGE> list);
-    bool addImage(_IMAGE img);
-    QString getSavepath();
-
 private slots:
-    void errorHandler(QUrl, int);
-    void messageHandler(QString);
-    void processCloseRequest();
-    void triggerRescan(void);
-    void startDownload(void);
-    void stopDownload(void);
-    void download(bool b);
-    void processRequestResponse(QUrl url, QByteArray ba, bool cached);
-    void setCompleted(QString uri, QString filename);
-    bool isImage(QUrl);
+    void processCloseRequest(int);
+    void processParseError(int);
+    void followRedirect(QUrl);
+    void openThreads(QList<QUrl>);
+    void downloadFinished();
+    void processCachedResult();
 
 public slots:
     void start(void);
@@ -74,7 +52,7 @@ public slots:
     bool checkForExistingThread(QString s="");
 
 signals:
-    void finished(void);
+    void finished(ImageThread*);
     void errorMessage(QString);
     void closeRequest(ImageThread*, int);
     void createThreadRequest(QString);
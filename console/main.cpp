@@ -13,8 +13,8 @@
  #error "Sorry mate, this application needs Qt4.x.x to run properly."
 #endif
 
-DownloadManager* downloadManager;
-PluginManager* pluginManager;
+std::shared_ptr<DownloadManager> downloadManager;
+std::shared_ptr<PluginManager> pluginManager;
 QString updaterFileName;
 QFile* fLogFile;
 QTextStream logOutput;
@@ -26,18 +26,21 @@ int main(int argc, char *argv[])
     QCoreApplication a(argc, argv);
     QSettings settings("settings.ini", QSettings::IniFormat);
     int logLevel;
+    QString metricsFile;
+    QString batchFile;
+    QString batchOutDir;
+    int batchJobs;
 
     // init the logging mechanism
     QsLogging::Logger& logger = QsLogging::Logger::instance();
     logger.setLoggingLevel(QsLogging::TraceLevel);
     const QString sLogPath(QDir(a.applicationDirPath()).filePath("fourchan-dl-console.log"));
     QsLogging::DestinationPtr fileDestination(
-       QsLogging::DestinationFactory::MakeFileDestination(sLogPath) );
-    QsLogging::DestinationPtr debugDestination(
-       QsLogging::DestinationFactory::MakeDebugOutputDestination() );
-    logger.addDestination(debugDestination.get());
-    logger.addDestination(fileDestination.get());
+       QsLogging::DestinationFactory::MakeAsyncFileDestination(sLogPath) );
+    logger.addDestination(fileDestination);
 #ifdef __DEBUG__
+    // Synchronous, every message waits for the debugger or stderr
+    logger.addDestination(QsLogging::DestinationFactory::MakeDebugOutputDestination());
     logger.setLoggingLevel(QsLogging::TraceLevel);
 #else
     logger.setLoggingLevel(QsLogging::WarnLevel);
@@ -59,18 +62,51 @@ int main(int argc, char *argv[])
         QLOG_ALWAYS() << "APP :: Console started";
         QLOG_ALWAYS() << "APP :: Built with Qt" << QT_VERSION_STR << "running on" << qVersion();
 
-        downloadManager = new DownloadManager();
-        pluginManager = new PluginManager();
+        downloadManager = std::make_shared<DownloadManager>();
+        pluginManager = std::make_shared<PluginManager>(downloadManager);
 
         downloadManager->pauseDownloads();  // Do not download anything until we are fully set
         ThreadHandler threadHandler;
-        threadHandler.restoreThreads();
+
+        batchJobs = 4;
+        batchOutDir = QDir::currentPath();
+        for (int i=1; i<argc-1; i++) {
+            if (strcmp(argv[i], "--metrics") == 0) {
+                metricsFile = QString::fromLocal8Bit(argv[i+1]);
+                QLOG_ALWAYS() << "APP :: Writing download metrics to " << metricsFile;
+            }
+            else if (strcmp(argv[i], "--batch") == 0) {
+                batchFile = QString::fromLocal8Bit(argv[i+1]);
+            }
+            else if (strcmp(argv[i], "--jobs") == 0) {
+                batchJobs = QString::fromLocal8Bit(argv[i+1]).toInt();
+            }
+            else if (strcmp(argv[i], "--out") == 0) {
+                batchOutDir = QString::fromLocal8Bit(argv[i+1]);
+            }
+        }
+        threadHandler.setMetricsFile(metricsFile);
+
+        if (!batchFile.isEmpty()) {
+            // Batch mode: only the threads from the list, quit when they are done
+            if (!threadHandler.startBatch(batchFile, batchJobs, batchOutDir)) {
+                out << "Could not start batch from " << batchFile << "\n";
+                out.flush();
+                return 1;
+            }
+        }
+        else {
+            threadHandler.restoreThreads();
+        }
 
         a.connect(&a, SIGNAL(aboutToQuit()), &threadHandler, SLOT(saveSettings()));
+        a.connect(&a, SIGNAL(aboutToQuit()), &threadHandler, SLOT(dumpMetrics()));
         //    a.connect(&a, SIGNAL(aboutToQuit()), &threadHandler, SLOT(deleteLater()));
         //    a.connect(&a, SIGNAL(aboutToQuit()), downloadManager, SLOT(deleteLater()));
 
         //downloadManager->resumeDownloads();
+
+        // threadHandler lives in this scope, so the event loop has to run here
+        return a.exec();
     }
-    return a.exec();
 }
@@ -1,10 +1,14 @@
 ﻿#include "threadhandler.h"
 
+#include <QJsonDocument>
+
+#include "parsermetrics.h"
+
 ThreadHandler::ThreadHandler(QObject *parent) :
     QObject(parent)
 {
     aui = new ApplicationUpdateInterface(this);
-    requestHandler = new RequestHandler(this);
+    requestHandler = new RequestHandler(downloadManager, this);
     blackList = new BlackList(this);
 
     thumbnailRemoverThread = new QThread();
@@ -18,6 +22,13 @@ ThreadHandler::ThreadHandler(QObject *parent) :
     settings = new QSettings("settings.ini", QSettings::IniFormat);
     loadSettings();
 
+    batchMode = false;
+    batchJobs = 1;
+    batchThreadsDone = 0;
+    batchThreadsFailed = 0;
+    batchImages = 0;
+    batchBytes = 0;
+
     connect(requestHandler, SIGNAL(response(QUrl,QByteArray,bool)), this, SLOT(processRequestResponse(QUrl,QByteArray,bool)));
     connect(requestHandler, SIGNAL(responseError(QUrl,int)), this, SLOT(handleRequestError(QUrl,int)));
 
@@ -41,6 +52,53 @@ ThreadHandler::ThreadHandler(QObject *parent) :
     autosaveTimer->setInterval(1000*60*10);     // 10 Minutes
     autosaveTimer->setSingleShot(false);
     connect(autosaveTimer, SIGNAL(timeout()), this, SLOT(saveSettings()));
+
+    metricsTimer = new QTimer(this);
+    metricsTimer->setInterval(1000*60);         // 1 Minute
+    metricsTimer->setSingleShot(false);
+    connect(metricsTimer, SIGNAL(timeout()), this, SLOT(dumpMetrics()));
+}
+
+/**
+ * Periodically write the download metrics to the given file. A file ending in .csv
+ * gets one value per line, everything else is written as JSON.
+ */
+void ThreadHandler::setMetricsFile(QString filename) {
+    metricsFile = filename;
+
+    if (metricsFile.isEmpty()) {
+        metricsTimer->stop();
+    }
+    else {
+        metricsTimer->start();
+    }
+}
+
+void ThreadHandler::dumpMetrics() {
+    QFile f;
+
+    if (metricsFile.isEmpty())
+        return;
+
+    f.setFileName(metricsFile);
+    f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text);
+    if (f.isOpen() && f.isWritable()) {
+        if (metricsFile.endsWith(".csv", Qt::CaseInsensitive)) {
+            f.write(downloadManager->getMetrics().toCsv().toUtf8());
+            f.write(ParserMetrics::instance().toCsv().toUtf8());
+        }
+        else {
+            QJsonObject o;
+
+            o = downloadManager->getMetrics().toJson();
+            o.insert("parsers", ParserMetrics::instance().toJson());
+            f.write(QJsonDocument(o).toJson());
+        }
+    }
+    else {
+        QLOG_ERROR() << "ThreadHandler :: Could not write metrics to " << metricsFile;
+    }
+    f.close();
 }
 
 void ThreadHandler::loadSettings() {
@@ -71,25 +129,37 @@ void ThreadHandler::loadSettings() {
 }
 
 void ThreadHandler::saveSettings() {
-    QLOG_DEBUG() << "ThreadHandler :: Saving threads";
+    if (batchMode) {
+        // Batch threads are not part of the saved session
+        return;
+    }
 
-    settings->beginGroup("tabs");
-        settings->setValue("count", threadList.count());
+    QList<chandl::ThreadRecord> records;
 
-        for (int i=0; i<threadList.count(); i++) {
-            settings->setValue(QString("tab%1").arg(i), threadList.at(i)->getValues());
-        }
-    settings->endGroup();
+    QLOG_DEBUG() << "ThreadHandler :: Saving threads";
+
+    // Only threads that changed since the last save are written
+    for (int i=0; i<threadList.count(); i++) {
+        records << threadList.at(i)->sessionRecord();
+    }
 
-    settings->sync();
+    if (!sessionStore.save(records)) {
+        QLOG_ERROR() << "ThreadHandler :: Saving the session failed";
+    }
+    else if (settings->contains("tabs/count")) {
+        settings->remove("tabs");   // Migrated to the session store
+        settings->sync();
+    }
 }
 
 void ThreadHandler::restoreThreads() {
     int threadCount;
+    QList<chandl::ThreadRecord> records;
 
     out << "Reopening threads\n";
 
-    threadCount = settings->value("tabs/count",0).toInt();
+    records = sessionStore.load();
+    threadCount = records.isEmpty() ? settings->value("tabs/count",0).toInt() : records.count();
     QLOG_TRACE() << "ThreadHandler :: restoring Threads";
 
     ImageThread* it;
@@ -98,9 +168,15 @@ void ThreadHandler::restoreThreads() {
         for (int i=0; i<threadCount; i++) {
             it = addThread();
 
-            it->setValues(
-                    settings->value(QString("tabs/tab%1").arg(i), ";;;;0;;every 30 seconds;;0").toString()
-                    );
+            if (records.isEmpty()) {
+                // Session from settings.ini of an older version
+                it->setValues(
+                        settings->value(QString("tabs/tab%1").arg(i), ";;;;0;;every 30 seconds;;0").toString()
+                        );
+            }
+            else {
+                it->restoreSession(records.at(i));
+            }
             out << " opening " << it->getUrl() << "\n";
         }
     }
@@ -129,6 +205,13 @@ ImageThread* ThreadHandler::addThread() {
 void ThreadHandler::createThread(QString thread_settings) {
     ImageThread* it;
 
+    if (batchMode) {
+        // Threads found on an overview page wait for a free job slot
+        batchQueue.append(thread_settings);
+        startNextBatchThreads();
+        return;
+    }
+
     it = addThread();
     it->setValues(thread_settings);
     out << "Opening thread " << it->getUrl() << "\n";
@@ -167,7 +250,7 @@ void ThreadHandler::createSupervisedDownload(QUrl url) {
     }
 }
 
-void ThreadHandler::processRequestResponse(QUrl url, QByteArray ba, bool cached) {
+void ThreadHandler::processRequestResponse(const QUrl& url, const QByteArray& ba, bool cached) {
 
 }
 
@@ -190,5 +273,118 @@ void ThreadHandler::aboutToQuit() {
 }
 
 void ThreadHandler::processCloseRequest(ImageThread* it, int reason) {
+    if (batchMode) {
+        // Anything but a finished thread, a parser 404 included, is a failure
+        if (reason != 0)
+            QLOG_WARN() << "ThreadHandler :: Batch thread" << it->getUrl() << "closed, reason" << reason;
+        finishBatchThread(it, reason == 0);
+    }
+    else {
+        closeThread(it);
+    }
+}
+
+/**
+ * Download every thread listed in listFile (one URL per line, # starts a comment)
+ * into outDir, running at most jobs threads at once. The application exits with
+ * a throughput summary once the list is done.
+ */
+bool ThreadHandler::startBatch(QString listFile, int jobs, QString outDir) {
+    QFile f;
+    QString line;
+    QStringList values;
+
+    f.setFileName(listFile);
+    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QLOG_ERROR() << "ThreadHandler :: Could not open batch file " << listFile;
+        return false;
+    }
+
+    while (!f.atEnd()) {
+        line = QString::fromUtf8(f.readLine()).trimmed();
+        if (line.isEmpty() || line.startsWith("#"))
+            continue;
+
+        // url;;savepath;;rescan;;interval;;original filename;;running
+        values.clear();
+        values << line << outDir << "0" << "0" << "0" << "1";
+        batchQueue.append(values.join(";;"));
+    }
+    f.close();
+
+    if (batchQueue.isEmpty()) {
+        QLOG_ERROR() << "ThreadHandler :: Batch file " << listFile << " contains no URLs";
+        return false;
+    }
+
+    batchMode = true;
+    batchJobs = qMax(1, jobs);
+
+    out << "Batch: " << batchQueue.count() << " threads, " << batchJobs << " jobs, saving to " << outDir << "\n";
+    out.flush();
+
+    batchTimer.start();
+    downloadManager->resumeDownloads();
+    // Start from the event loop so that finishing early can still quit the application
+    QTimer::singleShot(0, this, SLOT(startNextBatchThreads()));
+
+    return true;
+}
+
+void ThreadHandler::startNextBatchThreads() {
+    ImageThread* it;
+
+    while (threadList.count() < batchJobs && !batchQueue.isEmpty()) {
+        it = addThread();
+        connect(it, SIGNAL(finished(ImageThread*)), this, SLOT(batchThreadFinished(ImageThread*)));
+        it->setValues(batchQueue.takeFirst());
+        out << "Opening thread " << it->getUrl() << "\n";
+        out.flush();
+
+        if (!it->isRunning()) {
+            // No parser or no save directory
+            finishBatchThread(it, false);
+        }
+    }
+}
+
+void ThreadHandler::batchThreadFinished(ImageThread* it) {
+    finishBatchThread(it, true);
+}
+
+void ThreadHandler::finishBatchThread(ImageThread* it, bool ok) {
+    if (!threadList.contains(it))
+        return;
+
+    batchImages += it->getSavedImagesCount();
+    batchBytes += it->getSavedBytes();
+    if (ok)
+        batchThreadsDone++;
+    else
+        batchThreadsFailed++;
+
     closeThread(it);
+
+    if (threadList.isEmpty() && batchQueue.isEmpty()) {
+        printBatchSummary();
+        QCoreApplication::exit(batchThreadsFailed > 0 ? 1 : 0);
+    }
+    else {
+        startNextBatchThreads();
+    }
+}
+
+void ThreadHandler::printBatchSummary() {
+    double seconds;
+
+    seconds = qMax((qint64)1, batchTimer.elapsed()) / 1000.0;
+
+    out << "\nBatch finished in " << QString::number(seconds, 'f', 1) << " s\n";
+    out << " threads: " << batchThreadsDone << " done, " << batchThreadsFailed << " failed ("
+        << QString::number((batchThreadsDone + batchThreadsFailed) * 60.0 / seconds, 'f', 1) << " threads/min)\n";
+    out << " images:  " << batchImages << " ("
+        << QString::number(batchImages / seconds, 'f', 2) << " images/s)\n";
+    out << " data:    " << QString::number(batchBytes / 1048576.0, 'f', 1) << " MB ("
+        << QString::number(batchBytes / 1048576.0 / seconds, 'f', 2) << " MB/s)\n";
+    out.flush();
 }
@@ -2,13 +2,14 @@
 #define THREADHANDLER_H
 
 #include <QObject>
+#include <QElapsedTimer>
 #include "imagethread.h"
 #include "applicationupdateinterface.h"
 #include "blacklist.h"
 #include "requesthandler.h"
 #include "thumbnailremover.h"
+#include "sessionstore.h"
 
-extern DownloadManager* downloadManager;
 extern QTextStream in;
 extern QTextStream out;
 
@@ -18,10 +19,13 @@ class ThreadHandler : public QObject
 public:
     explicit ThreadHandler(QObject *parent = 0);
     void restoreThreads();
+    void setMetricsFile(QString);
+    bool startBatch(QString listFile, int jobs, QString outDir);
 
 private:
     QList<ImageThread*> threadList;
     QSettings* settings;
+    chandl::SessionStore sessionStore;
     ApplicationUpdateInterface* aui;
     BlackList* blackList;
     bool autoClose;
@@ -30,6 +34,20 @@ private:
     QThread* thumbnailRemoverThread;
     ThumbnailRemover* thumbnailRemover;
     QTimer* autosaveTimer;
+    QTimer* metricsTimer;
+    QString metricsFile;
+
+    bool batchMode;
+    int batchJobs;
+    QStringList batchQueue;
+    QElapsedTimer batchTimer;
+    int batchThreadsDone;
+    int batchThreadsFailed;
+    qint64 batchImages;
+    qint64 batchBytes;
+
+    void finishBatchThread(ImageThread*, bool ok);
+    void printBatchSummary();
 
     void checkVersion(QString ver);
     void checkForUpdates(QString xml);
@@ -52,11 +70,16 @@ public slots:
     void processCloseRequest(ImageThread*, int);
     void startAll(void);
     void stopAll(void);
-    void processRequestResponse(QUrl url, QByteArray ba, bool cached);
+    void processRequestResponse(const QUrl& url, const QByteArray& ba, bool cached);
     void updaterConnected();
     void updateFinished();
     void setUpdaterVersion(QString);
     void aboutToQuit();
+    void dumpMetrics();
+
+private slots:
+    void startNextBatchThreads();
+    void batchThreadFinished(ImageThread*);
 
 signals:
     void removeFiles(QStringList);
@@ -2,4 +2,5 @@ TEMPLATE      = subdirs
 SUBDIRS       = gui\
                 plugins \
                 updater \
-                console
+                console \
+                bench
@@ -22,9 +22,9 @@
  */
 
 #include <QtCore/QtAlgorithms>
-#include <QtCore/QRegExp>
-#include <QtCore/QStringList>
-#include <QtCore/QtDebug>
+
+#include <algorithm>
+#include <cctype>
 
 #include "HtmlEntities.h"
 
@@ -51,11 +51,11 @@ const HtmlEntity HTML::first[FirstEntities] =
 const HtmlEntity HTML::entities[MaxEntities] =
 {
     { "AElig", 0x00c6 },
+    { "AMP", 38 },
     { "Aacute", 0x00c1 },
     { "Acirc", 0x00c2 },
     { "Agrave", 0x00c0 },
     { "Alpha", 0x0391 },
-    { "AMP", 38 },
     { "Aring", 0x00c5 },
     { "Atilde", 0x00c3 },
     { "Auml", 0x00c4 },
@@ -71,16 +71,16 @@ const HtmlEntity HTML::entities[MaxEntities] =
     { "Epsilon", 0x0395 },
     { "Eta", 0x0397 },
     { "Euml", 0x00cb },
-    { "Gamma", 0x0393 },
     { "GT", 62 },
+    { "Gamma", 0x0393 },
     { "Iacute", 0x00cd },
     { "Icirc", 0x00ce },
     { "Igrave", 0x00cc },
     { "Iota", 0x0399 },
     { "Iuml", 0x00cf },
     { "Kappa", 0x039a },
-    { "Lambda", 0x039b },
     { "LT", 60 },
+    { "Lambda", 0x039b },
     { "Mu", 0x039c },
     { "Ntilde", 0x00d1 },
     { "Nu", 0x039d },
@@ -268,10 +268,10 @@ const HtmlEntity HTML::entities[MaxEntities] =
     { "sub", 0x2282 },
     { "sube", 0x2286 },
     { "sum", 0x2211 },
+    { "sup", 0x2283 },
     { "sup1", 0x00b9 },
     { "sup2", 0x00b2 },
     { "sup3", 0x00b3 },
-    { "sup", 0x2283 },
     { "supe", 0x2287 },
     { "szlig", 0x00df },
     { "tau", 0x03c4 },
@@ -322,6 +322,40 @@ static bool operator == (const HtmlEntity &entity, const quint16 entityCode){
     return entityCode == entity.code;
 }
 
+
+// Compare le nom d'une entite avec les caracteres name[0..len[ sans
+// construire de QString.
+
+static int compareEntityName(const char* entity, const QChar* name, int len)
+{
+    int i;
+
+    for (i=0; i<len && entity[i] != 0; i++) {
+        if ((ushort)(uchar)entity[i] != name[i].unicode())
+            return (ushort)(uchar)entity[i] < name[i].unicode() ? -1 : 1;
+    }
+
+    if (i < len) return -1;
+    return entity[i] == 0 ? 0 : 1;
+}
+
+
+// Recherche dichotomique du nom "name" (len caracteres) dans les tables.
+
+const HtmlEntity* HTML::findEntity(const QChar* name, int len)
+{
+    const HtmlEntity* he;
+    auto less = [name, len](const HtmlEntity &entity, int) {
+        return compareEntityName(entity.name, name, len) < 0;
+    };
+
+    he = std::lower_bound(start_first, end_first, 0, less);
+    if (he != end_first && compareEntityName(he->name, name, len) == 0) return he;
+    he = std::lower_bound(start_ent, end_ent, 0, less);
+    if (he != end_ent && compareEntityName(he->name, name, len) == 0) return he;
+    return 0;
+}
+
 // Retourne le caractere associe a un caractere special HTML.
 
 QChar HTML::resolveEntity(const QString &entity)
@@ -358,38 +392,89 @@ QString HTML::resolveEntity(quint16 entityCode)
 // Decode une chaine de caractere utilisant des
 // caracteres speciaux d'HTML.
 
+// Un seul parcours de la chaine : les entites nommees (&amp;), decimales
+// (&#38;) et hexadecimales (&#x26;) sont ecrites dans un tampon reserve
+// d'avance. Les sequences inconnues sont recopiees telles quelles.
+
 void HTML::decodeStr(QString* str)
 {
-    int index = 0;
-    QChar decodedChar;
-    QStringList res;
-    QRegExp entityParser("(&([a-zA-Z]+);)",Qt::CaseInsensitive);
-    QRegExp directCharParser("(&#([0-9]+);)",Qt::CaseInsensitive);
-
-
-    qDebug() << "Checking" << *str;
-    while (index > -1) {
-        index = directCharParser.indexIn(*str,index+1);
-        res = directCharParser.capturedTexts();
-        if (index != -1) {
-            decodedChar = QChar(directCharParser.cap(2).toInt());
-            str->replace(res.at(1), decodedChar);
-            qDebug() << *str;
+    const QChar* in;
+    const HtmlEntity* he;
+    QString out;
+    int len, pos, semi, i;
+    uint code;
+    bool valid;
+
+    pos = str->indexOf(QLatin1Char('&'));
+    if (pos == -1) return;
+
+    in = str->constData();
+    len = str->size();
+    out.reserve(len);
+    out.append(in, pos);
+
+    while (pos < len) {
+        if (in[pos] != QLatin1Char('&')) {
+            for (i=pos; i<len && in[i] != QLatin1Char('&'); i++) ;
+            out.append(in+pos, i-pos);
+            pos = i;
+            continue;
         }
-    }
 
-    index = 0;
-    while((index = entityParser.indexIn(*str,index)) != -1)
-    {
-        index++;
-        decodedChar = resolveEntity(entityParser.cap(2));
-        qDebug() << "Decoding in " << entityParser.cap(1) << ":" << entityParser.cap(2) << " to " << decodedChar << "(" << decodedChar.isNull()<<")";
-        if (!decodedChar.isNull()) {
-            qDebug() << "Replacing in " << entityParser.cap(1) << ":" << entityParser.cap(2) << " to " << decodedChar;
-            str->replace(entityParser.cap(1),QString(decodedChar));
+        // Le nom le plus long ("thetasym") et "&#x10FFFF" tiennent en 10 caracteres
+        semi = -1;
+        for (i=pos+1; i<len && i<=pos+10; i++) {
+            if (in[i] == QLatin1Char(';')) {
+                semi = i;
+                break;
+            }
+            if (!in[i].isLetterOrNumber() && in[i] != QLatin1Char('#')) break;
+        }
+
+        valid = false;
+        code = 0;
+        if (semi > pos+1) {
+            if (in[pos+1] == QLatin1Char('#')) {
+                i = pos+2;
+                if (i < semi && (in[i] == QLatin1Char('x') || in[i] == QLatin1Char('X'))) {
+                    for (i++, valid = (i < semi); i<semi && valid; i++) {
+                        valid = (in[i].unicode() < 128 && isxdigit(in[i].unicode()));
+                        if (valid) code = code*16 + (isdigit(in[i].unicode()) ? in[i].unicode()-'0' : (in[i].unicode()|0x20)-'a'+10);
+                    }
+                }
+                else {
+                    for (valid = (i < semi); i<semi && valid; i++) {
+                        valid = (in[i].unicode() >= '0' && in[i].unicode() <= '9');
+                        if (valid) code = code*10 + (in[i].unicode()-'0');
+                    }
+                }
+                valid = valid && code > 0 && code <= 0x10FFFF;
+            }
+            else {
+                he = findEntity(in+pos+1, semi-pos-1);
+                if (he != 0) {
+                    valid = true;
+                    code = he->code;
+                }
+            }
+        }
+
+        if (valid) {
+            if (QChar::requiresSurrogates(code)) {
+                out.append(QChar(QChar::highSurrogate(code)));
+                out.append(QChar(QChar::lowSurrogate(code)));
+            }
+            else {
+                out.append(QChar((ushort)code));
+            }
+            pos = semi+1;
+        }
+        else {
+            out.append(in[pos++]);
         }
     }
 
+    str->swap(out);
 }
 
 
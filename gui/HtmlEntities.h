@@ -75,6 +75,8 @@ class HTML
     static const HtmlEntity* end_first;
     static const HtmlEntity* start_first;
 
+    static const HtmlEntity* findEntity(const QChar* name, int len);
+
 };
 
 #endif
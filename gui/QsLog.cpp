@@ -27,6 +27,9 @@
 #include "QsLogDest.h"
 #include <QMutex>
 #include <QList>
+#include <atomic>
+#include <memory>
+#include <vector>
 #include <QDateTime>
 #include <QtGlobal>
 #include <cassert>
@@ -71,20 +74,24 @@ static const char* LevelToText(Level theLevel)
    }
 }
 
+//! The destination list is copied on every addDestination() and published
+//! through an atomic pointer, so writers never take a lock. Replaced lists
+//! are kept until the logger goes away, a writer may still be iterating them.
 class LoggerImpl
 {
 public:
    LoggerImpl() :
-      level(InfoLevel)
+      destList(nullptr)
    {
-
    }
-   QMutex logMutex;
-   Level level;
-   DestinationList destList;
+
+   QMutex setupMutex;
+   std::atomic<const DestinationList*> destList;
+   std::vector<std::unique_ptr<const DestinationList>> lists;
 };
 
 Logger::Logger() :
+   level(InfoLevel),
    d(new LoggerImpl)
 {
 }
@@ -97,17 +104,19 @@ Logger::~Logger()
 void Logger::addDestination(DestinationPtr destination)
 {
    assert(destination);
-   d->destList.push_back(destination);
-}
 
-void Logger::setLoggingLevel(Level newLevel)
-{
-   d->level = newLevel;
+   QMutexLocker lock(&d->setupMutex);
+   const DestinationList* current = d->destList.load(std::memory_order_relaxed);
+   DestinationList* list = current ? new DestinationList(*current) : new DestinationList;
+
+   list->push_back(destination);
+   d->lists.emplace_back(list);
+   d->destList.store(list, std::memory_order_release);
 }
 
-Level Logger::loggingLevel() const
+void Logger::setLoggingLevel(Level newLevel)
 {
-   return d->level;
+   level.store(newLevel, std::memory_order_relaxed);
 }
 
 //! creates the complete log message and passes it to the logger
@@ -120,9 +129,7 @@ void Logger::Helper::writeToLog()
       .arg(buffer)
       );
 
-   Logger& logger = Logger::instance();
-   QMutexLocker lock(&logger.d->logMutex);
-   logger.write(completeMessage);
+   Logger::instance().write(completeMessage);
 }
 
 Logger::Helper::~Helper()
@@ -139,11 +146,16 @@ Logger::Helper::~Helper()
    }
 }
 
-//! sends the message to all the destinations
+//! sends the message to all the destinations, the destinations synchronize
+//! themselves
 void Logger::write(const QString& message)
 {
-   for(DestinationList::iterator it = d->destList.begin(),
-       endIt = d->destList.end();it != endIt;++it)
+   const DestinationList* destList = d->destList.load(std::memory_order_acquire);
+   if( !destList )
+      return;
+
+   for(DestinationList::const_iterator it = destList->begin(),
+       endIt = destList->end();it != endIt;++it)
    {
       if( !(*it) )
       {
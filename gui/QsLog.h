@@ -26,6 +26,7 @@
 #ifndef QSLOG_H
 #define QSLOG_H
 
+#include <atomic>
 #include <memory>
 
 #include <QDebug>
@@ -57,11 +58,16 @@ public:
    }
 
    //! Adds a log message destination. Don't add null destinations.
+   //! Meant for the setup, every call copies the destination list.
    void addDestination(DestinationPtr destination);
    //! Logging at a level < 'newLevel' will be ignored
    void setLoggingLevel(Level newLevel);
-   //! The default level is INFO
-   Level loggingLevel() const;
+   //! The default level is INFO. Inline so the macros can skip disabled
+   //! messages before any of their arguments are evaluated.
+   Level loggingLevel() const
+   {
+      return static_cast<Level>(level.load(std::memory_order_relaxed));
+   }
 
    //! The helper forwards the streaming to QDebug and builds the final
    //! log message.
@@ -90,6 +96,7 @@ private:
 
    void write(const QString& message);
 
+   std::atomic<int> level;
    LoggerImpl* d;
 };
 
@@ -28,6 +28,13 @@
 #include <QFile>
 #include <QTextStream>
 #include <QString>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <vector>
+#include <cassert>
+#include <cstdint>
 
 namespace QsLogging
 {
@@ -40,6 +47,7 @@ public:
    virtual void write(const QString& message);
 
 private:
+   QMutex mMutex;
    QFile mFile;
    QTextStream mOutputStream;
 };
@@ -54,10 +62,175 @@ FileDestination::FileDestination(const QString& filePath)
 
 void FileDestination::write(const QString& message)
 {
+   QMutexLocker lock(&mMutex);
    mOutputStream << message << endl;
    mOutputStream.flush();
 }
 
+//! bounded multi-producer queue (D. Vyukov's algorithm), no locks on push or pop
+class MessageRingBuffer
+{
+public:
+   explicit MessageRingBuffer(size_t size);
+
+   bool push(const QString& message);
+   bool pop(QString& message);
+
+private:
+   struct Cell
+   {
+      std::atomic<size_t> sequence;
+      QString message;
+   };
+
+   std::vector<Cell> mCells;
+   const size_t mMask;
+   std::atomic<size_t> mEnqueuePos;
+   std::atomic<size_t> mDequeuePos;
+};
+
+MessageRingBuffer::MessageRingBuffer(size_t size) :
+   mCells(size),
+   mMask(size - 1),
+   mEnqueuePos(0),
+   mDequeuePos(0)
+{
+   // size has to be a power of two
+   assert(size >= 2 && (size & (size - 1)) == 0);
+   for( size_t i = 0;i < size;++i )
+      mCells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+bool MessageRingBuffer::push(const QString& message)
+{
+   Cell* cell;
+   size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+
+   for( ;; )
+   {
+      cell = &mCells[pos & mMask];
+      const size_t seq = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+      if( diff == 0 )
+      {
+         if( mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed) )
+            break;
+      }
+      else if( diff < 0 )
+         return false; // full
+      else
+         pos = mEnqueuePos.load(std::memory_order_relaxed);
+   }
+
+   cell->message = message;
+   cell->sequence.store(pos + 1, std::memory_order_release);
+   return true;
+}
+
+bool MessageRingBuffer::pop(QString& message)
+{
+   Cell* cell;
+   size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+
+   for( ;; )
+   {
+      cell = &mCells[pos & mMask];
+      const size_t seq = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+
+      if( diff == 0 )
+      {
+         if( mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed) )
+            break;
+      }
+      else if( diff < 0 )
+         return false; // empty
+      else
+         pos = mDequeuePos.load(std::memory_order_relaxed);
+   }
+
+   message = std::move(cell->message);
+   cell->message = QString();
+   cell->sequence.store(pos + mMask + 1, std::memory_order_release);
+   return true;
+}
+
+//! file sink that hands the actual writing to a background thread
+class AsyncFileDestination : public Destination, private QThread
+{
+public:
+   AsyncFileDestination(const QString& filePath);
+   ~AsyncFileDestination();
+   virtual void write(const QString& message);
+
+private:
+   void run() override;
+
+   FileDestination mFile;
+   MessageRingBuffer mQueue;
+   std::atomic<bool> mStopped;
+   std::atomic<int> mDropped;
+   std::atomic<bool> mSleeping;
+   QMutex mWaitMutex;
+   QWaitCondition mMessagesAvailable;
+};
+
+AsyncFileDestination::AsyncFileDestination(const QString& filePath) :
+   mFile(filePath),
+   mQueue(8192),
+   mStopped(false),
+   mDropped(0),
+   mSleeping(false)
+{
+   start(QThread::LowPriority);
+}
+
+AsyncFileDestination::~AsyncFileDestination()
+{
+   mStopped = true;
+   mMessagesAvailable.wakeAll();
+   wait();
+}
+
+void AsyncFileDestination::write(const QString& message)
+{
+   if( !mQueue.push(message) )
+      ++mDropped;
+   else if( mSleeping.load(std::memory_order_relaxed) )
+      mMessagesAvailable.wakeOne();
+}
+
+void AsyncFileDestination::run()
+{
+   QString message;
+   bool stopping;
+
+   for( ;; )
+   {
+      // Read the flag first so everything queued before stopping gets written
+      stopping = mStopped;
+
+      while( mQueue.pop(message) )
+         mFile.write(message);
+
+      const int dropped = mDropped.exchange(0);
+      if( dropped > 0 )
+         mFile.write(QString("WARN :: log buffer full, %1 messages dropped").arg(dropped));
+
+      if( stopping )
+         break;
+
+      // Writers only wake us while we sleep and without the mutex held, the
+      // timeout covers a message pushed just before mSleeping was set
+      mWaitMutex.lock();
+      mSleeping = true;
+      mMessagesAvailable.wait(&mWaitMutex, 100);
+      mSleeping = false;
+      mWaitMutex.unlock();
+   }
+}
+
 //! debugger sink
 class DebugOutputDestination : public Destination
 {
@@ -75,6 +248,11 @@ DestinationPtr DestinationFactory::MakeFileDestination(const QString& filePath)
    return std::make_shared<FileDestination>(filePath);
 }
 
+DestinationPtr DestinationFactory::MakeAsyncFileDestination(const QString& filePath)
+{
+   return std::make_shared<AsyncFileDestination>(filePath);
+}
+
 DestinationPtr DestinationFactory::MakeDebugOutputDestination()
 {
    return std::make_shared<DebugOutputDestination>();
@@ -32,6 +32,8 @@ class QString;
 namespace QsLogging
 {
 
+//! Destinations are called from any thread without a lock held, each one
+//! has to be thread-safe on its own.
 class Destination
 {
 public:
@@ -45,7 +47,13 @@ using DestinationPtr = std::shared_ptr<Destination> ;
 class DestinationFactory
 {
 public:
+   //! Writes and flushes on the calling thread, callers wait for each other.
    static DestinationPtr MakeFileDestination(const QString& filePath);
+   //! Queues messages in a lock-free ring buffer and writes them to the file
+   //! from a background thread. Messages are dropped (and counted) when the
+   //! buffer is full instead of blocking the caller. The writer thread is
+   //! only woken while it sleeps, a busy writer picks up new messages itself.
+   static DestinationPtr MakeAsyncFileDestination(const QString& filePath);
    static DestinationPtr MakeDebugOutputDestination();
 };
 
@@ -57,12 +57,12 @@ namespace chandl {
 
     const QString sLogPath(QDir(applicationDirPath()).filePath("fourchan-dl.log"));
 
-    auto fileDestination = QsLogging::DestinationFactory::MakeFileDestination(sLogPath);
-    auto debugDestination = QsLogging::DestinationFactory::MakeDebugOutputDestination();
-    logger.addDestination(debugDestination);
+    auto fileDestination = QsLogging::DestinationFactory::MakeAsyncFileDestination(sLogPath);
     logger.addDestination(fileDestination);
 
 #ifdef __DEBUG__
+    // Synchronous, every message waits for the debugger or stderr
+    logger.addDestination(QsLogging::DestinationFactory::MakeDebugOutputDestination());
     logger.setLoggingLevel(QsLogging::TraceLevel);
 #else
     logger.setLoggingLevel(QsLogging::WarnLevel);
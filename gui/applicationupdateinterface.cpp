@@ -3,36 +3,75 @@
 ApplicationUpdateInterface::ApplicationUpdateInterface(QObject *parent) :
     QObject(parent)
 {
-    udpSocket = new QUdpSocket();
-    pinging = false;
+    server = new QLocalServer(this);
+    socket = 0;
     connected = false;
-    answerPing = false;
     startRequest = false;
 
     fileToMoveFrom = "";
     fileToMoveTo = "";
     filesToMove.clear();
 
-    auto port = settings.getUpdaterAppPort();
-    if (!udpSocket->bind(port)) {
-        QLOG_ERROR() << "ApplicationUpdateInterface :: " << "Could not create socket on port " << port << "(" << udpSocket->errorString() << ")";
+    serverName = ipcServerName();
+    if (!server->listen(serverName)) {
+        QLocalSocket probe;
+
+        // Only a name nobody answers on is stale, i.e. left behind by an instance that did not shut down cleanly
+        probe.connectToServer(serverName);
+        if (probe.waitForConnected(1000)) {
+            probe.abort();
+            QLOG_WARN() << "ApplicationUpdateInterface :: " << "Another instance is listening on " << serverName;
+        }
+        else if (probe.error() == QLocalSocket::ConnectionRefusedError
+                 || probe.error() == QLocalSocket::ServerNotFoundError) {
+            QLocalServer::removeServer(serverName);
+            server->listen(serverName);
+        }
+
+        if (!server->isListening()) {
+            QLOG_ERROR() << "ApplicationUpdateInterface :: " << "Could not listen on " << serverName << "(" << server->errorString() << ")";
+        }
     }
 
-    connect(udpSocket, SIGNAL(readyRead()), this, SLOT(readPendingDatagrams()));
+    connect(server, SIGNAL(newConnection()), this, SLOT(acceptConnection()));
     connect(this, SIGNAL(connectionEstablished()), this, SLOT(init()));
 }
 
-void ApplicationUpdateInterface::readPendingDatagrams() {
-    while (udpSocket->hasPendingDatagrams()) {
-        QByteArray datagram;
-        datagram.resize(udpSocket->pendingDatagramSize());
-        QHostAddress sender;
-        quint16 senderPort;
+void ApplicationUpdateInterface::acceptConnection() {
+    while (server->hasPendingConnections()) {
+        if (socket != 0) {
+            // Only one updater at a time, the newest one wins
+            socket->disconnect(this);
+            socket->deleteLater();
+        }
+
+        socket = server->nextPendingConnection();
+        buffer.clear();
+
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readCommands()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(updaterDisconnected()));
+
+        connected = true;
+        emit connectionEstablished();
+    }
+}
+
+void ApplicationUpdateInterface::updaterDisconnected() {
+    connected = false;
+
+    if (socket != 0) {
+        socket->deleteLater();
+        socket = 0;
+    }
+}
+
+void ApplicationUpdateInterface::readCommands() {
+    QByteArray command;
 
-        udpSocket->readDatagram(datagram.data(), datagram.size(),
-                                &sender, &senderPort);
+    buffer.append(socket->readAll());
 
-        processCommand(datagram);
+    while (takeCommand(&buffer, &command)) {
+        processCommand(command);
     }
 }
 
@@ -45,18 +84,10 @@ void ApplicationUpdateInterface::processCommand(QByteArray a) {
 
     switch (command) {
     case PING:
-            writeCommand(PONG);
-
-            if (!connected) {
-                connected = true;
-                emit connectionEstablished();
-            }
+        writeCommand(PONG);
         break;
     case PONG:
-        if (pinging)
-            pinging=false;
-        else
-            writeCommand(ERROR_CMD);
+        break;
 
     case CLOSE_REQUEST:
         exit(0);
@@ -134,11 +165,10 @@ void ApplicationUpdateInterface::init() {
 }
 
 void ApplicationUpdateInterface::writeCommand(int c, QByteArray a) {
-    udpSocket->writeDatagram(
-            createCommand(c, a),
-            QHostAddress(HOST_ADDRESS),
-            settings.getUpdaterPort()
-            );
+    if (socket != 0) {
+        socket->write(createCommand(c, a));
+        socket->flush();
+    }
 }
 
 void ApplicationUpdateInterface::writeCommand(int c, QString s) {
@@ -149,10 +179,12 @@ void ApplicationUpdateInterface::writeCommand(int c) {
     writeCommand(c, QByteArray());
 }
 
-void ApplicationUpdateInterface::addFile(QString url, QString loc) {
+void ApplicationUpdateInterface::addFile(QString url, QString loc, QString sha256) {
     if (connected) {
         writeCommand(SET_URI, url);
         writeCommand(SET_TARGET, loc);
+        if (!sha256.isEmpty())
+            writeCommand(SET_CHECKSUM, sha256);
         writeCommand(ADD_SET);
     }
 }
@@ -162,7 +194,7 @@ void ApplicationUpdateInterface::addFiles(QStringList list) {
         QStringList sl;
 
         sl = set.split("->");
-        addFile(sl.at(0), sl.at(1));
+        addFile(sl.at(0), sl.at(1), sl.value(2));
     }
 }
 
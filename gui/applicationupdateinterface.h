@@ -6,7 +6,8 @@
 #include <QObject>
 #include <QCoreApplication>
 #include <QByteArray>
-#include <QtNetwork/QUdpSocket>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
 #include <QDir>
 #include <QSettings>
 #include <QUuid>
@@ -15,7 +16,6 @@
 #include <QMessageBox>
 #endif
 
-#include "appsettings.h"
 #include "../updater/commands.h"
 #include "defines.h"
 #include "QsLog.h"
@@ -26,20 +26,20 @@ class ApplicationUpdateInterface : public QObject
 public:
     explicit ApplicationUpdateInterface(QObject *parent = 0);
     void startUpdate();
-    void addFile(QString url, QString loc);
+    void addFile(QString url, QString loc, QString sha256="");
     void addFiles(QStringList list);
     void closeUpdaterExe();
     void exchangeFiles();
 private:
-    QUdpSocket* udpSocket;
-    bool pinging;
-    bool answerPing;
+    QLocalServer* server;
+    QString serverName;
+    QLocalSocket* socket;
+    QByteArray buffer;
     bool connected;
     bool startRequest;
     QString version;
     QString fileToMoveFrom, fileToMoveTo;
     QHash<QString,QString> filesToMove;
-    chandl::AppSettings settings;
 
     void processCommand(QByteArray a);
     void writeCommand(int c, QByteArray a);
@@ -47,7 +47,9 @@ private:
     void writeCommand(int c);
 
 private slots:
-    void readPendingDatagrams(void);
+    void acceptConnection(void);
+    void readCommands(void);
+    void updaterDisconnected(void);
     void init();
 
 signals:
@@ -140,6 +140,16 @@ namespace chandl {
     settings.setValue("options/close_overview_threads", value);
   }
 
+  bool AppSettings::getWatchBoards(bool def) const
+  {
+    return settings.value("options/watch_boards", def).toBool();
+  }
+
+  void AppSettings::setWatchBoards(bool value)
+  {
+    settings.setValue("options/watch_boards", value);
+  }
+
   bool AppSettings::getUseInternalViewer(bool def) const
   {
     return settings.value("options/use_internal_viewer", def).toBool();
@@ -282,26 +292,6 @@ namespace chandl {
     settings.setValue("options/log_level", value);
   }
 
-  int AppSettings::getUpdaterPort(int def) const
-  {
-    return settings.value("updater/updater_port", def).toInt();
-  }
-
-  void AppSettings::setUpdaterPort(int value)
-  {
-    settings.setValue("updater/updater_port", value);
-  }
-
-  int AppSettings::getUpdaterAppPort(int def) const
-  {
-    return settings.value("updater/application_port", def).toInt();
-  }
-
-  void AppSettings::setUpdaterAppPort(int value)
-  {
-    settings.setValue("updater/application_port", value);
-  }
-
   QString AppSettings::getUpdaterVersion(QString def) const
   {
     return settings.value("updater/version", def).toString();
@@ -536,6 +526,26 @@ namespace chandl {
     settings.setValue("imageviewer/slideshow_pause", value);
   }
 
+  int AppSettings::getViewerPrefetch(int def) const
+  {
+    return settings.value("imageviewer/prefetch", def).toInt();
+  }
+
+  void AppSettings::setViewerPrefetch(int value)
+  {
+    settings.setValue("imageviewer/prefetch", value);
+  }
+
+  int AppSettings::getViewerCacheSize(int def) const
+  {
+    return settings.value("imageviewer/cache_size", def).toInt();
+  }
+
+  void AppSettings::setViewerCacheSize(int value)
+  {
+    settings.setValue("imageviewer/cache_size", value);
+  }
+
   bool AppSettings::getThreadOverviewVisible(bool def) const
   {
     return settings.value("thread_overview/visible", def).toBool();
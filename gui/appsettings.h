@@ -46,6 +46,9 @@ namespace chandl {
     bool getCloseOverviewThreads(bool def = true) const;
     void setCloseOverviewThreads(bool value);
 
+    bool getWatchBoards(bool def = true) const;
+    void setWatchBoards(bool value);
+
     bool getUseInternalViewer(bool def = true) const;
     void setUseInternalViewer(bool value);
 
@@ -88,12 +91,6 @@ namespace chandl {
     int getLogLevel(int def = 3) const;
     void setLogLevel(int value);
 
-    int getUpdaterPort(int def = 60000) const;
-    void setUpdaterPort(int value);
-
-    int getUpdaterAppPort(int def = 60001) const;
-    void setUpdaterAppPort(int value);
-
     QString getUpdaterVersion(QString def = "unknown") const;
     void setUpdaterVersion(QString value);
 
@@ -163,6 +160,12 @@ namespace chandl {
     int getViewerSlideshowPause(int def = 3) const;
     void setViewerSlideshowPause(int value);
 
+    int getViewerPrefetch(int def = 2) const;
+    void setViewerPrefetch(int value);
+
+    int getViewerCacheSize(int def = 256) const;
+    void setViewerCacheSize(int value);
+
     bool getThreadOverviewVisible(bool def = true) const;
     void setThreadOverviewVisible(bool value);
 
@@ -0,0 +1,275 @@
+#include "boardwatchengine.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegExp>
+#include <QStringList>
+
+BoardWatchEngine::BoardWatchEngine(
+  std::shared_ptr<DownloadManager> downloadManager_,
+  std::shared_ptr<PluginManager> pluginManager_,
+  QObject *parent) :
+    QObject(parent),
+    downloadManager(downloadManager_),
+    pluginManager(pluginManager_)
+{
+    requestHandler = new RequestHandler(downloadManager, this);
+    blackList = 0;
+
+    timer = new QTimer(this);
+    timer->setInterval(60*1000);
+
+    _originalFilenames = false;
+    _running = false;
+
+    connect(requestHandler, SIGNAL(responseError(QUrl, int)), this, SLOT(errorHandler(QUrl, int)));
+    connect(requestHandler, SIGNAL(response(QUrl, QByteArray, bool)), this, SLOT(processRequestResponse(QUrl, QByteArray, bool)));
+    connect(timer, SIGNAL(timeout()), this, SLOT(poll()));
+}
+
+BoardWatchEngine::~BoardWatchEngine() {
+    stop();
+}
+
+void BoardWatchEngine::setPollInterval(int seconds) {
+    if (seconds > 0)
+        timer->setInterval(seconds*1000);
+}
+
+QUrl BoardWatchEngine::catalogUrl(QUrl url) {
+    QRegExp rx("^/([^/]+)/", Qt::CaseInsensitive, QRegExp::RegExp2);
+    QString host;
+    bool supported;
+    QUrl ret;
+
+    // Whole labels only, not4chan.org is not 4chan
+    host = url.host().toLower();
+    supported = false;
+    foreach (QString domain, QStringList() << "4chan.org" << "4channel.org") {
+        if (host == domain || host.endsWith("." + domain))
+            supported = true;
+    }
+
+    if (supported && rx.indexIn(url.path()) != -1 && !url.path().contains("/thread/")) {
+        ret = QUrl(QString("https://a.4cdn.org/%1/threads.json").arg(rx.cap(1)));
+    }
+
+    return ret;
+}
+
+QUrl BoardWatchEngine::threadUrl(qint64 no) {
+    QString board;
+    QString host;
+
+    // On the host the board was given with, so 4channel.org boards stay there
+    board = catalog.path().section('/', 1, 1);
+    host = QUrl(_url).host();
+
+    return QUrl(QString("https://%1/%2/thread/%3").arg(host).arg(board).arg(no));
+}
+
+bool BoardWatchEngine::start() {
+    bool ret;
+
+    ret = false;
+    catalog = catalogUrl(QUrl(_url));
+
+    if (catalog.isValid()) {
+        _running = true;
+        poll();
+        timer->start();
+        ret = true;
+    }
+    else {
+        emit errorMessage("Board watching is not supported for " + _url);
+    }
+
+    return ret;
+}
+
+void BoardWatchEngine::stop() {
+    _running = false;
+    timer->stop();
+    requestHandler->cancelAll();
+
+    // Includes retired threads that are still finishing their downloads
+    foreach (ThreadDownloadEngine* job, findChildren<ThreadDownloadEngine*>()) {
+        job->stop();
+        job->deleteLater();
+    }
+    jobs.clear();
+    lastModified.clear();
+}
+
+void BoardWatchEngine::poll() {
+    if (_running) {
+        emit statusChanged("Checking board");
+        requestHandler->request(catalog, 10, true);
+    }
+}
+
+bool BoardWatchEngine::parseCatalog(const QByteArray& ba, QHash<qint64, qint64>* threads) {
+    QJsonParseError error;
+    QJsonDocument doc;
+
+    doc = QJsonDocument::fromJson(ba, &error);
+    if (error.error != QJsonParseError::NoError || !doc.isArray()) {
+        QLOG_ERROR() << "BoardWatchEngine :: Cannot parse thread list of" << _url << ":" << error.errorString();
+        return false;
+    }
+
+    // [{"page":1,"threads":[{"no":123,"last_modified":1400000000,"replies":5}, ...]}, ...]
+    foreach (const QJsonValue& page, doc.array()) {
+        foreach (const QJsonValue& thread, page.toObject().value("threads").toArray()) {
+            QJsonObject o = thread.toObject();
+            qint64 no = static_cast<qint64>(o.value("no").toDouble());
+
+            if (no > 0)
+                threads->insert(no, static_cast<qint64>(o.value("last_modified").toDouble()));
+        }
+    }
+
+    return true;
+}
+
+void BoardWatchEngine::processRequestResponse(const QUrl& url, const QByteArray& ba, bool cached) {
+    QHash<qint64, qint64> threads;
+    int added, refreshed, retired;
+
+    Q_UNUSED(url);
+    Q_UNUSED(cached);
+
+    if (!_running)
+        return;
+
+    if (ba.isEmpty()) {
+        // Not modified since the last poll
+        emit statusChanged(QString("Watching %1 threads").arg(jobs.count()));
+        return;
+    }
+
+    if (!parseCatalog(ba, &threads))
+        return;
+
+    added = refreshed = retired = 0;
+
+    foreach (qint64 no, lastModified.keys()) {
+        if (!threads.contains(no)) {
+            retireThread(no);
+            retired++;
+        }
+    }
+
+    QHashIterator<qint64, qint64> it(threads);
+    while (it.hasNext()) {
+        it.next();
+
+        if (!lastModified.contains(it.key())) {
+            addThread(it.key());
+            added++;
+        }
+        else if (lastModified.value(it.key()) != it.value()) {
+            if (jobs.contains(it.key()))
+                jobs.value(it.key())->startDownload();
+            refreshed++;
+        }
+        lastModified.insert(it.key(), it.value());
+    }
+
+    QLOG_INFO() << "BoardWatchEngine ::" << _url << ":" << added << "new," << refreshed << "changed," << retired << "retired threads";
+    emit statusChanged(QString("Watching %1 threads").arg(jobs.count()));
+    updateProgress();
+}
+
+void BoardWatchEngine::addThread(qint64 no) {
+    ThreadDownloadEngine* job;
+
+    job = new ThreadDownloadEngine(downloadManager, pluginManager, this);
+    job->setUrl(threadUrl(no).toString());
+    job->setSavepath(_savepath);
+    job->setOriginalFilenames(_originalFilenames);
+    job->setBlackList(blackList);
+    // Rescans are driven by the thread list, not by a timer per thread
+    job->setRescanInterval(0);
+
+    connect(job, SIGNAL(progressChanged(int,int)), this, SLOT(updateProgress()));
+    connect(job, SIGNAL(closeRequest(int)), this, SLOT(jobClosed()));
+
+    jobs.insert(no, job);
+
+    if (job->start())
+        emit threadAdded(threadUrl(no));
+}
+
+void BoardWatchEngine::retireThread(qint64 no) {
+    ThreadDownloadEngine* job;
+
+    lastModified.remove(no);
+    job = jobs.take(no);
+
+    if (job != 0) {
+        // Images found before the thread dropped off the list are still fetched
+        disconnect(job, 0, this, 0);
+        if (job->isDownloadFinished()) {
+            job->stop();
+            job->deleteLater();
+        }
+        else {
+            connect(job, SIGNAL(finished()), job, SLOT(deleteLater()));
+            connect(job, SIGNAL(closeRequest(int)), job, SLOT(deleteLater()));
+        }
+        emit threadRetired(threadUrl(no));
+    }
+}
+
+void BoardWatchEngine::jobClosed() {
+    ThreadDownloadEngine* job;
+
+    job = qobject_cast<ThreadDownloadEngine*>(sender());
+    if (job != 0) {
+        // Keep the thread number in lastModified so it is not picked up again
+        qint64 no = jobs.key(job, 0);
+        if (no != 0) {
+            jobs.remove(no);
+            job->deleteLater();
+            emit threadRetired(threadUrl(no));
+            updateProgress();
+        }
+    }
+}
+
+void BoardWatchEngine::errorHandler(QUrl url, int err) {
+    QLOG_WARN() << "BoardWatchEngine :: Could not get thread list" << url.toString() << "(" << err << ")";
+
+    if (err == 999) {
+        emit errorMessage("You are banned");
+    }
+    else {
+        emit statusChanged("Error");
+    }
+}
+
+int BoardWatchEngine::totalImages() const {
+    int ret;
+
+    ret = 0;
+    foreach (ThreadDownloadEngine* job, jobs)
+        ret += job->totalImages();
+
+    return ret;
+}
+
+int BoardWatchEngine::downloadedImages() const {
+    int ret;
+
+    ret = 0;
+    foreach (ThreadDownloadEngine* job, jobs)
+        ret += job->downloadedImages();
+
+    return ret;
+}
+
+void BoardWatchEngine::updateProgress() {
+    emit progressChanged(downloadedImages(), totalImages());
+}
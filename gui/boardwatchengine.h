@@ -0,0 +1,88 @@
+#ifndef BOARDWATCHENGINE_H
+#define BOARDWATCHENGINE_H
+
+#include <QObject>
+#include <QTimer>
+#include <QHash>
+#include <QUrl>
+
+#include <memory>
+
+#include "blacklist.h"
+#include "downloadmanager.h"
+#include "pluginmanager.h"
+#include "requesthandler.h"
+#include "threaddownloadengine.h"
+
+/**
+ * Watches a whole board: polls the board's thread list with conditional
+ * requests and keeps one headless ThreadDownloadEngine per listed thread.
+ * Threads are only fetched again when their last_modified changed and are
+ * retired once they drop off the list. Works with boards that offer the
+ * 4chan read-only API (threads.json).
+ */
+class BoardWatchEngine : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BoardWatchEngine(
+      std::shared_ptr<DownloadManager> downloadManager_,
+      std::shared_ptr<PluginManager> pluginManager_,
+      QObject *parent = nullptr);
+    ~BoardWatchEngine();
+
+    void setUrl(QString url) {_url = url;}
+    QString url() const {return _url;}
+    void setSavepath(QString path) {_savepath = path;}
+    void setOriginalFilenames(bool b) {_originalFilenames = b;}
+    void setPollInterval(int seconds);
+    void setBlackList(BlackList* bl) {blackList = bl;}
+
+    bool start();
+    void stop();
+    bool isRunning() const {return _running;}
+
+    int threadCount() const {return jobs.count();}
+    int totalImages() const;
+    int downloadedImages() const;
+
+    // Thread list of the board behind url; invalid if the board has none
+    static QUrl catalogUrl(QUrl url);
+
+private:
+    std::shared_ptr<DownloadManager> downloadManager;
+    std::shared_ptr<PluginManager> pluginManager;
+    RequestHandler* requestHandler;
+    BlackList* blackList;
+    QTimer* timer;
+
+    QUrl catalog;
+    QHash<qint64, qint64> lastModified;             // thread number -> last_modified
+    QHash<qint64, ThreadDownloadEngine*> jobs;      // thread number -> engine
+
+    QString _url;
+    QString _savepath;
+    bool _originalFilenames;
+    bool _running;
+
+    bool parseCatalog(const QByteArray& ba, QHash<qint64, qint64>* threads);
+    QUrl threadUrl(qint64 no);
+    void addThread(qint64 no);
+    void retireThread(qint64 no);
+
+private slots:
+    void poll();
+    void processRequestResponse(const QUrl& url, const QByteArray& ba, bool cached);
+    void errorHandler(QUrl url, int err);
+    void jobClosed();
+    void updateProgress();
+
+signals:
+    void statusChanged(QString);
+    void errorMessage(QString);
+    void progressChanged(int downloaded, int total);
+    void threadAdded(QUrl);
+    void threadRetired(QUrl);
+};
+
+#endif // BOARDWATCHENGINE_H
@@ -1,32 +1,36 @@
 ﻿#ifndef DOWNLOADMANAGER_H
 #define DOWNLOADMANAGER_H
 
-//#include <QThread>
+#include <atomic>
+
 #include <QObject>
 #include <QUrl>
-#include <QtNetwork>
-#include <QSettings>
+#include <QHash>
+#include <QThread>
+#include <QPointer>
 
-#include "appsettings.h"
 #include "requesthandler.h"
-#include "supervisednetworkreply.h"
-#include "downloadrequest.h"
-#include "networkaccessmanager.h"
+#include "downloadworker.h"
+#include "downloadmetrics.h"
 #include "QsLog.h"
 
 class RequestHandler;
-class DownloadRequest;
 
+/**
+ * Front end of the download machinery. Lives in the main thread and forwards
+ * every request to a DownloadWorker running in its own network thread, so that
+ * replies, cache files and supervision timers never compete with the UI.
+ * Responses are handed back to the RequestHandlers in the main thread.
+ */
 class DownloadManager : public QObject
 {
     Q_OBJECT
 public:
     explicit DownloadManager(QObject *parent = 0);
-    QByteArray getByteArray(qint64);
-    bool cached(qint64);
-    void freeRequest(qint64);
+    ~DownloadManager();
+
+    qint64 requestDownload(RequestHandler* caller, QUrl url, int prio=0, bool conditional=false);
     void removeRequest(qint64);
-    qint64 requestDownload(RequestHandler* caller, QUrl url, int prio=0);
 
     int getStatisticsFiles() const;
     float getStatisticsKBytes() const;
@@ -35,66 +39,39 @@ public:
     int getRunningRequests();
     int getTotalRequests();
     int getFinishedRequests();
+    int getOpenedConnections();
+    int getOpenConnections();
+    int getServedRequests();
+    int getHttp2Hosts();
+    DownloadMetrics getMetrics();
     void pauseDownloads();
     void setMaxPriority(int);
     QMap<qint64, QString> getPendingRequestsMap();
     QMap<qint64, QString> getRunningRequestsMap();
     QString getFilenameForURL(QUrl);
-    int getHighestPriority();
-    bool cacheAvailable(QUrl url);
-    QByteArray getCachedReply(QUrl url);
+    // Images download in the order they were requested, from any thread
+    int nextImagePriority() {return ++imagePriority;}
 
 private:
-    QList<NetworkAccessManager*> nams;
-    QHash<qint64, DownloadRequest*> requestList;
-    QHash<qint64, QNetworkReply*> activeReplies;
-    QHash<qint64, SupervisedNetworkReply*> supervisors;
-    QMultiMap<int, qint64> priorities;
-    chandl::AppSettings settings;
-    QTimer* waitTimer;
-    NetworkAccessManager* getFreeNAM();
-//    QNetworkAccessManager* _manager;
-    QNetworkCookieJar* cookies;
-
-    void setupNetworkAccessManagers(int count);
-    int maxRequests;
-    int currentRequests;
-    int totalRequests;
-    int finishedRequests;
-    int initialTimeout;
-    int runningTimeout;
-    bool downloadsPaused;
-    int statistic_downloadedFiles;
-    float statistic_downloadedKBytes;
-    bool _useThreadCache;
-    QString _threadCachePath;
-    int _highestPriority;
-
-    void addRequest(qint64, DownloadRequest*);
-    void handleError(qint64, QNetworkReply*);
-    void reschedule(qint64);
-    void processRequests();
-    inline qint64 getUID() {return ++lastid;}
-
-    QString encodeURL(QString);
-    QString decodeURL(QString);
-
+    QThread* networkThread;
+    DownloadWorker* worker;
+    QHash<qint64, QPointer<RequestHandler> > handlers;
     qint64 lastid;
-    int _max_priority;
+    std::atomic<int> imagePriority;
 
+    template<typename T, typename F> T fromWorker(F f);
 
 private slots:
-    void replyFinished(QNetworkReply*);
-    void startRequest(qint64);
-    void replyError(QNetworkReply::NetworkError e) {QLOG_ERROR() << "DownloadManager :: reply error " << e;}
-    void downloadTimeout(qint64);
+    void workerFinished(qint64 uid, QByteArray body, bool cached);
+    void workerFailed(qint64 uid, int err);
 
 signals:
     void totalRequestsChanged(int);
     void finishedRequestsChanged(int);
     void error(QString);
+
 public slots:
-    void loadSettings();
     void resumeDownloads();
 };
+
 #endif // DOWNLOADMANAGER_H
@@ -0,0 +1,398 @@
+#include "downloadmetrics.h"
+
+#include <QJsonArray>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+const QVector<qint64> LatencyHistogram::bounds = QVector<qint64>()
+        << 50 << 100 << 250 << 500 << 1000 << 2500 << 5000 << 10000 << 30000;
+const qint64 LatencyHistogram::Overflow;
+
+LatencyHistogram::LatencyHistogram() :
+    buckets(bounds.count() + 1, 0),
+    _count(0),
+    _sum(0)
+{
+}
+
+void LatencyHistogram::add(qint64 ms) {
+    int i;
+
+    if (ms < 0)
+        ms = 0;
+
+    for (i=0; i<bounds.count(); i++) {
+        if (ms < bounds.at(i))
+            break;
+    }
+
+    buckets[i]++;
+    _count++;
+    _sum += ms;
+}
+
+qint64 LatencyHistogram::mean() const {
+    return _count > 0 ? _sum / _count : 0;
+}
+
+// Returns the upper bound of the bucket that contains the p-th percentile. The
+// last bucket has none, claiming its lower bound would understate the latency.
+qint64 LatencyHistogram::percentile(int p) const {
+    qint64 ret;
+    int needed, seen;
+
+    ret = 0;
+    if (_count > 0) {
+        needed = (_count * p + 99) / 100;
+        seen = 0;
+        for (int i=0; i<buckets.count(); i++) {
+            seen += buckets.at(i);
+            if (seen >= needed) {
+                ret = i < bounds.count() ? bounds.at(i) : Overflow;
+                break;
+            }
+        }
+    }
+
+    return ret;
+}
+
+QString LatencyHistogram::percentileText(int p) const {
+    qint64 bound;
+
+    bound = percentile(p);
+    if (bound == Overflow)
+        return QString("%1 %2 ms").arg(QChar(0x2265)).arg(bounds.last());
+
+    return QString("< %1 ms").arg(bound);
+}
+
+QString LatencyHistogram::percentileValue(int p) const {
+    qint64 bound;
+
+    bound = percentile(p);
+    if (bound == Overflow)
+        return QString(">=%1").arg(bounds.last());
+
+    return QString::number(bound);
+}
+
+// A number, or the label of the last bucket
+QJsonValue LatencyHistogram::jsonPercentile(int p) const {
+    if (percentile(p) == Overflow)
+        return QJsonValue(percentileValue(p));
+
+    return QJsonValue(percentile(p));
+}
+
+QStringList LatencyHistogram::bucketLabels() {
+    QStringList ret;
+
+    foreach (qint64 b, bounds) {
+        ret << QString("<%1").arg(b);
+    }
+    ret << QString(">=%1").arg(bounds.last());
+
+    return ret;
+}
+
+QJsonObject LatencyHistogram::toJson() const {
+    QJsonObject ret;
+    QJsonObject hist;
+    QStringList labels;
+
+    labels = bucketLabels();
+    for (int i=0; i<buckets.count(); i++) {
+        hist.insert(labels.at(i), buckets.at(i));
+    }
+
+    ret.insert("count", _count);
+    ret.insert("mean_ms", mean());
+    ret.insert("p50_ms", jsonPercentile(50));
+    ret.insert("p95_ms", jsonPercentile(95));
+    ret.insert("p99_ms", jsonPercentile(99));
+    ret.insert("buckets", hist);
+
+    return ret;
+}
+
+DownloadMetrics::DownloadMetrics() {
+    clock.start();
+}
+
+qint64 DownloadMetrics::imagesPerSecond() const {
+    return uptime() > 0 ? _throughput.images * 1000 / uptime() : 0;
+}
+
+qint64 DownloadMetrics::bytesPerSecond() const {
+    return uptime() > 0 ? _throughput.bytes * 1000 / uptime() : 0;
+}
+
+qint64 DownloadMetrics::peakRss() {
+    qint64 ret;
+
+    ret = 0;
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        ret = pmc.PeakWorkingSetSize / 1024;
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(Q_OS_MACOS)
+        ret = usage.ru_maxrss / 1024;   // bytes on macOS
+#else
+        ret = usage.ru_maxrss;          // KB everywhere else
+#endif
+    }
+#endif
+
+    return ret;
+}
+
+DownloadMetrics::PriorityBand DownloadMetrics::bandForPriority(int priority) {
+    PriorityBand ret;
+
+    if (priority < 10)
+        ret = BandControl;
+    else if (priority < 100)
+        ret = BandPages;
+    else
+        ret = BandImages;
+
+    return ret;
+}
+
+QString DownloadMetrics::bandName(PriorityBand b) {
+    QString ret;
+
+    switch (b) {
+    case BandControl:
+        ret = "control";
+        break;
+    case BandPages:
+        ret = "pages";
+        break;
+    case BandImages:
+        ret = "images";
+        break;
+    default:
+        ret = "unknown";
+        break;
+    }
+
+    return ret;
+}
+
+void DownloadMetrics::leaveQueue(RequestTiming& t) {
+    if (t.startedAt < 0 && _bands[t.band].queueDepth > 0)
+        _bands[t.band].queueDepth--;
+}
+
+void DownloadMetrics::queued(qint64 uid, int priority) {
+    RequestTiming t;
+
+    if (requests.contains(uid)) {
+        // Re-queued (e.g. redirected) - keep the host, restart the timing
+        t = requests.value(uid);
+        leaveQueue(t);
+    }
+    else {
+        t.firstQueuedAt = clock.elapsed();
+    }
+
+    t.queuedAt = clock.elapsed();
+    t.startedAt = -1;
+    t.firstByteAt = -1;
+    t.band = bandForPriority(priority);
+
+    _bands[t.band].queueDepth++;
+    requests.insert(uid, t);
+}
+
+void DownloadMetrics::started(qint64 uid, const QString& host) {
+    QHash<qint64, RequestTiming>::iterator it;
+
+    it = requests.find(uid);
+    if (it == requests.end())
+        return;
+
+    leaveQueue(it.value());
+    it->startedAt = clock.elapsed();
+    it->host = host;
+
+    _bands[it->band].started++;
+    _bands[it->band].wait.add(it->startedAt - it->queuedAt);
+}
+
+void DownloadMetrics::firstByte(qint64 uid) {
+    QHash<qint64, RequestTiming>::iterator it;
+
+    it = requests.find(uid);
+    if (it == requests.end() || it->startedAt < 0 || it->firstByteAt >= 0)
+        return;
+
+    it->firstByteAt = clock.elapsed();
+    _hosts[it->host].ttfb.add(it->firstByteAt - it->startedAt);
+}
+
+void DownloadMetrics::finished(qint64 uid, qint64 bytes) {
+    RequestTiming t;
+    HostMetrics* h;
+    qint64 now;
+
+    if (!requests.contains(uid))
+        return;
+
+    t = requests.take(uid);
+    if (t.startedAt < 0) {
+        leaveQueue(t);
+        return;
+    }
+
+    now = clock.elapsed();
+    h = &_hosts[t.host];
+    h->requests++;
+    h->bytes += bytes;
+    h->total.add(now - t.startedAt);
+    // Bytes only flow after the headers, so measure the rate from there
+    h->transferMs += now - (t.firstByteAt >= 0 ? t.firstByteAt : t.startedAt);
+
+    if (t.band == BandImages) {
+        _throughput.images++;
+        _throughput.bytes += bytes;
+        _throughput.completion.add(now - t.firstQueuedAt);
+    }
+}
+
+void DownloadMetrics::retried(qint64 uid, int newPriority) {
+    if (!requests.contains(uid))
+        return;
+
+    if (!requests.value(uid).host.isEmpty())
+        _hosts[requests.value(uid).host].retries++;
+
+    queued(uid, newPriority);
+}
+
+void DownloadMetrics::timedOut(qint64 uid) {
+    if (requests.contains(uid) && !requests.value(uid).host.isEmpty())
+        _hosts[requests.value(uid).host].timeouts++;
+}
+
+void DownloadMetrics::failed(qint64 uid) {
+    RequestTiming t;
+
+    if (!requests.contains(uid))
+        return;
+
+    t = requests.take(uid);
+    leaveQueue(t);
+    if (!t.host.isEmpty())
+        _hosts[t.host].errors++;
+}
+
+void DownloadMetrics::removed(qint64 uid) {
+    RequestTiming t;
+
+    if (!requests.contains(uid))
+        return;
+
+    t = requests.take(uid);
+    leaveQueue(t);
+}
+
+QJsonObject DownloadMetrics::toJson() const {
+    QJsonObject ret;
+    QJsonObject hostsObj;
+    QJsonObject bandsObj;
+
+    foreach (const QString& host, _hosts.keys()) {
+        const HostMetrics& h = _hosts[host];
+        QJsonObject o;
+
+        o.insert("requests", h.requests);
+        o.insert("bytes", h.bytes);
+        o.insert("bytes_per_second", h.bytesPerSecond());
+        o.insert("retries", h.retries);
+        o.insert("timeouts", h.timeouts);
+        o.insert("errors", h.errors);
+        o.insert("ttfb", h.ttfb.toJson());
+        o.insert("total_time", h.total.toJson());
+
+        hostsObj.insert(host, o);
+    }
+
+    for (int i=0; i<BandCount; i++) {
+        QJsonObject o;
+
+        o.insert("queue_depth", _bands[i].queueDepth);
+        o.insert("started", _bands[i].started);
+        o.insert("wait_time", _bands[i].wait.toJson());
+
+        bandsObj.insert(bandName((PriorityBand)i), o);
+    }
+
+    QJsonObject throughputObj;
+
+    throughputObj.insert("images", _throughput.images);
+    throughputObj.insert("bytes", _throughput.bytes);
+    throughputObj.insert("images_per_second", imagesPerSecond());
+    throughputObj.insert("bytes_per_second", bytesPerSecond());
+    throughputObj.insert("completion_time", _throughput.completion.toJson());
+    throughputObj.insert("peak_rss_kb", peakRss());
+
+    ret.insert("uptime_ms", uptime());
+    ret.insert("hosts", hostsObj);
+    ret.insert("priority_bands", bandsObj);
+    ret.insert("throughput", throughputObj);
+
+    return ret;
+}
+
+// One line per value: section,key,metric,value
+QString DownloadMetrics::toCsv() const {
+    QStringList lines;
+
+    lines << "section,key,metric,value";
+
+    foreach (const QString& host, _hosts.keys()) {
+        const HostMetrics& h = _hosts[host];
+        QString prefix = QString("host,%1,").arg(host);
+
+        lines << prefix + QString("requests,%1").arg(h.requests)
+              << prefix + QString("bytes,%1").arg(h.bytes)
+              << prefix + QString("bytes_per_second,%1").arg(h.bytesPerSecond())
+              << prefix + QString("retries,%1").arg(h.retries)
+              << prefix + QString("timeouts,%1").arg(h.timeouts)
+              << prefix + QString("errors,%1").arg(h.errors)
+              << prefix + QString("ttfb_mean_ms,%1").arg(h.ttfb.mean())
+              << prefix + QString("ttfb_p95_ms,%1").arg(h.ttfb.percentileValue(95))
+              << prefix + QString("total_mean_ms,%1").arg(h.total.mean())
+              << prefix + QString("total_p95_ms,%1").arg(h.total.percentileValue(95));
+    }
+
+    for (int i=0; i<BandCount; i++) {
+        QString prefix = QString("band,%1,").arg(bandName((PriorityBand)i));
+
+        lines << prefix + QString("queue_depth,%1").arg(_bands[i].queueDepth)
+              << prefix + QString("started,%1").arg(_bands[i].started)
+              << prefix + QString("wait_mean_ms,%1").arg(_bands[i].wait.mean())
+              << prefix + QString("wait_p95_ms,%1").arg(_bands[i].wait.percentileValue(95));
+    }
+
+    lines << QString("throughput,images,count,%1").arg(_throughput.images)
+          << QString("throughput,images,bytes,%1").arg(_throughput.bytes)
+          << QString("throughput,images,per_second,%1").arg(imagesPerSecond())
+          << QString("throughput,images,bytes_per_second,%1").arg(bytesPerSecond())
+          << QString("throughput,images,completion_p50_ms,%1").arg(_throughput.completion.percentileValue(50))
+          << QString("throughput,images,completion_p99_ms,%1").arg(_throughput.completion.percentileValue(99))
+          << QString("throughput,process,peak_rss_kb,%1").arg(peakRss());
+
+    return lines.join("\n") + "\n";
+}
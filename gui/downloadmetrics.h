@@ -0,0 +1,130 @@
+#ifndef DOWNLOADMETRICS_H
+#define DOWNLOADMETRICS_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Fixed buckets (upper bounds in ms), the last bucket takes everything above
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+    void add(qint64 ms);
+    int count() const {return _count;}
+    qint64 mean() const;
+    // Upper bound of the bucket with the p-th percentile, Overflow for the last bucket
+    qint64 percentile(int p) const;
+    // "< 250 ms", or ">= 30000 ms" with a proper sign in the last bucket, for the UI
+    QString percentileText(int p) const;
+    // The bound as a number, ">=30000" in the last bucket, for the CSV and JSON dumps
+    QString percentileValue(int p) const;
+    QJsonObject toJson() const;
+    static QStringList bucketLabels();
+
+    static const qint64 Overflow = -1;
+
+private:
+    static const QVector<qint64> bounds;
+    QVector<int> buckets;
+    int _count;
+    qint64 _sum;
+
+    QJsonValue jsonPercentile(int p) const;
+};
+
+struct HostMetrics
+{
+    qint64 requests = 0;
+    qint64 bytes = 0;
+    qint64 transferMs = 0;
+    int retries = 0;
+    int timeouts = 0;
+    int errors = 0;
+    LatencyHistogram ttfb;
+    LatencyHistogram total;
+
+    // Average rate of a single transfer, not the aggregate over all connections
+    qint64 bytesPerSecond() const {return transferMs > 0 ? bytes * 1000 / transferMs : 0;}
+};
+
+// End to end numbers of the image downloads, queued until saved to memory
+struct ThroughputMetrics
+{
+    qint64 images = 0;
+    qint64 bytes = 0;
+    LatencyHistogram completion;
+};
+
+struct PriorityBandMetrics
+{
+    int queueDepth = 0;
+    qint64 started = 0;
+    LatencyHistogram wait;
+};
+
+/**
+ * Collects timing and volume statistics of the download pipeline. Fed by the
+ * DownloadManager with the uid of each request at every state change.
+ */
+class DownloadMetrics
+{
+public:
+    enum PriorityBand {
+        BandControl = 0,    // update checks, plugin initialisation, redirects
+        BandPages,          // thread and board pages
+        BandImages,         // image files
+        BandCount
+    };
+
+    DownloadMetrics();
+
+    void queued(qint64 uid, int priority);
+    void started(qint64 uid, const QString& host);
+    void firstByte(qint64 uid);
+    void finished(qint64 uid, qint64 bytes);
+    void retried(qint64 uid, int newPriority);
+    void timedOut(qint64 uid);
+    void failed(qint64 uid);
+    void removed(qint64 uid);
+
+    const QMap<QString, HostMetrics>& hosts() const {return _hosts;}
+    const PriorityBandMetrics& band(PriorityBand b) const {return _bands[b];}
+    const ThroughputMetrics& throughput() const {return _throughput;}
+    qint64 uptime() const {return clock.elapsed();}
+    qint64 imagesPerSecond() const;
+    qint64 bytesPerSecond() const;
+
+    // Peak resident set size of the process in KB, 0 if unknown
+    static qint64 peakRss();
+
+    static PriorityBand bandForPriority(int priority);
+    static QString bandName(PriorityBand b);
+
+    QJsonObject toJson() const;
+    QString toCsv() const;
+
+private:
+    struct RequestTiming {
+        qint64 queuedAt = 0;
+        qint64 firstQueuedAt = 0;   // kept across retries and redirects
+        qint64 startedAt = -1;
+        qint64 firstByteAt = -1;
+        PriorityBand band = BandControl;
+        QString host;
+    };
+
+    QElapsedTimer clock;
+    QHash<qint64, RequestTiming> requests;
+    QMap<QString, HostMetrics> _hosts;
+    PriorityBandMetrics _bands[BandCount];
+    ThroughputMetrics _throughput;
+
+    void leaveQueue(RequestTiming& t);
+};
+
+#endif // DOWNLOADMETRICS_H
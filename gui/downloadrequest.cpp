@@ -16,6 +16,7 @@ DownloadRequest::DownloadRequest(QObject *parent) :
     _url = QUrl("");
     _prio = 0;
     _cached_reply = false;
+    _conditional = false;
     _error_count = 0;
 }
 
@@ -25,11 +26,6 @@ void DownloadRequest::reset() {
     _error_count = 0;
 }
 
-void DownloadRequest::setResponse(QByteArray ba) {
-     _response = ba;
-     _finished = true;
-}
-
 void DownloadRequest::pause(int s) {
     if (s <= 0 ) {
         s = 10;
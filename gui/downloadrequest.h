@@ -2,9 +2,8 @@
 #define DOWNLOADREQUEST_H
 
 #include <QObject>
-#include "requesthandler.h"
-
-class RequestHandler;
+#include <QUrl>
+#include <QTimer>
 
 class DownloadRequest : public QObject
 {
@@ -12,24 +11,21 @@ class DownloadRequest : public QObject
 public:
     explicit DownloadRequest(QObject *parent = 0);
 
-    void setRequestHandler(RequestHandler* rh) {_rh = rh;}
-    RequestHandler* requestHandler() {return _rh;}
-
     void setUrl(QUrl url) {_url = url;}
     QUrl url() {return _url;}
 
     void setPriority(int prio) {_prio = prio;}
     int priority() {return _prio;}
 
-    QByteArray response(void) {return _response;}
-    void setResponse(QByteArray ba);
-
     bool processing() {return _processing;}
     void setProcessing(bool b) {_processing = b;}
     void reset();
     bool finished() {return _finished;}
+    void setFinished() {_finished = true;}
     bool cached() {return _cached_reply;}
     void setCached(bool b) {_cached_reply = b;}
+    bool conditional() {return _conditional;}
+    void setConditional(bool b) {_conditional = b;}
 
     bool paused() {return _paused;}
     void pause(int s);
@@ -38,14 +34,13 @@ public:
     void download_error(int increment=1);
 
 private:
-    RequestHandler* _rh;
     QUrl _url;
     int _prio;
-    QByteArray _response;
     QTimer* pauseTimer;
     bool _processing;
     bool _finished;
     bool _cached_reply;
+    bool _conditional;
     bool _paused;
     int _error_count;
 
@@ -0,0 +1,567 @@
+﻿
+#include <QDir>
+
+#include "downloadworker.h"
+
+DownloadWorker::DownloadWorker(std::atomic<int>* imagePriority, QObject *parent) :
+    QObject(parent),
+    imagePriority(imagePriority)
+{
+    downloadsPaused = true;
+    cookies = new QNetworkCookieJar();
+    setMaxPriority(0);
+    nam = new NetworkAccessManager(this);           // One manager, connections are reused per host
+    nam->setCookieJar(cookies);
+
+    waitTimer = new QTimer(this);           // Has to follow us into the network thread
+    waitTimer->setSingleShot(true);
+    waitTimer->setInterval(20000);
+
+    requestList.clear();
+    currentRequests = 0;
+
+    totalRequests = 0;
+    finishedRequests = 0;
+
+    statistic_downloadedFiles  = 0;
+    statistic_downloadedKBytes = 0;
+
+    loadSettings();
+
+//    _manager = new QNetworkAccessManager(this);
+//    connect(_manager, SIGNAL(finished(QNetworkReply*)), this, SLOT(replyFinished(QNetworkReply*)));
+
+    connect(nam, SIGNAL(finished(QNetworkReply*)), this, SLOT(replyFinished(QNetworkReply*)));
+    connect(waitTimer, SIGNAL(timeout()), this, SLOT(resumeDownloads()));
+    connect(&chandl::SettingsStore::instance(), SIGNAL(changed()), this, SLOT(loadSettings()));
+}
+
+void DownloadWorker::loadSettings() {
+  config = chandl::settingsSnapshot();
+  maxRequests = config->managerConcurrentDownloads;
+  initialTimeout = config->managerInitialTimeout * 1000;
+  runningTimeout = config->runningTimeout * 1000;
+  _useThreadCache = config->useThreadCache;
+  _threadCachePath = config->threadCachePath;
+  statistic_downloadedFiles = settings.getDownloadedFilesStatistic();
+  statistic_downloadedKBytes = settings.getDownloadedKBytesStatistic();
+}
+
+void DownloadWorker::replyFinished(QNetworkReply* reply) {
+    QString redirect;
+    qint64 uid;
+    DownloadRequest* dr;
+    QFile f;
+    QString threadCacheFilename;
+    QByteArray body;
+
+
+    // Search in requestList for this reply
+    QLOG_TRACE() << "DownloadWorker :: " << reply->url().toString() << "rawHeader: " << reply->rawHeaderList();
+    uid = activeReplies.key(reply, -1);
+    dr = requestList.value(uid,0);
+    //supervisors.value(uid)->deleteLater();
+    supervisors.remove(uid);
+    priorities.remove(priorities.key(uid), uid);
+    activeReplies.remove(uid);
+
+    QLOG_TRACE() << "DownloadWorker :: " << "Finished request" << uid << reply->url().toString() << "reply" << (qint64)reply;
+
+    if (uid == 0) {
+        QLOG_INFO() << "DownloadWorker :: " << "uid 0 finished; url=" << reply->url().toString();
+    }
+    if (uid != -1) {
+        if (reply->header(QNetworkRequest::ContentLengthHeader).toLongLong() != -1
+                && reply->bytesAvailable() < reply->header(QNetworkRequest::ContentLengthHeader).toLongLong()) {
+            QLOG_INFO() << "DownloadWorker :: " << "Received less byte than expected - Possibly because the download timed out";
+            reschedule(uid);
+        }
+        else {
+            redirect = reply->header(QNetworkRequest::LocationHeader).toString();
+            if (!redirect.isEmpty()) {
+                if (dr != 0) {
+                    dr->setUrl(QUrl(redirect));
+                    dr->setProcessing(false);
+                    priorities.insertMulti(-1, uid);
+                    metrics.queued(uid, -1);
+                }
+            }
+            else if (reply->error() != QNetworkReply::NoError) {
+                handleError(uid, reply);
+            }
+            else {
+                if (reply->isFinished() && dr != 0) {
+                    // The body is shared with the receiver, the cache file below reads the same buffer
+                    // A conditional request for an unchanged resource (304) finishes with an empty body
+                    body = reply->readAll();
+                    if (dr->conditional()) {
+                        if (reply->hasRawHeader("Last-Modified"))
+                            lastModified.insert(dr->url().toString(), reply->rawHeader("Last-Modified"));
+                        if (reply->hasRawHeader("ETag"))
+                            entityTags.insert(dr->url().toString(), reply->rawHeader("ETag"));
+                    }
+                    metrics.finished(uid, body.size());
+                    dr->setFinished();
+                    emit requestFinished(uid, body, false);
+                    freeRequest(uid);
+
+                    emit finishedRequestsChanged(++finishedRequests);
+                    if (reply->url().toString().indexOf(QRegExp(__IMAGE_REGEXP__, Qt::CaseInsensitive)) != -1) {
+                        statistic_downloadedFiles++;
+                        statistic_downloadedKBytes = statistic_downloadedKBytes + ((float)body.size())/1024;
+                    }
+                    else {
+                        if (_useThreadCache && !body.isEmpty()) {
+                            threadCacheFilename = getFilenameForURL(reply->url());
+                            if (threadCacheFilename != ".") {
+                                QDir dir;
+                                dir.setPath(_threadCachePath);
+                                if (!dir.exists()) {
+                                    dir.mkpath(_threadCachePath);
+                                }
+                                f.setFileName(threadCacheFilename);
+                                f.open(QIODevice::WriteOnly | QIODevice::Truncate);
+                                if (f.isOpen() && f.isWritable()) {
+                                    if (config->compressCacheFile) {
+                                        f.write(qCompress(body));
+                                    }
+                                    else {
+                                        f.write(body);
+                                    }
+                                    QLOG_DEBUG() << "DownloadWorker :: Writing cache file " << threadCacheFilename;
+                                }
+                                f.close();
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    else {
+        QLOG_ERROR() << "DownloadWorker :: " << "I did not find the request to the reply!";
+    }
+
+    currentRequests--;
+    reply->deleteLater();
+
+    if (activeReplies.count() > (maxRequests+10)) {
+        QLOG_WARN() << "DownloadWorker :: " << "There are more active requests than allowed. Pausing downloads.";
+        pauseDownloads();
+
+        foreach (QNetworkReply* r, activeReplies) {
+            r->abort();
+        }
+
+        waitTimer->start();
+    }
+
+    processRequests();
+}
+
+void DownloadWorker::freeRequest(qint64 uid) {
+    DownloadRequest* dr;
+    dr = requestList.value(uid, 0);
+    QLOG_TRACE() << "DownloadWorker :: " << "freeRequest(" << uid << ")";
+
+    if (dr != 0) {
+        dr->deleteLater();
+        requestList.remove(uid);
+        activeReplies.remove(uid);
+    }
+//    QLOG_TRACE() << "DownloadWorker :: " << "open requests" << requestList.keys();
+//    QLOG_TRACE() << "DownloadWorker :: " << "priorities" << priorities;
+}
+
+void DownloadWorker::enqueue(qint64 uid, QUrl url, int prio, bool conditional) {
+    DownloadRequest* dr;
+
+    dr = new DownloadRequest(this);
+    dr->setUrl(url);
+    dr->setPriority(prio);
+    dr->setConditional(conditional);
+
+    connect(dr, SIGNAL(requestUnpaused()), this, SLOT(resumeDownloads()));
+
+    requestList.insert(uid, dr);
+    priorities.insertMulti(prio, uid);
+    metrics.queued(uid, prio);
+
+    processRequests();
+
+    emit totalRequestsChanged(++totalRequests);
+}
+
+int DownloadWorker::getStatisticsFiles() const
+{
+  return statistic_downloadedFiles;
+}
+
+float DownloadWorker::getStatisticsKBytes() const
+{
+  return statistic_downloadedKBytes;
+}
+
+/**
+ * Add Request to internal list and start Thread/Download immediately if max. number of downloads is not met.
+ */
+void DownloadWorker::downloadTimeout(qint64 uid) {
+    QNetworkReply* r;
+
+    r = activeReplies.value(uid);
+
+    if (r != 0) {
+//        QLOG_TRACE() << "DownloadWorker :: " << uid << QString(r->readAll());
+        metrics.timedOut(uid);
+        r->abort();
+    }
+}
+
+void DownloadWorker::processRequests() {
+    QList<qint64> uids;
+
+    if (!downloadsPaused) {
+        uids = priorities.values();
+
+        if (uids.count() > 0) {
+            foreach (qint64 uid, uids) {
+                if (activeReplies.count() >= maxRequests) {
+                    break;
+                }
+                else {
+                    if (requestList.count(uid) > 0) {
+                        if (!(requestList.value(uid)->finished()) &&
+                            !(requestList.value(uid)->processing()) &&
+                            !(requestList.value(uid)->paused()) &&
+                            !(nam->hostSaturated(requestList.value(uid)->url().host()))) {
+                            startRequest(uid);
+                            //                            QLOG_TRACE() << "DownloadWorker :: " << "addRequest (" << uid << ")";
+                        }
+                    }
+                }
+            }
+        }
+        else {
+            if (requestList.count() > 0) {
+                // This should not happen but if there are no (more) priorities set for some downloads, reset them
+                uids = requestList.keys();
+                foreach(qint64 uid, uids) {
+                    priorities.insertMulti(uid, 0);
+                }
+
+                processRequests();
+            }
+            else {
+                // We are finished
+                totalRequests = 0;
+                finishedRequests = 0;
+                emit totalRequestsChanged(totalRequests);
+            }
+        }
+    }
+}
+
+void DownloadWorker::startRequest(qint64 uid) {
+    QNetworkRequest req;
+    QNetworkReply* rep;
+    DownloadRequest* dr;
+    SupervisedNetworkReply* sup;
+
+    dr = requestList.value(uid, 0);
+
+    if (dr != 0 && !downloadsPaused) {
+        dr->setProcessing(true);
+        sup = new SupervisedNetworkReply();
+        sup->setTimeouts(initialTimeout, runningTimeout);
+        connect(sup, SIGNAL(timeout(qint64)), this, SLOT(downloadTimeout(qint64)));
+
+        req = QNetworkRequest(dr->url());
+        req.setAttribute(QNetworkRequest::CookieSaveControlAttribute, QNetworkRequest::Automatic);
+        req.setRawHeader("User-Agent", config->userAgent);
+        if (dr->conditional()) {
+            if (lastModified.contains(dr->url().toString()))
+                req.setRawHeader("If-Modified-Since", lastModified.value(dr->url().toString()));
+            if (entityTags.contains(dr->url().toString()))
+                req.setRawHeader("If-None-Match", entityTags.value(dr->url().toString()));
+        }
+//        req.setRawHeader("User-Agent", "Opera/9.80 (Windows NT 6.1; U; en) Presto/2.9.168 Version/11.50");
+        currentRequests++;
+        rep = nam->get(req);
+//        rep = _manager->get(req);
+        metrics.started(uid, dr->url().host());
+        // Headers have arrived - that is our time to first byte
+        connect(rep, &QNetworkReply::metaDataChanged, this, [this, uid]() { metrics.firstByte(uid); });
+
+        sup->setNetworkReply(rep, uid);
+        supervisors.insert(uid, sup);
+
+//        QLOG_TRACE() << "DownloadWorker :: " << "Requesting" << uid << ":" << dr->url();// << "with reply" << (qint64)rep;
+        activeReplies.insert(uid, rep);
+    }
+    else {
+        QLOG_WARN() << "DownloadWorker :: " << "Requested start of uid which is non-existent";
+    }
+}
+
+void DownloadWorker::handleError(qint64 uid, QNetworkReply* r) {
+    DownloadRequest* dr;
+    dr = requestList.value(uid);
+
+    QLOG_INFO() << "DownloadWorker :: " << r->url().toString() << "received error" << r->error() << ":" << r->errorString();
+
+    if (dr != 0) {
+        switch (r->error()) {
+        case 203:       // Not found
+            metrics.failed(uid);
+            if (_useThreadCache && cacheAvailable(dr->url())) {
+                    dr->setFinished();
+                    emit requestFinished(uid, getCachedReply(dr->url()), true);
+            }
+            else {
+                emit requestFailed(uid, 404);
+            }
+            freeRequest(uid);
+
+            currentRequests--;
+            processRequests();
+
+            break;
+
+//        case 205:
+//        case 99:
+//        case 299:
+//        case 5:         // aborted
+//        case 2:         // Connection closed
+//        case 301:
+        default:
+            QLOG_INFO() << "DownloadWorker :: Error on " << r->url().host() << r->errorString();
+            if (dr->error_count() < 10) {
+                dr->download_error();
+                reschedule(uid);
+            }
+            else {
+                QLOG_INFO() << "DownloadWorker :: Had 10 errors with one download. Giving up.";
+                metrics.failed(uid);
+                emit requestFailed(uid, 404);
+                freeRequest(uid);
+            }
+
+            break;
+/*
+        case 202:
+            emit requestFailed(uid, 202);
+
+            currentRequests--;
+            processRequests();
+
+        case 3:
+            QLOG_WARN() << "DownloadWorker :: " << "Host not found error for URL" << r->url().toString();
+            currentRequests--;
+            dr->pause(10);
+            reschedule(uid);    // Try harder
+            processRequests();
+            break;
+
+        default:
+            QLOG_ERROR() << "DownloadWorker :: " << "Unhandled error " << r->error();
+    //        r.caller->error(r.uid, 404);
+            dr->pause(10);
+            reschedule(uid);        // Since we don't know what happened, try harder
+            currentRequests--;
+            processRequests();
+
+            break;
+*/
+        }
+    }
+    else {
+        QLOG_FATAL() << "DownloadWorker :: Received Error for DownloadRequest which does not exist any more!";
+    }
+}
+
+void DownloadWorker::reschedule(qint64 uid) {
+    DownloadRequest* dr;
+    int prio;
+
+    QLOG_INFO() << "DownloadWorker :: " << "rescheduling" << uid;
+    dr = requestList.value(uid,0);
+    if (dr != 0) {
+        prio = dr->priority();
+        dr->setProcessing(false);
+
+        // "lower priority for rescheduled downloads"
+        priorities.remove(prio, uid);
+        if (dr->url().toString().indexOf(QRegExp(__IMAGE_REGEXP__, Qt::CaseInsensitive)) != -1) {
+            // Behind everything queued so far, like a new image
+            prio = ++(*imagePriority);
+        }
+        else
+        {
+            prio += 1;
+        }
+        QLOG_INFO() << "DownloadWorker :: " << uid << ":" << "setting new priority" << prio;
+        dr->setPriority(prio);
+        priorities.insertMulti(prio,uid);
+        metrics.retried(uid, prio);
+
+        dr->reset();
+        currentRequests--;
+        processRequests();
+    }
+}
+
+void DownloadWorker::resumeDownloads() {
+    QLOG_INFO() << "DownloadWorker :: " << "resuming downloads";
+    downloadsPaused = false;
+
+    processRequests();
+}
+
+void DownloadWorker::removeRequest(qint64 uid) {
+    int prio;
+    DownloadRequest* dr;
+
+    dr = requestList.value(uid, 0);
+    if (dr != 0) {
+        prio = dr->priority();
+        priorities.remove(prio, uid);
+        requestList.remove(uid);
+        metrics.removed(uid);
+        dr->deleteLater();
+
+        // See if this id is currently downloading
+        if (activeReplies.count(uid) > 0) {
+            supervisors.remove(uid);
+            activeReplies.value(uid)->abort();
+        }
+    }
+}
+
+int DownloadWorker::getPendingRequests() {
+    return priorities.count();
+}
+
+int DownloadWorker::getRunningRequests() {
+    return activeReplies.count();
+}
+
+int DownloadWorker::getTotalRequests() {
+    return totalRequests;
+}
+
+int DownloadWorker::getFinishedRequests() {
+    return finishedRequests;
+}
+
+int DownloadWorker::getOpenedConnections() {
+    return nam->openedConnections();
+}
+
+int DownloadWorker::getOpenConnections() {
+    return nam->openConnections();
+}
+
+int DownloadWorker::getServedRequests() {
+    return nam->servedRequests();
+}
+
+int DownloadWorker::getHttp2Hosts() {
+    return nam->http2Hosts();
+}
+
+void DownloadWorker::pauseDownloads() {
+    downloadsPaused = true;
+}
+
+void DownloadWorker::setMaxPriority(int mp) {
+    _max_priority = mp;
+
+    QLOG_INFO() << "DownloadWorker :: Setting max priority to " << mp;
+    if (!downloadsPaused) {
+        processRequests();
+    }
+}
+
+QMap<qint64, QString> DownloadWorker::getPendingRequestsMap() {
+    QMap<qint64, QString> ret;
+    QHashIterator<qint64, DownloadRequest*>  requests(requestList);
+
+    while (requests.hasNext()) {
+        requests.next();
+
+        ret.insertMulti(requests.value()->priority(), requests.value()->url().toString());
+    }
+
+    return ret;
+}
+
+QMap<qint64, QString> DownloadWorker::getRunningRequestsMap() {
+    QMap<qint64, QString> ret;
+    QHashIterator<qint64, QNetworkReply*>  requests(activeReplies);
+    DownloadRequest* dr;
+
+    while (requests.hasNext()) {
+        requests.next();
+
+        dr = requestList.value(requests.key(), 0);
+        ret.insertMulti(dr != 0 ? dr->priority() : 0, requests.value()->url().toString());
+    }
+
+    return ret;
+}
+
+bool DownloadWorker::cacheAvailable(QUrl url) {
+    bool ret;
+    QFile f;
+
+    ret = false;
+
+    if (_useThreadCache && !_threadCachePath.isEmpty()) {
+        if (QFile::exists(getFilenameForURL(url))) {
+            ret = true;
+        }
+    }
+
+    return ret;
+}
+
+QByteArray DownloadWorker::getCachedReply(QUrl url) {
+    QByteArray ret;
+    QFile f;
+
+    if (cacheAvailable(url)) {
+        f.setFileName(getFilenameForURL(url));
+        f.open(QIODevice::ReadOnly);
+
+        if (f.isOpen() && f.isReadable()) {
+            if (config->compressCacheFile) {
+                ret = qUncompress(f.readAll());
+            }
+            else {
+                ret = f.readAll();
+            }
+            QLOG_DEBUG() << "DownloadWorker :: reading cache file for " << url.toString();
+        }
+        f.close();
+    }
+
+    return ret;
+}
+
+QString DownloadWorker::getFilenameForURL(QUrl url) {
+    return cacheFilename(url, _threadCachePath);
+}
+
+QString DownloadWorker::cacheFilename(QUrl url, QString cachePath) {
+    QString ret;
+
+    if (!cachePath.isEmpty()) {
+        ret = QString("%1/%2.tcache").arg(cachePath, QString(QUrl::toPercentEncoding(url.toString())));
+    }
+    else {
+        ret = ".";
+    }
+
+    QLOG_DEBUG() << "DownloadWorker :: threadCache filename=" << ret;
+    return ret;
+}
@@ -0,0 +1,111 @@
+﻿#ifndef DOWNLOADWORKER_H
+#define DOWNLOADWORKER_H
+
+#include <atomic>
+
+#include <QObject>
+#include <QUrl>
+#include <QtNetwork>
+#include <QSettings>
+
+#include "appsettings.h"
+#include "settingssnapshot.h"
+#include "supervisednetworkreply.h"
+#include "downloadrequest.h"
+#include "networkaccessmanager.h"
+#include "downloadmetrics.h"
+#include "defines.h"
+#include "QsLog.h"
+
+class DownloadRequest;
+
+/**
+ * Network side of the DownloadManager. Lives in its own thread together with
+ * the NetworkAccessManager, the reply supervisors and the thread cache, and is
+ * only driven through queued calls from the DownloadManager.
+ */
+class DownloadWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DownloadWorker(std::atomic<int>* imagePriority, QObject *parent = 0);
+
+    // Safe to call from any thread
+    int getStatisticsFiles() const;
+    float getStatisticsKBytes() const;
+    int getTotalRequests();
+    int getFinishedRequests();
+    static QString cacheFilename(QUrl url, QString cachePath);
+
+    // Only from the network thread
+    int getPendingRequests();
+    int getRunningRequests();
+    int getOpenedConnections();
+    int getOpenConnections();
+    int getServedRequests();
+    int getHttp2Hosts();
+    const DownloadMetrics& getMetrics() const {return metrics;}
+    QMap<qint64, QString> getPendingRequestsMap();
+    QMap<qint64, QString> getRunningRequestsMap();
+    QString getFilenameForURL(QUrl);
+    bool cacheAvailable(QUrl url);
+    QByteArray getCachedReply(QUrl url);
+
+private:
+    NetworkAccessManager* nam;
+    QHash<qint64, DownloadRequest*> requestList;
+    QHash<qint64, QNetworkReply*> activeReplies;
+    QHash<qint64, SupervisedNetworkReply*> supervisors;
+    QMultiMap<int, qint64> priorities;
+    chandl::AppSettings settings;
+    chandl::SettingsSnapshotPtr config;
+    QTimer* waitTimer;
+    DownloadMetrics metrics;
+    QNetworkCookieJar* cookies;
+
+    int maxRequests;
+    int currentRequests;
+    std::atomic<int> totalRequests;
+    std::atomic<int> finishedRequests;
+    int initialTimeout;
+    int runningTimeout;
+    bool downloadsPaused;
+    std::atomic<int> statistic_downloadedFiles;
+    std::atomic<float> statistic_downloadedKBytes;
+    bool _useThreadCache;
+    QString _threadCachePath;
+    std::atomic<int>* imagePriority;       // owned by the DownloadManager, see nextImagePriority()
+    // Validators of conditional requests, keyed by url
+    QHash<QString, QByteArray> lastModified;
+    QHash<QString, QByteArray> entityTags;
+
+    void freeRequest(qint64);
+    void handleError(qint64, QNetworkReply*);
+    void reschedule(qint64);
+    void processRequests();
+
+    int _max_priority;
+
+private slots:
+    void replyFinished(QNetworkReply*);
+    void startRequest(qint64);
+    void replyError(QNetworkReply::NetworkError e) {QLOG_ERROR() << "DownloadWorker :: reply error " << e;}
+    void downloadTimeout(qint64);
+
+signals:
+    void requestFinished(qint64 uid, QByteArray body, bool cached);
+    void requestFailed(qint64 uid, int error);
+    void totalRequestsChanged(int);
+    void finishedRequestsChanged(int);
+    void error(QString);
+
+public slots:
+    void enqueue(qint64 uid, QUrl url, int prio, bool conditional = false);
+    void removeRequest(qint64);
+    void loadSettings();
+    void pauseDownloads();
+    void resumeDownloads();
+    void setMaxPriority(int);
+};
+
+#endif // DOWNLOADWORKER_H
@@ -0,0 +1,140 @@
+#include "folderindex.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+
+FolderIndex& FolderIndex::instance() {
+    static FolderIndex index;
+    return index;
+}
+
+bool FolderIndex::contains(const QString& filename) {
+    QString dir, name;
+
+    split(filename, &dir, &name);
+
+    return folder(dir).contains(name);
+}
+
+void FolderIndex::add(const QString& filename) {
+    QString dir, name;
+
+    split(filename, &dir, &name);
+    folder(dir).insert(name);
+
+    // A save directory is usually created by the download that adds its first file
+    watch(dir);
+    stamp(dir);
+}
+
+void FolderIndex::remove(const QString& filename) {
+    QString dir, name;
+
+    split(filename, &dir, &name);
+
+    if (folders.contains(dir)) {
+        folders[dir].remove(name);
+        stamp(dir);
+    }
+}
+
+void FolderIndex::split(const QString& filename, QString* dir, QString* name) {
+    QString path;
+    int pos;
+
+    path = QDir::cleanPath(QDir::fromNativeSeparators(filename));
+#ifdef Q_OS_WIN
+    // Like the file system itself, "a.jpg" and "A.JPG" are the same file
+    path = path.toLower();
+#endif
+
+    pos = path.lastIndexOf('/');
+
+    if (pos > 0)
+        *dir = path.left(pos);
+    else if (pos == 0)
+        *dir = "/";
+    else
+        *dir = ".";
+
+    *name = path.mid(pos+1);
+}
+
+QSet<QString>& FolderIndex::folder(const QString& dir) {
+    if (!folders.contains(dir)) {
+        scan(dir);
+        watch(dir);
+    }
+
+    return folders[dir];
+}
+
+void FolderIndex::scan(const QString& dir) {
+    QSet<QString> names;
+
+    // Taken before reading, a change while we read shows up as a newer time
+    stamp(dir);
+
+    foreach (QString name, QDir(dir).entryList(QDir::Files | QDir::Hidden | QDir::System)) {
+#ifdef Q_OS_WIN
+        name = name.toLower();
+#endif
+        names.insert(name);
+    }
+
+    folders.insert(dir, names);
+}
+
+void FolderIndex::watch(const QString& dir) {
+    if (watched.contains(dir) || !QDir(dir).exists())
+        return;
+
+    if (watcher.isNull()) {
+        watcher = new QFileSystemWatcher(QCoreApplication::instance());
+        QObject::connect(watcher.data(), &QFileSystemWatcher::directoryChanged,
+                         [this](const QString& path) { folderChanged(path); });
+    }
+
+    if (watcher->addPath(dir))
+        watched.insert(dir);
+}
+
+void FolderIndex::stamp(const QString& dir) {
+    stamps.insert(dir, QFileInfo(dir).lastModified());
+}
+
+void FolderIndex::folderChanged(const QString& dir) {
+    changedFolders.insert(dir);
+
+    if (rescanTimer.isNull()) {
+        rescanTimer = new QTimer(QCoreApplication::instance());
+        rescanTimer->setSingleShot(true);
+        rescanTimer->setInterval(FOLDER_RESCAN_DELAY);
+        QObject::connect(rescanTimer.data(), &QTimer::timeout, [this]() { rescan(); });
+    }
+
+    // Our own downloads change the directory all the time, don't postpone the rescan for them
+    if (!rescanTimer->isActive())
+        rescanTimer->start();
+}
+
+void FolderIndex::rescan() {
+    foreach (QString dir, changedFolders) {
+        if (!folders.contains(dir))
+            continue;
+
+        if (!QDir(dir).exists()) {
+            // The watcher dropped it, add() watches it again once it is recreated
+            watched.remove(dir);
+            folders[dir].clear();
+            stamps.remove(dir);
+        }
+        else if (QFileInfo(dir).lastModified() != stamps.value(dir)) {
+            // Changed by someone else since our last write
+            scan(dir);
+        }
+    }
+
+    changedFolders.clear();
+}
@@ -0,0 +1,52 @@
+#ifndef FOLDERINDEX_H
+#define FOLDERINDEX_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QPointer>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+// A directory changed by someone else is read again at most this often (ms)
+#define FOLDER_RESCAN_DELAY 1000
+
+/**
+ * The names of the files in every save directory, so finding out whether an
+ * image is already on disk doesn't cost a stat call. A directory is read
+ * once on its first lookup, then kept current by add() and remove() for our
+ * own writes and by a QFileSystemWatcher for changes made by others. The
+ * watcher also reports our own writes; a directory whose modification time
+ * is still the one seen after our last write is not read again. Only used
+ * from the main thread.
+ */
+class FolderIndex
+{
+public:
+    static FolderIndex& instance();
+
+    bool contains(const QString& filename);
+    void add(const QString& filename);
+    void remove(const QString& filename);
+
+private:
+    FolderIndex() {}
+
+    QHash<QString, QSet<QString> > folders;
+    QHash<QString, QDateTime> stamps;  // modification time after our last scan or write
+    QSet<QString> watched;
+    QSet<QString> changedFolders;
+    QPointer<QFileSystemWatcher> watcher;
+    QPointer<QTimer> rescanTimer;
+
+    static void split(const QString& filename, QString* dir, QString* name);
+    QSet<QString>& folder(const QString& dir);
+    void scan(const QString& dir);
+    void watch(const QString& dir);
+    void stamp(const QString& dir);
+    void folderChanged(const QString& dir);
+    void rescan();
+};
+
+#endif // FOLDERINDEX_H
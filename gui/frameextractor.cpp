@@ -0,0 +1,155 @@
+#include <QFile>
+
+#include "QsLog.h"
+
+#include "frameextractor.h"
+
+#ifdef HAVE_LIBAV
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+}
+
+namespace {
+  // Only the first frames of a file are looked at, a preview is not worth
+  // demuxing a whole video for
+  const int MAX_PACKETS = 256;
+
+  class LibavFrameExtractor : public chandl::FrameExtractor {
+  public:
+    bool extractFrame(const QString& filename, QSize maxSize, QImage* frame,
+                      QSize* frameSize) override;
+
+  private:
+    bool decodeFirstFrame(AVFormatContext* format, int stream, AVCodecContext* codec,
+                          AVFrame* decoded);
+  };
+
+  bool LibavFrameExtractor::extractFrame(const QString& filename, QSize maxSize, QImage* frame,
+                                         QSize* frameSize)
+  {
+    QByteArray path = QFile::encodeName(filename);
+    AVFormatContext* format = nullptr;
+    AVCodecContext* codec = nullptr;
+    AVFrame* decoded = nullptr;
+    bool ret = false;
+
+    if (avformat_open_input(&format, path.constData(), nullptr, nullptr) < 0) {
+      QLOG_TRACE() << "FrameExtractor :: Cannot open" << filename;
+      return false;
+    }
+
+    int stream = -1;
+    if (avformat_find_stream_info(format, nullptr) >= 0) {
+      stream = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    }
+
+    if (stream >= 0) {
+      const AVCodec* decoder = avcodec_find_decoder(format->streams[stream]->codecpar->codec_id);
+
+      if (decoder) {
+        codec = avcodec_alloc_context3(decoder);
+      }
+
+      if (codec
+        && avcodec_parameters_to_context(codec, format->streams[stream]->codecpar) >= 0) {
+        // The caller is a worker thread already
+        codec->thread_count = 1;
+        if (avcodec_open2(codec, decoder, nullptr) >= 0) {
+          decoded = av_frame_alloc();
+          ret = decoded && decodeFirstFrame(format, stream, codec, decoded);
+        }
+      }
+    }
+
+    if (ret) {
+      QSize size(decoded->width, decoded->height);
+      QSize target = size;
+
+      if (maxSize.isValid() && (size.width() > maxSize.width() || size.height() > maxSize.height())) {
+        target = size.scaled(maxSize, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+      }
+
+      SwsContext* sws = sws_getContext(size.width(), size.height(), static_cast<AVPixelFormat>(decoded->format),
+                                       target.width(), target.height(), AV_PIX_FMT_RGB32,
+                                       SWS_BILINEAR, nullptr, nullptr, nullptr);
+      if (sws) {
+        QImage image(target, QImage::Format_RGB32);
+        uint8_t* dst[4] = { image.bits(), nullptr, nullptr, nullptr };
+        int dstStride[4] = { static_cast<int>(image.bytesPerLine()), 0, 0, 0 };
+
+        sws_scale(sws, decoded->data, decoded->linesize, 0, size.height(), dst, dstStride);
+        sws_freeContext(sws);
+
+        *frame = image;
+        if (frameSize) {
+          *frameSize = size;
+        }
+      }
+      else {
+        ret = false;
+      }
+    }
+
+    av_frame_free(&decoded);
+    avcodec_free_context(&codec);
+    avformat_close_input(&format);
+
+    return ret;
+  }
+
+  bool LibavFrameExtractor::decodeFirstFrame(AVFormatContext* format, int stream, AVCodecContext* codec,
+                                             AVFrame* decoded)
+  {
+    AVPacket* packet = av_packet_alloc();
+    bool ret = false;
+
+    if (!packet) {
+      return false;
+    }
+
+    for (int i = 0; i < MAX_PACKETS && !ret && av_read_frame(format, packet) >= 0; i++) {
+      if (packet->stream_index == stream && avcodec_send_packet(codec, packet) >= 0) {
+        ret = (avcodec_receive_frame(codec, decoded) >= 0);
+      }
+      av_packet_unref(packet);
+    }
+
+    if (!ret) {
+      // Very short files: drain whatever the decoder still holds
+      avcodec_send_packet(codec, nullptr);
+      ret = (avcodec_receive_frame(codec, decoded) >= 0);
+    }
+
+    av_packet_free(&packet);
+
+    return ret;
+  }
+}
+#endif
+
+namespace chandl {
+  std::unique_ptr<FrameExtractor> FrameExtractor::create()
+  {
+#ifdef HAVE_LIBAV
+    return std::unique_ptr<FrameExtractor>(new LibavFrameExtractor());
+#else
+    return nullptr;
+#endif
+  }
+
+  bool FrameExtractor::available()
+  {
+#ifdef HAVE_LIBAV
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  bool FrameExtractor::isVideo(const QString& filename)
+  {
+    return filename.endsWith(".webm", Qt::CaseInsensitive);
+  }
+}
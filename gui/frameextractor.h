@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+namespace chandl {
+  // Grabs a still frame out of a video file, used for thumbnails and as the
+  // poster frame in the image viewer. The backend is picked at build time;
+  // without one, create() returns nullptr and videos keep the placeholder.
+  // An extractor is not thread safe, every worker thread creates its own.
+  class FrameExtractor {
+  public:
+    virtual ~FrameExtractor() = default;
+
+    // Decodes the first keyframe of filename. If maxSize is valid the frame
+    // is scaled down to fit into it. frameSize receives the video resolution.
+    virtual bool extractFrame(const QString& filename, QSize maxSize, QImage* frame,
+                              QSize* frameSize = nullptr) = 0;
+
+    static std::unique_ptr<FrameExtractor> create();
+    static bool available();
+    static bool isVideo(const QString& filename);
+  };
+}
@@ -35,7 +35,19 @@ SOURCES += main.cpp\
     thumbnailcreator.cpp \
     thumbnailremover.cpp \
     uipendingrequests.cpp \
-    HtmlEntities.cpp
+    HtmlEntities.cpp \
+    settingssnapshot.cpp \
+    downloadmetrics.cpp \
+    threaddownloadengine.cpp \
+    downloadworker.cpp \
+    threadtab.cpp \
+    sessionstore.cpp \
+    threadoverviewmodel.cpp \
+    imagedecoder.cpp \
+    frameextractor.cpp \
+    boardwatchengine.cpp \
+    parsermetrics.cpp \
+    folderindex.cpp
 
 HEADERS  += mainwindow.h \
     uiimageoverview.h \
@@ -63,7 +75,19 @@ HEADERS  += mainwindow.h \
     thumbnailcreator.h \
     thumbnailremover.h \
     uipendingrequests.h \
-    HtmlEntities.h
+    HtmlEntities.h \
+    settingssnapshot.h \
+    downloadmetrics.h \
+    threaddownloadengine.h \
+    downloadworker.h \
+    threadtab.h \
+    sessionstore.h \
+    threadoverviewmodel.h \
+    imagedecoder.h \
+    frameextractor.h \
+    boardwatchengine.h \
+    parsermetrics.h \
+    folderindex.h
 
 FORMS    += mainwindow.ui \
     uiimageoverview.ui \
@@ -90,7 +114,14 @@ DEFINES += BUILDDATE=$${BUILDDATE} PROGRAM_VERSION="\\\"$${VERSION}\\\"" __GUI__
 #DEFINES += QT_NO_URL_CAST_FROM_STRING
 #DEFINES += QT_NO_CAST_FROM_ASCII
 
-win32: LIBS += libole32
+win32: LIBS += libole32 -lpsapi
+
+# Thumbnails and poster frames for webm need FFmpeg
+packagesExist(libavformat libavcodec libswscale libavutil) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libavformat libavcodec libswscale libavutil
+    DEFINES += HAVE_LIBAV
+}
 
 OTHER_FILES += \
     readme.txt \
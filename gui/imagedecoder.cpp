@@ -0,0 +1,203 @@
+#include <QImageReader>
+
+#include "QsLog.h"
+
+#include "imagedecoder.h"
+#include "frameextractor.h"
+
+ImageDecoder::ImageDecoder() :
+  QThread(nullptr)
+{
+}
+
+ImageDecoder::~ImageDecoder() {
+  stopped = true;
+  condition.wakeAll();
+  wait();
+}
+
+void ImageDecoder::run() {
+  auto frames = chandl::FrameExtractor::create();
+
+  while (!stopped) {
+    QString currentFilename;
+    QSize size;
+
+    {
+      QMutexLocker lock(&mutex);
+      qint64 limit = qint64(chandl::settingsSnapshot()->viewerCacheSize) * 1024 * 1024;
+
+      currentFilename = nextImage(limit);
+      if (currentFilename.isEmpty()) {
+        condition.wait(&mutex);
+        continue;
+      }
+      size = targetSize;
+    }
+
+    QImageReader reader(currentFilename);
+    QSize originalSize;
+    QImage image;
+
+    if (chandl::FrameExtractor::isVideo(currentFilename)) {
+      // Videos are shown as their poster frame
+      if (frames) {
+        frames->extractFrame(currentFilename, size, &image, &originalSize);
+      }
+    }
+    else {
+      reader.setAutoTransform(true);
+      originalSize = reader.size();
+      if (size.isValid() && originalSize.isValid()
+        && (originalSize.width() > size.width() || originalSize.height() > size.height())) {
+        // Most formats (JPEG in particular) decode straight into the smaller size
+        reader.setScaledSize(originalSize.scaled(size, Qt::KeepAspectRatio));
+      }
+
+      image = reader.read();
+    }
+
+    QMutexLocker lock(&mutex);
+    if (size != targetSize) {
+      // The viewer was resized or switched fitting while decoding
+      continue;
+    }
+
+    if (image.isNull()) {
+      QLOG_TRACE() << "ImageDecoder :: Could not decode" << currentFilename;
+      failed.insert(currentFilename);
+      emit decodeFailed(currentFilename);
+      continue;
+    }
+
+    if (!originalSize.isValid()) {
+      originalSize = image.size();
+    }
+
+    Entry e;
+    e.image = image;
+    e.originalSize = originalSize;
+    e.lastUsed = ++useCounter;
+    cache.insert(currentFilename, e);
+    cacheBytes += image.sizeInBytes();
+    QLOG_TRACE() << "ImageDecoder :: Decoded" << currentFilename << "(" << cacheBytes / 1024 << "kB cached)";
+
+    trimCache(qint64(chandl::settingsSnapshot()->viewerCacheSize) * 1024 * 1024);
+
+    emit imageDecoded(currentFilename);
+  }
+}
+
+// Called with the mutex held
+QString ImageDecoder::nextImage(qint64 limit) {
+  for (int i = 0; i < wanted.count(); i++) {
+    const QString& filename = wanted.at(i);
+
+    if (cache.contains(filename) || failed.contains(filename)) {
+      continue;
+    }
+
+    // The current image is decoded even if the cache is full
+    if (i == 0 || cacheBytes < limit) {
+      return filename;
+    }
+    break;
+  }
+
+  return QString();
+}
+
+// Called with the mutex held. Images outside the window go first, least
+// recently used first, then the ones farthest away from the current image.
+void ImageDecoder::trimCache(qint64 limit) {
+  while (cacheBytes > limit) {
+    QString victim;
+    quint64 oldest = 0;
+
+    for (auto it = cache.constBegin(); it != cache.constEnd(); ++it) {
+      if (!wanted.contains(it.key()) && (victim.isEmpty() || it.value().lastUsed < oldest)) {
+        victim = it.key();
+        oldest = it.value().lastUsed;
+      }
+    }
+
+    if (victim.isEmpty()) {
+      for (int i = wanted.count() - 1; i > 0; i--) {
+        if (cache.contains(wanted.at(i))) {
+          victim = wanted.at(i);
+          // Do not decode what does not fit anyway
+          wanted = wanted.mid(0, i);
+          break;
+        }
+      }
+    }
+
+    if (victim.isEmpty()) {
+      break;
+    }
+
+    cacheBytes -= cache.take(victim).image.sizeInBytes();
+  }
+}
+
+void ImageDecoder::setTargetSize(QSize s) {
+  QMutexLocker lock(&mutex);
+
+  if (s != targetSize) {
+    targetSize = s;
+    cache.clear();
+    failed.clear();
+    cacheBytes = 0;
+  }
+}
+
+void ImageDecoder::setWindow(QStringList images, int current, int window) {
+  QStringList list;
+  int count = images.count();
+
+  if (current >= 0 && current < count) {
+    list.append(images.at(current));
+    for (int d = 1; d <= window && d * 2 <= count; d++) {
+      list.append(images.at((current + d) % count));
+      list.append(images.at((current - d + count) % count));
+    }
+    list.removeDuplicates();
+  }
+
+  for (int i = list.count() - 1; i >= 0; i--) {
+    // Animations are played by the viewer, videos need a frame extractor
+    if (list.at(i).endsWith(".gif")
+      || (chandl::FrameExtractor::isVideo(list.at(i)) && !chandl::FrameExtractor::available())) {
+      list.removeAt(i);
+    }
+  }
+
+  mutex.lock();
+  wanted = list;
+  // Files may have finished downloading since the last attempt
+  failed.clear();
+  trimCache(qint64(chandl::settingsSnapshot()->viewerCacheSize) * 1024 * 1024);
+  mutex.unlock();
+
+  condition.wakeAll();
+}
+
+bool ImageDecoder::lookup(QString filename, QImage* image, QSize* originalSize) {
+  QMutexLocker lock(&mutex);
+  auto it = cache.find(filename);
+
+  if (it == cache.end()) {
+    return false;
+  }
+
+  it->lastUsed = ++useCounter;
+  *image = it->image;
+  *originalSize = it->originalSize;
+
+  return true;
+}
+
+void ImageDecoder::stop() {
+  stopped = true;
+  condition.wakeAll();
+}
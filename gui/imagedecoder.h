@@ -0,0 +1,65 @@
+#ifndef IMAGEDECODER_H
+#define IMAGEDECODER_H
+
+#include <QObject>
+#include <QImage>
+#include <QHash>
+#include <QSet>
+#include <QSize>
+#include <QStringList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
+
+#include "settingssnapshot.h"
+
+// Decodes the neighbours of the image shown in the image viewer ahead of time
+// into a cache that is bounded by viewerCacheSize, so stepping through images
+// does not block the GUI thread.
+class ImageDecoder : public QThread
+{
+  Q_OBJECT
+public:
+  ImageDecoder();
+  ~ImageDecoder();
+
+  // Images are scaled down to fit into s while decoding. An invalid size
+  // decodes them at full resolution. Changing the size drops the cache.
+  void setTargetSize(QSize s);
+  // Replaces the queue with images[current] and its neighbours up to window
+  // steps away in both directions, nearest first
+  void setWindow(QStringList images, int current, int window);
+  // Returns true if filename has been decoded for the current target size
+  bool lookup(QString filename, QImage* image, QSize* originalSize);
+
+  void stop();
+
+private:
+  struct Entry {
+    QImage image;
+    QSize originalSize;
+    quint64 lastUsed = 0;
+  };
+
+  QStringList wanted;
+  QHash<QString, Entry> cache;
+  QSet<QString> failed;
+  QSize targetSize;
+  qint64 cacheBytes = 0;
+  quint64 useCounter = 0;
+  QAtomicInt stopped = false;
+  QMutex mutex;
+  QWaitCondition condition;
+
+  QString nextImage(qint64 limit);
+  void trimCache(qint64 limit);
+
+signals:
+  void imageDecoded(QString);
+  void decodeFailed(QString);
+
+private:
+  void run() override;
+};
+
+#endif // IMAGEDECODER_H
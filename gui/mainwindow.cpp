@@ -67,6 +67,9 @@ MainWindow::MainWindow(std::shared_ptr<DownloadManager> downloadManager_,
 
     ui->tabWidget->removeTab(0);
     oldActiveTabIndex = 0;
+
+    overviewModel = new ThreadOverviewModel(this);
+    ui->threadOverview->setModel(overviewModel);
     pendingThumbnailsChanged(0);
 
     // Thread overview
@@ -81,9 +84,10 @@ MainWindow::MainWindow(std::shared_ptr<DownloadManager> downloadManager_,
 //    connect(requestHandler, SIGNAL(responseError(QUrl,int)), this, SLOT(handleRequestError(QUrl,int)));
 
     connect(ui->tabWidget, SIGNAL(tabCloseRequested(int)), this, SLOT(closeTab(int)));
+    // Publish the new settings snapshot first, the download manager follows its changed() signal
+    connect(uiConfig, SIGNAL(configurationChanged()), &chandl::SettingsStore::instance(), SLOT(reload()));
     connect(uiConfig, SIGNAL(configurationChanged()), this, SLOT(loadOptions()));
     connect(uiConfig, SIGNAL(configurationChanged()), blackList, SLOT(loadSettings()));
-    connect(uiConfig, SIGNAL(configurationChanged()), downloadManager.get(), SLOT(loadSettings()));
     connect(uiConfig, SIGNAL(deleteAllThumbnails()), thumbnailRemover, SLOT(removeAll()));
     connect(ui->actionStart_all, SIGNAL(triggered()), this, SLOT(startAll()));
     connect(ui->actionStop_all, SIGNAL(triggered()), this, SLOT(stopAll()));
@@ -133,9 +137,9 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
-QPointer<UIImageOverview> MainWindow::addTab() {
+QPointer<ThreadTab> MainWindow::addTab() {
     int ci;
-    auto tab = new UIImageOverview(downloadManager, pluginManager, folderShortcuts, thumbnailCreator, this);
+    auto tab = new ThreadTab(downloadManager, pluginManager, folderShortcuts, thumbnailCreator, this);
     tab->setBlackList(blackList);
 
     ci = ui->tabWidget->addTab(tab, "no name");
@@ -143,20 +147,23 @@ QPointer<UIImageOverview> MainWindow::addTab() {
         tab->setDirectory(defaultDirectory);
 
     connect(tab, SIGNAL(errorMessage(QString)), this, SLOT(displayError(QString)));
-    connect(tab, SIGNAL(tabTitleChanged(UIImageOverview*, QString)), this, SLOT(changeTabTitle(UIImageOverview*, QString)));
-    connect(tab, SIGNAL(closeRequest(UIImageOverview*, int)), this, SLOT(processCloseRequest(UIImageOverview*, int)));
+    connect(tab, SIGNAL(tabTitleChanged(ThreadTab*, QString)), this, SLOT(changeTabTitle(ThreadTab*, QString)));
+    connect(tab, SIGNAL(closeRequest(ThreadTab*, int)), this, SLOT(processCloseRequest(ThreadTab*, int)));
     connect(tab, SIGNAL(directoryChanged(QString)), this, SLOT(setDefaultDirectory(QString)));
     connect(tab, SIGNAL(createTabRequest(QString)), this, SLOT(createTab(QString)));
     connect(tab, SIGNAL(removeFiles(QStringList)), this, SIGNAL(removeFiles(QStringList)));
+    // The model has to see changed() first to mark the row dirty
+    overviewModel->appendThread(tab);
     connect(tab, SIGNAL(changed()), this, SLOT(scheduleOverviewUpdate()));
+    connect(tab, SIGNAL(changed()), this, SLOT(threadChanged()));
 
     changeTabTitle(tab, "idle");
 
     return tab;
 }
 
-QPointer<UIImageOverview> MainWindow::addForegroundTab() {
-  QPointer<UIImageOverview> tab;
+QPointer<ThreadTab> MainWindow::addForegroundTab() {
+  QPointer<ThreadTab> tab;
   QStringList sl;
 
     if (threadExists(QApplication::clipboard()->text())) {
@@ -172,15 +179,15 @@ QPointer<UIImageOverview> MainWindow::addForegroundTab() {
     return tab;
 }
 
-QPointer<UIImageOverview> MainWindow::getTabOverview(int index)
+QPointer<ThreadTab> MainWindow::getTab(int index)
 {
   auto widget = ui->tabWidget->widget(index);
-  return qobject_cast<UIImageOverview*>(widget);
+  return qobject_cast<ThreadTab*>(widget);
 }
 
 void MainWindow::createTab(QString values) {
     int index;
-    UIImageOverview* w;
+    ThreadTab* w;
     QStringList sl;
 
     sl = values.split(";;");
@@ -189,6 +196,7 @@ void MainWindow::createTab(QString values) {
         auto tab = addTab();
         tab->setValues(values);
         tab->setAttribute(Qt::WA_DeleteOnClose, true);
+        indexThread(tab);   // Front pages open many threads at once, all of them have to be known right away
     }
     else {
         QLOG_INFO() << "MainWindow :: Prevented opening of thread" << sl.at(0) << "because it's already open.";
@@ -196,14 +204,16 @@ void MainWindow::createTab(QString values) {
 }
 
 void MainWindow::closeTab(int i) {
-    UIImageOverview* w;
+    ThreadTab* w;
 
 //    ui->tabWidget->setCurrentIndex(i);
-    w = (UIImageOverview*)ui->tabWidget->widget(i);
+    w = (ThreadTab*)ui->tabWidget->widget(i);
 
     addToHistory(w->getValues(), w->getTitle());
 
     if (w->close()) {
+        overviewModel->removeThread(w);
+        unindexThread(w);
         ui->tabWidget->removeTab(i);
         w->deleteLater();
         QLOG_TRACE() << "MainWindow :: widget" << i << "closed";
@@ -235,7 +245,7 @@ void MainWindow::setDefaultDirectory(QString d) {
         defaultDirectory = d;
 }
 
-void MainWindow::changeTabTitle(UIImageOverview* w, QString s) {
+void MainWindow::changeTabTitle(ThreadTab* w, QString s) {
     int i;
 
     i = ui->tabWidget->indexOf((QWidget*)w);
@@ -267,8 +277,10 @@ void MainWindow::restoreWindowSettings(void) {
 
 void MainWindow::restoreTabs() {
     int tabCount;
+    QList<chandl::ThreadRecord> records;
 
-    tabCount = settings.getTabsCount();
+    records = sessionStore.load();
+    tabCount = records.isEmpty() ? settings.getTabsCount() : records.count();
     downloadManager->pauseDownloads();
 
     ui->pbOpenRequests->setMaximum(tabCount);
@@ -278,7 +290,11 @@ void MainWindow::restoreTabs() {
     if (settings.getResumeSession() && tabCount > 0) {
         for (int i = 0; i < tabCount; i++) {
             auto tab = addTab();
-            tab->setValues(settings.getTabValues(i));
+            if (records.isEmpty())
+                tab->setValues(settings.getTabValues(i));   // Session from settings.ini of an older version
+            else
+                tab->restoreSession(records.at(i));
+            indexThread(tab);
             ui->pbOpenRequests->setValue((i+1));
         }
     } else {
@@ -310,12 +326,17 @@ void MainWindow::saveSettings(void) {
     settings.setThreadOverviewUriWidth(ui->threadOverview->columnWidth(TOC_URI_WIDTH));
     settings.setThreadOverviewVisible(ui->threadOverview->isVisible());
 
-    // Active tabs
-    settings.clearTabs();
-    settings.setTabsCount(ui->tabWidget->count());
+    // Active tabs, only the ones that changed are written
+    QList<chandl::ThreadRecord> records;
     for (int i = 0; i < ui->tabWidget->count(); i++) {
-      auto tab = getTabOverview(i);
-      settings.setTabValues(i, tab->getValues());
+      auto tab = getTab(i);
+      records << tab->sessionRecord();
+    }
+    if (!sessionStore.save(records)) {
+        QLOG_ERROR() << "MainWindow :: Saving the session failed";
+    }
+    else if (settings.getTabsCount() > 0) {
+        settings.clearTabs();       // Migrated to the session store
     }
 
     settings.setDownloadedFilesStatistic(downloadManager->getStatisticsFiles());
@@ -370,7 +391,7 @@ void MainWindow::loadOptions(void) {
   ui->threadOverview->setColumnWidth(TOC_URI_WIDTH, settings.getThreadOverviewUriWidth());
 }
 
-void MainWindow::processCloseRequest(UIImageOverview* w, int reason) {
+void MainWindow::processCloseRequest(ThreadTab* w, int reason) {
     int i;
     i = ui->tabWidget->indexOf((QWidget*)w);
 
@@ -385,7 +406,7 @@ void MainWindow::processCloseRequest(UIImageOverview* w, int reason) {
     }
 }
 
-void MainWindow::processRequestResponse(QUrl url, QByteArray ba, bool cached) {
+void MainWindow::processRequestResponse(const QUrl& url, const QByteArray& ba, bool cached) {
 
     if (url.toString().contains("webupdate.xml")) {
         checkForUpdates(QString(ba));
@@ -397,7 +418,7 @@ void MainWindow::processRequestResponse(QUrl url, QByteArray ba, bool cached) {
 
 void MainWindow::updateWidgetSettings(void) {
     for (int i=0; i<ui->tabWidget->count(); i++) {
-        ((UIImageOverview*)ui->tabWidget->widget(i))->updateSettings();
+        ((ThreadTab*)ui->tabWidget->widget(i))->updateSettings();
     }
 }
 
@@ -494,7 +515,7 @@ void MainWindow::startAll() {
     ui->pbOpenRequests->setMaximum(ui->tabWidget->count());
 
     for (int i=0; i<ui->tabWidget->count(); i++) {
-        ((UIImageOverview*)ui->tabWidget->widget(i))->start();
+        ((ThreadTab*)ui->tabWidget->widget(i))->start();
         ui->pbOpenRequests->setValue((i+1));
     }
 }
@@ -519,7 +540,7 @@ void MainWindow::stopAll() {
     ui->pbOpenRequests->setMaximum(ui->tabWidget->count());
 
     for (int i=0; i<ui->tabWidget->count(); i++) {
-        ((UIImageOverview*)ui->tabWidget->widget(i))->stop();
+        ((ThreadTab*)ui->tabWidget->widget(i))->stop();
         ui->pbOpenRequests->setValue((i+1));
     }
 }
@@ -541,14 +562,14 @@ void MainWindow::addMultipleTabs() {
     threadAdder->show();
 }
 
-void MainWindow::showTab(QTreeWidgetItem* item, int idx) {
+void MainWindow::showTab(QModelIndex idx) {
     int index;
 
-    index = ui->threadOverview->indexOfTopLevelItem(item);
+    index = idx.isValid() ? idx.row() : -1;
 
-    if (index != -1) {
+    if (index != -1 && index < ui->tabWidget->count()) {
         ui->tabWidget->setCurrentIndex(index);
-        ((UIImageOverview*)(ui->tabWidget->currentWidget()))->threadViewed();
+        ((ThreadTab*)(ui->tabWidget->currentWidget()))->threadViewed();
     }
 }
 
@@ -571,60 +592,9 @@ void MainWindow::overviewTimerTimeout() {
 }
 
 void MainWindow::updateThreadOverview() {
-//    QList<QTreeWidgetItem *> items;
-    QStringList sl;
-
+    // Rows of hidden overviews stay dirty until the dock is shown again
     if (ui->threadOverview->isVisible()) {
-//        QLOG_TRACE() << "MainWindow :: updating thread overview";
-//        ui->threadOverview->clear();
-
-        for (int i=0; i<ui->tabWidget->count(); i++) {
-            UIImageOverview* tab;
-            QTreeWidgetItem* item;
-            sl.clear();
-
-            tab = (UIImageOverview*)(ui->tabWidget->widget(i));
-            sl << tab->getTitle();
-            sl << QString("%1/%2").arg(tab->getDownloadedImagesCount()).arg(tab->getTotalImagesCount());
-            sl << tab->getStatus();
-            sl << tab->getURI();
-
-            QLOG_DEBUG() << __func__ << "::" << i << ":" << sl;
-
-            if (ui->threadOverview->topLevelItemCount() > i) {                   // If there is an entry for the i-th tab
-                item = ui->threadOverview->topLevelItem(i);     //  change its content
-                QFont f = item->font(0);
-                for (int k=0; k<4; k++) {
-
-                    if (k == 0) {
-                        if (tab->hasNewImages()) {
-                            item->setTextColor(0, Qt::darkGreen);
-                            f.setBold(true);
-                            item->setFont(0, f);
-                            QLOG_TRACE() << __func__ << "tab" << i << "Changing font to bold/red";
-                        }
-                        else {
-                            item->setTextColor(0, Qt::black);
-                            f.setBold(false);
-                            item->setFont(0, f);
-                            QLOG_TRACE() << __func__ << "tab" << i << "Changing font to normal";
-                        }
-                    }
-                    item->setText(k, sl.at(k));
-                }
-            }
-            else {                                              // Otherwise create a new one and append it
-                ui->threadOverview->addTopLevelItem(new QTreeWidgetItem(ui->threadOverview, sl));
-            }
-        }
-
-        // Remove obsolete rows of overview (if any)
-        if (ui->threadOverview->topLevelItemCount() > ui->tabWidget->count()) {
-            for (int i=ui->threadOverview->topLevelItemCount(); i>=ui->tabWidget->count(); --i) {
-                ui->threadOverview->takeTopLevelItem(i);
-            }
-        }
-//        ui->threadOverview->insertTopLevelItems(0, items);
+        overviewModel->update();
     }
 }
 
@@ -633,27 +603,98 @@ void MainWindow::debugButton() {
 }
 
 bool MainWindow::threadExists(QString url) {
-    bool ret;
-    int count;
-    QString widgetUri;
+    QString key;
 
-    ret = false;
-    count = 0;
+    key = threadKey(url);
 
-    for (int i=0; i<ui->tabWidget->count(); i++) {
-        widgetUri = ((UIImageOverview*)ui->tabWidget->widget(i))->getURI();
+    return !key.isEmpty() && openThreads.value(key, 0) > 0;
+}
 
-        if ( widgetUri.left(widgetUri.lastIndexOf("#")) == url.left(url.lastIndexOf("#"))) {
-            count++;
-        }
-    }
+/**
+ * Canonical form of a thread URL: the URL the parser would request, without
+ * scheme, "www.", fragment, trailing slash and .json/.html suffix
+ */
+QString MainWindow::threadKey(QString url) {
+    QString ret;
+    QString path;
+    QUrl u;
+    ParserPluginInterface* parser;
+    bool ok;
+
+    ret = url.trimmed();
+    if (ret.isEmpty())
+        return ret;
+
+    if (!ret.startsWith("http"))
+        ret.prepend("http://");
+
+    u = QUrl(ret);
+    u.setFragment(QString());
+
+    parser = pluginManager->getParser(u, &ok);
+    if (ok)
+        u = parser->alterUrl(u);
 
-    if (count > 0)
-        ret = true;
+    ret = u.host().toLower();
+    if (ret.startsWith("www."))
+        ret.remove(0, 4);
+
+    path = u.path();
+    while (path.endsWith("/"))
+        path.chop(1);
+    path.remove(QRegExp("\\.(json|html?)$", Qt::CaseInsensitive));
+
+    ret.append(path);
+    if (u.hasQuery())
+        ret.append("?" + u.query());
 
     return ret;
 }
 
+/**
+ * Keeps the open thread index in sync with the URI of tab
+ */
+void MainWindow::indexThread(ThreadTab* tab) {
+    QString uri;
+    QString key;
+
+    uri = tab->getURI();
+    if (tabUris.contains(tab) && tabUris.value(tab) == uri)
+        return;
+
+    unindexThread(tab);
+
+    key = threadKey(uri);
+    tabUris.insert(tab, uri);
+    tabKeys.insert(tab, key);
+    if (!key.isEmpty())
+        openThreads.insert(key, openThreads.value(key, 0) + 1);
+}
+
+void MainWindow::unindexThread(ThreadTab* tab) {
+    QString key;
+    int count;
+
+    if (tabKeys.contains(tab)) {
+        key = tabKeys.take(tab);
+        tabUris.remove(tab);
+
+        count = openThreads.value(key, 0) - 1;
+        if (count > 0)
+            openThreads.insert(key, count);
+        else
+            openThreads.remove(key);
+    }
+}
+
+void MainWindow::threadChanged() {
+    ThreadTab* tab;
+
+    tab = qobject_cast<ThreadTab*>(sender());
+    if (tab != 0)
+        indexThread(tab);
+}
+
 void MainWindow::addToHistory(QString s, QString title="") {
     QStringList sl;
     QString key;
@@ -717,7 +758,7 @@ void MainWindow::removeSupervisedDownload(QUrl url) {
 
 void MainWindow::checkForUpdates(QString xml) {
     QRegExp rx(QString("<%1>([\\w\\W]+[^<])+</%1>").arg(UPDATE_TREE), Qt::CaseInsensitive, QRegExp::RegExp2);
-    QRegExp rxFile("<file name=\"([^\\\"]+)\" filename=\"([^\\\"]+)\" type=\"([^\\\"]+)\" version=\"([\\w\\.]*)\" source=\"([\\w:\\-\\./\\+]+)\" target=\"([^\\\"]+)\" />", Qt::CaseInsensitive, QRegExp::RegExp2);
+    QRegExp rxFile("<file name=\"([^\\\"]+)\" filename=\"([^\\\"]+)\" type=\"([^\\\"]+)\" version=\"([\\w\\.]*)\" source=\"([\\w:\\-\\./\\+]+)\" target=\"([^\\\"]+)\"(?: sha256=\"([0-9a-fA-F]{64})\")? />", Qt::CaseInsensitive, QRegExp::RegExp2);
     int pos, posFile;
     QStringList res, resFile;
     QMap<QString, component_information> comp;
@@ -744,6 +785,7 @@ void MainWindow::checkForUpdates(QString xml) {
                 c.version = resFile.at(4);
                 c.src = resFile.at(5);
                 c.target = resFile.at(6);
+                c.sha256 = resFile.at(7);
 
                 if (c.filename == APP_NAME && c.type == "executable") {
                     uiInfo->setCurrentVersion(c.version);
@@ -766,6 +808,7 @@ void MainWindow::checkForUpdates(QString xml) {
                 updateableComponents.append(key);
                 local.src = remote.src;
                 local.target = remote.target;
+                local.sha256 = remote.sha256;
                 local.remote_version = remote.version;
                 components.insert(key,local);
                 runUpdate = true;
@@ -930,7 +973,7 @@ void MainWindow::updaterConnected() {
 
             foreach (QString component, updateableComponents) {
                 c = components.value(component);
-                fileList.append(QString("%1->%2").arg(c.src).arg(c.target));
+                fileList.append(QString("%1->%2->%3").arg(c.src).arg(c.target).arg(c.sha256));
             }
             aui->addFiles(fileList);
             aui->startUpdate();
@@ -1058,27 +1101,8 @@ void MainWindow::aboutToQuit() {
     emit quitAll();
 }
 
-void MainWindow::removeThreadOverviewMark() {
-    for (int i=0; i<ui->threadOverview->topLevelItemCount(); i++) {
-        ui->threadOverview->topLevelItem(i)->setIcon(0, QIcon());
-    }
-}
-
-void MainWindow::addThreadOverviewMark(QTreeWidgetItem* item) {
-    removeThreadOverviewMark();
-
-    item->setIcon(0, QIcon(":/icons/resources/go-next.png"));
-}
-
 void MainWindow::addThreadOverviewMark(int index) {
-    QList<QTreeWidgetItem*> foundItems;
-
-    if (ui->tabWidget->count() > 0) {
-        foundItems = ui->threadOverview->findItems(((UIImageOverview*)(ui->tabWidget->widget(index)))->getURI(), Qt::MatchExactly, 3 );
-        if (foundItems.count() == 1) {
-            addThreadOverviewMark(foundItems.at(0));
-        }
-    }
+    overviewModel->setCurrentRow(index);
 }
 
 void MainWindow::cleanThreadCache() {
@@ -1104,7 +1128,7 @@ void MainWindow::cleanThreadCache() {
         }
 
         for (int i=0; i<ui->tabWidget->count(); i++) {
-            url = ((UIImageOverview*)ui->tabWidget->widget(i))->getURI();
+            url = ((ThreadTab*)ui->tabWidget->widget(i))->getURI();
             cacheFile = downloadManager->getFilenameForURL(QUrl(url));
             threadCachesToRemove.removeAll(cacheFile);
         }
@@ -1117,6 +1141,6 @@ void MainWindow::cleanThreadCache() {
 
 void MainWindow::markAllViewed() {
     for (int i=0; i<ui->tabWidget->count(); i++) {
-        ((UIImageOverview*)ui->tabWidget->widget(i))->threadViewed();
+        ((ThreadTab*)ui->tabWidget->widget(i))->threadViewed();
     }
 }
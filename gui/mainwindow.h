@@ -5,11 +5,13 @@
 #include <QList>
 #include <QSettings>
 #include <QMessageBox>
-#include <QTreeWidget>
+#include <QTreeView>
 #include <QSystemTrayIcon>
 #include <QThread>
 
 #include "uiimageoverview.h"
+#include "threadtab.h"
+#include "threadoverviewmodel.h"
 #include "uiinfo.h"
 #include "uiconfig.h"
 #include "applicationupdateinterface.h"
@@ -21,9 +23,11 @@
 #include "thumbnailremover.h"
 #include "QsLog.h"
 #include "appsettings.h"
+#include "sessionstore.h"
 
 class UIImageViewer;
 class UIImageOverview;
+class ThreadTab;
 class ThumbnailCreator;
 
 namespace Ui {
@@ -48,6 +52,7 @@ public:
 
 private:
     chandl::AppSettings settings;
+    chandl::SessionStore sessionStore;
 
     Ui::MainWindow *ui;
     QList<UIImageOverview> widgetList;
@@ -66,6 +71,7 @@ private:
     ThumbnailRemover* thumbnailRemover;
     int oldActiveTabIndex;
     QTimer* overviewUpdateTimer;
+    ThreadOverviewModel* overviewModel;
     QMenu* historyMenu;
     bool _updateOverview;
     QMap<QString, component_information> components;
@@ -88,6 +94,13 @@ private:
     void checkForUpdates(QString xml);
     bool checkIfNewerVersion(QString _new, QString _old);
     void addToHistory(QString s, QString title);
+
+    QHash<QString, int> openThreads;            // Canonical thread key -> number of tabs
+    QHash<ThreadTab*, QString> tabUris;
+    QHash<ThreadTab*, QString> tabKeys;
+    QString threadKey(QString url);
+    void indexThread(ThreadTab*);
+    void unindexThread(ThreadTab*);
     void removeFromHistory(QString key);
 
     void createSupervisedDownload(QUrl);
@@ -118,24 +131,25 @@ private slots:
     void addMultipleTabs();
     void closeTab(int);
     void displayError(QString);
-    void changeTabTitle(UIImageOverview*, QString);
+    void changeTabTitle(ThreadTab*, QString);
     void showInfo(void);
     void showConfiguration(void);
     void setDefaultDirectory(QString);
     void loadOptions(void);
-    void processCloseRequest(UIImageOverview*, int);
+    void processCloseRequest(ThreadTab*, int);
     void createTab(QString values);
     void startAll(void);
     void pauseAll(void);
     void stopAll(void);
     void pendingThumbnailsChanged(int);
-    void showTab(QTreeWidgetItem*, int);
+    void showTab(QModelIndex);
+    void threadChanged();
     void updateThreadOverview();
     void debugButton();
     void overviewTimerTimeout();
     void scheduleOverviewUpdate();
     void restoreFromHistory(QAction*);
-    void processRequestResponse(QUrl url, QByteArray ba, bool cached);
+    void processRequestResponse(const QUrl& url, const QByteArray& ba, bool cached);
     void updaterConnected();
     void updateFinished();
     void setUpdaterVersion(QString);
@@ -144,8 +158,6 @@ private slots:
     void trayIconActivated(QSystemTrayIcon::ActivationReason ar);
     void toggleThreadOverview();
     void aboutToQuit();
-    void removeThreadOverviewMark();
-    void addThreadOverviewMark(QTreeWidgetItem *item);
     void addThreadOverviewMark(int index);
     void getUpdaterVersion();
     void getConsoleVersion();
@@ -165,9 +177,9 @@ private:
     TOC_URI_WIDTH = 3,
   };
 
-  QPointer<UIImageOverview> addTab();
-  QPointer<UIImageOverview> addForegroundTab();
-  QPointer<UIImageOverview> getTabOverview(int index);
+  QPointer<ThreadTab> addTab();
+  QPointer<ThreadTab> addForegroundTab();
+  QPointer<ThreadTab> getTab(int index);
 };
 
 #endif // MAINWINDOW_H
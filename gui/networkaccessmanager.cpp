@@ -4,16 +4,136 @@ NetworkAccessManager::NetworkAccessManager(QObject *parent) :
     QNetworkAccessManager(parent)
 {
     m_activeRequests = 0;
-    connect(this, SIGNAL(finished(QNetworkReply*)), this, SLOT(requestFinished()));
+    m_openedConnections = 0;
+    m_servedRequests = 0;
+    m_clock.start();
+    connect(this, SIGNAL(finished(QNetworkReply*)), this, SLOT(requestFinished(QNetworkReply*)));
 }
 
 QNetworkReply* NetworkAccessManager::get(const QNetworkRequest &request) {
+    QNetworkRequest req(request);
+    QString host;
+    int active, connections, maxConnections;
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    req.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+#endif
+
     m_activeRequests++;
 
-    return QNetworkAccessManager::get(request);
+    host = req.url().host();
+    active = m_activePerHost.value(host, 0) + 1;
+    m_activePerHost.insert(host, active);
+
+    // Qt reuses idle keep-alive connections to the same host, so a new one is only
+    // opened when none is idle. HTTP/2 hosts multiplex everything over one connection.
+    expireIdleConnections(host);
+    connections = m_connectionsPerHost.value(host, 0);
+    maxConnections = m_http2Hosts.contains(host) ? 1 : HTTP1_CONNECTIONS_PER_HOST;
+
+    if (m_idleSince.contains(host)) {
+        QList<qint64>& idle = m_idleSince[host];
+
+        idle.removeLast();
+        if (idle.isEmpty())
+            m_idleSince.remove(host);
+    }
+    else if (connections < maxConnections) {
+        m_connectionsPerHost.insert(host, connections + 1);
+        m_openedConnections++;
+    }
+
+    return QNetworkAccessManager::get(req);
+}
+
+bool NetworkAccessManager::hostSaturated(QString host) {
+    return m_activePerHost.value(host, 0) >= hostCapacity(host);
+}
+
+int NetworkAccessManager::hostCapacity(QString host) {
+    int ret;
+
+    if (m_http2Hosts.contains(host)) {
+        ret = HTTP2_STREAMS_PER_CONNECTION;
+    }
+    else {
+        ret = HTTP1_CONNECTIONS_PER_HOST;
+    }
+
+    return ret;
+}
+
+int NetworkAccessManager::openConnections() {
+    int ret;
+
+    foreach (QString host, m_connectionsPerHost.keys()) {
+        expireIdleConnections(host);
+    }
+
+    ret = 0;
+    foreach (int connections, m_connectionsPerHost) {
+        ret += connections;
+    }
+
+    return ret;
+}
+
+// Forgets the connections of host that Qt has closed by now for being idle too long
+void NetworkAccessManager::expireIdleConnections(QString host) {
+    QList<qint64>& idle = m_idleSince[host];
+    int connections;
+
+    connections = m_connectionsPerHost.value(host, 0);
+    while (!idle.isEmpty() && m_clock.elapsed() - idle.first() >= HTTP_KEEPALIVE_MS) {
+        idle.removeFirst();
+        connections--;
+    }
+
+    if (connections > 0)
+        m_connectionsPerHost.insert(host, connections);
+    else
+        m_connectionsPerHost.remove(host);
+
+    if (idle.isEmpty())
+        m_idleSince.remove(host);
 }
 
-void NetworkAccessManager::requestFinished() {
+void NetworkAccessManager::requestFinished(QNetworkReply* reply) {
+    QString host;
+    int active, connections;
+    qint64 now;
+
     if (--m_activeRequests < 0)
         m_activeRequests = 0;
+
+    m_servedRequests++;
+
+    host = reply->request().url().host();
+    active = m_activePerHost.value(host, 0) - 1;
+    if (active > 0)
+        m_activePerHost.insert(host, active);
+    else
+        m_activePerHost.remove(host);
+
+    // Finished or failed, the connection stays open for the keep-alive time. It is
+    // idle unless Qt hands it a queued request, i.e. unless every busy one is needed.
+    now = m_clock.elapsed();
+    connections = m_connectionsPerHost.value(host, 0);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    if (reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool()
+            && !m_http2Hosts.contains(host)) {
+        // All further requests to this host share one multiplexed connection
+        m_http2Hosts.insert(host);
+        connections = 1;
+        m_connectionsPerHost.insert(host, connections);
+        m_idleSince.remove(host);
+    }
+#endif
+
+    QList<qint64>& idle = m_idleSince[host];
+    if (connections - idle.count() > active)
+        idle.append(now);
+    if (idle.isEmpty())
+        m_idleSince.remove(host);
 }
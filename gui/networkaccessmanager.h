@@ -2,6 +2,18 @@
 #define NETWORKACCESSMANAGER_H
 
 #include <QNetworkAccessManager>
+#include <QElapsedTimer>
+#include <QList>
+#include <QNetworkReply>
+#include <QHash>
+#include <QSet>
+
+// Qt keeps at most this many HTTP/1.1 keep-alive connections open per host
+#define HTTP1_CONNECTIONS_PER_HOST  6
+// Concurrent streams we put on a single HTTP/2 connection
+#define HTTP2_STREAMS_PER_CONNECTION 100
+// Qt closes keep-alive connections that stayed idle this long (QNetworkAccessCache)
+#define HTTP_KEEPALIVE_MS           120000
 
 class NetworkAccessManager : public QNetworkAccessManager
 {
@@ -10,11 +22,29 @@ public:
     explicit NetworkAccessManager(QObject *parent = 0);
     QNetworkReply* get ( const QNetworkRequest &request );
     int activeRequests() {return m_activeRequests;}
+
+    bool hostSaturated(QString host);
+    int hostCapacity(QString host);
+
+    int openedConnections() {return m_openedConnections;}
+    int openConnections();
+    int servedRequests() {return m_servedRequests;}
+    int http2Hosts() {return m_http2Hosts.count();}
+
 private:
     int m_activeRequests;
+    int m_openedConnections;
+    int m_servedRequests;
+    QHash<QString, int> m_activePerHost;
+    QHash<QString, int> m_connectionsPerHost;
+    QHash<QString, QList<qint64> > m_idleSince;     // per idle connection, oldest first
+    QSet<QString> m_http2Hosts;
+    QElapsedTimer m_clock;
+
+    void expireIdleConnections(QString host);
 
 private slots:
-    void requestFinished(void);
+    void requestFinished(QNetworkReply*);
 signals:
 
 public slots:
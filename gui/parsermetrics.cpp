@@ -0,0 +1,75 @@
+#include "parsermetrics.h"
+
+ParserMetrics& ParserMetrics::instance() {
+    static ParserMetrics metrics;
+    return metrics;
+}
+
+void ParserMetrics::parsed(const QString& plugin, qint64 bytes, qint64 ns, const ParsingStatus& status, int images, int urls) {
+    ParserPluginMetrics* p;
+
+    p = &_plugins[plugin];
+    p->pages++;
+    p->bytes += bytes;
+    p->parseNs += ns;
+    p->images += images;
+    p->urls += urls;
+    p->time.add(ns / 1000000);
+
+    if (status.hasErrors)
+        p->errors++;
+    else if (images == 0 && urls == 0 && !status.hasRedirect)
+        p->emptyPages++;
+}
+
+void ParserMetrics::shrunk(const QString& plugin) {
+    _plugins[plugin].shrunkPages++;
+}
+
+QJsonObject ParserMetrics::toJson() const {
+    QJsonObject ret;
+
+    foreach (const QString& plugin, _plugins.keys()) {
+        const ParserPluginMetrics& p = _plugins[plugin];
+        QJsonObject o;
+
+        o.insert("pages", p.pages);
+        o.insert("bytes", p.bytes);
+        o.insert("pages_per_second", p.pagesPerSecond());
+        o.insert("bytes_per_second", p.bytesPerSecond());
+        o.insert("images", p.images);
+        o.insert("urls", p.urls);
+        o.insert("errors", p.errors);
+        o.insert("empty_pages", p.emptyPages);
+        o.insert("shrunk_pages", p.shrunkPages);
+        o.insert("parse_time", p.time.toJson());
+
+        ret.insert(plugin, o);
+    }
+
+    return ret;
+}
+
+// Same layout as DownloadMetrics::toCsv(), without the header line
+QString ParserMetrics::toCsv() const {
+    QStringList lines;
+
+    foreach (const QString& plugin, _plugins.keys()) {
+        const ParserPluginMetrics& p = _plugins[plugin];
+        QString prefix = QString("parser,%1,").arg(plugin);
+
+        lines << prefix + QString("pages,%1").arg(p.pages)
+              << prefix + QString("bytes,%1").arg(p.bytes)
+              << prefix + QString("pages_per_second,%1").arg(p.pagesPerSecond())
+              << prefix + QString("bytes_per_second,%1").arg(p.bytesPerSecond())
+              << prefix + QString("images,%1").arg(p.images)
+              << prefix + QString("urls,%1").arg(p.urls)
+              << prefix + QString("errors,%1").arg(p.errors)
+              << prefix + QString("empty_pages,%1").arg(p.emptyPages)
+              << prefix + QString("shrunk_pages,%1").arg(p.shrunkPages)
+              << prefix + QString("parse_mean_ms,%1").arg(p.time.mean())
+              << prefix + QString("parse_p95_ms,%1").arg(p.time.percentileValue(95));
+    }
+
+    return lines.isEmpty() ? QString() : lines.join("\n") + "\n";
+}
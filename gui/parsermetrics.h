@@ -0,0 +1,52 @@
+#ifndef PARSERMETRICS_H
+#define PARSERMETRICS_H
+
+#include <QJsonObject>
+#include <QMap>
+#include <QString>
+
+#include "downloadmetrics.h"
+#include "structs.h"
+
+struct ParserPluginMetrics
+{
+    qint64 pages = 0;
+    qint64 bytes = 0;
+    qint64 parseNs = 0;
+    qint64 images = 0;
+    qint64 urls = 0;
+    int errors = 0;
+    int emptyPages = 0;     // parsed without errors, yet neither images nor threads
+    int shrunkPages = 0;    // a thread page listed fewer images than on the last scan
+    LatencyHistogram time;
+
+    qint64 pagesPerSecond() const {return parseNs > 0 ? pages * 1000000000 / parseNs : 0;}
+    qint64 bytesPerSecond() const {return parseNs > 0 ? bytes * 1000000000 / parseNs : 0;}
+};
+
+/**
+ * Throughput and output statistics of the parser plugins, per plugin name.
+ * Fed by every ThreadDownloadEngine after each parseHTML() call, so a slow
+ * or broken plugin shows up in the metrics of a normal session. Only used
+ * from the main thread.
+ */
+class ParserMetrics
+{
+public:
+    static ParserMetrics& instance();
+
+    void parsed(const QString& plugin, qint64 bytes, qint64 ns, const ParsingStatus& status, int images, int urls);
+    void shrunk(const QString& plugin);
+
+    const QMap<QString, ParserPluginMetrics>& plugins() const {return _plugins;}
+
+    QJsonObject toJson() const;
+    QString toCsv() const;
+
+private:
+    ParserMetrics() {}
+
+    QMap<QString, ParserPluginMetrics> _plugins;
+};
+
+#endif // PARSERMETRICS_H
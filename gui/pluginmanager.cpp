@@ -1,4 +1,7 @@
-﻿#include "pluginmanager.h"
+﻿#include <QJsonArray>
+#include <QJsonObject>
+
+#include "pluginmanager.h"
 
 PluginManager::PluginManager(std::shared_ptr<DownloadManager> downloadManager, QObject *parent) :
     QObject(parent)
@@ -7,6 +10,11 @@ PluginManager::PluginManager(std::shared_ptr<DownloadManager> downloadManager, Q
     loadPlugins();
 }
 
+PluginManager::~PluginManager() {
+    // Every instance we created is in parserOwner, idle or still checked out
+    qDeleteAll(parserOwner.keys());
+}
+
 void PluginManager::loadPlugins(void)
 {
     QDir pluginDir(QCoreApplication::applicationDirPath());
@@ -32,28 +40,41 @@ void PluginManager::loadPlugins(void)
         {
             QLOG_INFO() << "PluginManager :: " << "Checking file " << pluginDir.absoluteFilePath(fileName);
             QPluginLoader loader(pluginDir.absoluteFilePath(fileName));
-//            QLOG_ERROR() << loader.errorString();
-            QString str;
-            if (ParserPluginInterface* interface =
+            QJsonObject manifest;
+            PluginEntry entry;
+
+            // Reads the embedded metadata only, the library stays unloaded
+            manifest = loader.metaData().value("MetaData").toObject();
+            entry.path = pluginDir.absoluteFilePath(fileName);
+
+            c.filename = fileName;
+            c.type = "plugin/parser";
+
+            if (manifest.contains("domains")) {
+                if (manifest.value("interfaceRevision").toString() != _PARSER_PLUGIN_INTERFACE_REVISION) {
+                    QLOG_WARN() << "PluginManager :: " << "Skipping plugin " << fileName << ", because it has the wrong interface revision";
+                    continue;
+                }
+
+                foreach (const QJsonValue& d, manifest.value("domains").toArray()) {
+                    entry.domains << d.toString();
+                }
+                c.componentName = manifest.value("name").toString();
+                c.version = manifest.value("version").toString();
+
+                addPlugin(entry, c);
+            }
+            else if (ParserPluginInterface* interface =
                     qobject_cast<ParserPluginInterface *>(loader.instance()))
             {
+                // No manifest: load it now to ask for its domain
                 if (interface->getInterfaceRevision() == _PARSER_PLUGIN_INTERFACE_REVISION) {
+                    entry.domains << interface->getDomain();
                     c.componentName = interface->getPluginName();
-                    c.filename = fileName;
-                    c.type = "plugin/parser";
                     c.version = interface->getVersion();
 
-                    components.insert(QString("%1:%2").arg(c.type).arg(c.filename), c);
-                    str.append(interface->getPluginName());
-                    str.append(";;;");
-                    str.append(fileName);
-                    pluginList.append(str);
-                    loadedPlugins.append(interface);
-                    interface->initPlugin();
-                    QList<QUrl> initURIs = interface->initialRequests();
-                    for (int i=0; i<initURIs.count(); i++) {
-                        requestHandler->request(initURIs.at(0),1);
-                    }
+                    addPlugin(entry, c);
+                    loadPlugin(loadedPlugins.count()-1);
                 }
                 else {
 
@@ -68,33 +89,146 @@ void PluginManager::loadPlugins(void)
     }
 }
 
+void PluginManager::addPlugin(PluginEntry entry, component_information c) {
+    QString str;
+
+    components.insert(QString("%1:%2").arg(c.type).arg(c.filename), c);
+    str.append(c.componentName);
+    str.append(";;;");
+    str.append(c.filename);
+    pluginList.append(str);
+    loadedPlugins.append(entry);
+
+    foreach (const QString& domain, entry.domains) {
+        if (domainIndex.contains(domain.toLower())) {
+            QLOG_WARN() << "PluginManager :: " << "Domain" << domain << "is already handled by another plugin, ignoring" << c.filename;
+        }
+        else {
+            domainIndex.insert(domain.toLower(), loadedPlugins.count()-1);
+        }
+    }
+}
+
+/**
+ * Loads plugin i if that did not happen yet. A plugin that fails to load is
+ * not tried again.
+ */
+bool PluginManager::loadPlugin(int i) {
+    PluginEntry& entry = loadedPlugins[i];
+
+    if (entry.instance == 0 && !entry.failed) {
+        QPluginLoader loader(entry.path);
+        ParserPluginInterface* interface;
+
+        QLOG_INFO() << "PluginManager :: " << "Loading plugin " << entry.path;
+        interface = qobject_cast<ParserPluginInterface *>(loader.instance());
+
+        if (interface == 0) {
+            QLOG_WARN() << "PluginManager :: " << "Could not load plugin " << loader.errorString();
+            entry.failed = true;
+        }
+        else if (interface->getInterfaceRevision() != _PARSER_PLUGIN_INTERFACE_REVISION) {
+            QLOG_WARN() << "PluginManager :: " << "Plugin " << entry.path << " does not match its manifest, wrong interface revision";
+            entry.failed = true;
+        }
+        else {
+            entry.instance = interface;
+            interface->initPlugin();
+            QList<QUrl> initURIs = interface->initialRequests();
+            for (int k=0; k<initURIs.count(); k++) {
+                requestHandler->request(initURIs.at(0),1);
+            }
+        }
+    }
+
+    return entry.instance != 0;
+}
+
+/**
+ * Returns the plugin for the longest domain that host equals or is a
+ * subdomain of, -1 if there is none. Costs one hash lookup per label.
+ */
+int PluginManager::pluginIndex(QString host) {
+    int ret, pos;
+
+    ret = -1;
+    host = host.toLower();
+
+    while (!host.isEmpty()) {
+        ret = domainIndex.value(host, -1);
+        if (ret != -1)
+            break;
+
+        pos = host.indexOf('.');
+        if (pos == -1)
+            break;
+        host.remove(0, pos+1);
+    }
+
+    return ret;
+}
+
 ParserPluginInterface* PluginManager::getParser(QUrl url, bool* ok) {
-    QString domain;
     ParserPluginInterface* ret;
+    int i;
 
-    domain = url.host();
     ret = 0;
-    *ok = false;
+    i = pluginIndex(url.host());
+    *ok = (i != -1 && loadPlugin(i));
 
-    for (int i=0; i<loadedPlugins.count(); i++) {
-        if (domain.indexOf(loadedPlugins.at(i)->getDomain()) != -1) {
-                ret = loadedPlugins.at(i);
-                *ok = true;
+    if (*ok)
+        ret = loadedPlugins.at(i).instance;
+
+    return ret;
+}
+
+/**
+ * Hands out a parser instance for url, either an idle one or a new one from
+ * createInstance(). Give it back with releaseParser() instead of deleting it.
+ */
+QObject* PluginManager::acquireParser(QUrl url) {
+    QObject* ret;
+    int i;
+
+    ret = 0;
+    i = pluginIndex(url.host());
 
-                break;
+    if (i != -1 && loadPlugin(i)) {
+        if (!parserPool.value(i).isEmpty()) {
+            ret = parserPool[i].takeLast();
+        }
+        else {
+            ret = loadedPlugins.at(i).instance->createInstance();
+            parserOwner.insert(ret, i);
         }
     }
 
     return ret;
 }
 
+void PluginManager::releaseParser(QObject* parser) {
+    int i;
+
+    if (parser == 0)
+        return;
+
+    i = parserOwner.value(parser, -1);
+    if (i != -1 && parserPool.value(i).count() < PARSER_POOL_SIZE) {
+        parserPool[i].append(parser);
+    }
+    else {
+        parserOwner.remove(parser);
+        parser->deleteLater();
+    }
+}
+
 ParserPluginInterface* PluginManager::getPlugin(int i) {
     ParserPluginInterface* ret;
 
     ret = 0;
 
-    if (i<loadedPlugins.count()) {
-        ret = loadedPlugins.at(i);
+    if (i<loadedPlugins.count() && loadPlugin(i)) {
+        ret = loadedPlugins.at(i).instance;
     }
 
     return ret;
@@ -135,27 +269,19 @@ QStringList PluginManager::getSupportedDomains() {
     QStringList ret;
 
     for (int i=0; i<loadedPlugins.count(); i++) {
-        ret << loadedPlugins.at(i)->getDomain();
+        ret << loadedPlugins.at(i).domains;
     }
 
     return ret;
 }
 
+// Accepts a host name as well as a complete url
 bool PluginManager::isSupported(QString domain) {
-    bool ret;
-    QStringList supported;
+    QString host;
 
-    ret = false;
+    host = QUrl::fromUserInput(domain.trimmed()).host();
+    if (host.isEmpty())
+        host = domain.trimmed();
 
-    supported = getSupportedDomains();
-
-    foreach (QString sd, supported) {
-        if (domain.contains(sd)) {
-            ret = true;
-
-            break;
-        }
-    }
-
-    return ret;
+    return pluginIndex(host) != -1;
 }
@@ -12,23 +12,48 @@
 #include "ParserPluginInterface.h"
 #include "downloadmanager.h"
 
+// Idle parser instances kept per plugin for reuse
+#define PARSER_POOL_SIZE 8
+
+/**
+ * Finds the parser plugins and routes urls to them. At startup only the
+ * manifests (Q_PLUGIN_METADATA) are read; a library is loaded the first time
+ * a url of one of its domains needs a parser. Plugins without a manifest
+ * listing their domains are loaded right away, as before.
+ */
 class PluginManager : public QObject
 {
     Q_OBJECT
 public:
     explicit PluginManager(std::shared_ptr<DownloadManager> downloadManager, QObject *parent = 0);
+    ~PluginManager();
     QStringList getAvailablePlugins(void);
     component_information getInfo(QString name);
     ParserPluginInterface* getParser(QUrl, bool*);
+    QObject* acquireParser(QUrl url);
+    void releaseParser(QObject* parser);
     ParserPluginInterface* getPlugin(int);
     ParserPluginInterface* getPlugin(QString);
     QStringList getSupportedDomains();
     bool isSupported(QString);
 private:
-    QList<ParserPluginInterface*> loadedPlugins;
+    struct PluginEntry {
+        QString path;
+        QStringList domains;
+        ParserPluginInterface* instance = 0;
+        bool failed = false;
+    };
+
+    QList<PluginEntry> loadedPlugins;
     QStringList pluginList;
     QMap<QString, component_information> components;
+    QHash<QString, int> domainIndex;            // lower case domain -> index in loadedPlugins
+    QHash<int, QList<QObject*> > parserPool;    // idle instances per plugin
+    QHash<QObject*, int> parserOwner;           // instance -> index in loadedPlugins
     void loadPlugins(void);
+    bool loadPlugin(int i);
+    void addPlugin(PluginEntry entry, component_information c);
+    int pluginIndex(QString host);
     RequestHandler* requestHandler;
 signals:
 
@@ -11,7 +11,12 @@ RequestHandler::RequestHandler(std::shared_ptr<DownloadManager> downloadManager_
     }
 }
 
-void RequestHandler::request(QUrl u, int priority) {
+RequestHandler::~RequestHandler() {
+    // The DownloadManager keeps a pointer to us for every open request
+    cancelAll();
+}
+
+void RequestHandler::request(QUrl u, int priority, bool conditional) {
     qint64 uid;
     int prio;
     QString sUrl;
@@ -20,7 +25,8 @@ void RequestHandler::request(QUrl u, int priority) {
     if (priority < 0) {
         if (sUrl.indexOf(QRegExp(__IMAGE_REGEXP__, Qt::CaseInsensitive)) != -1) {
             //Image requested
-            prio = qMax(downloadManager->getHighestPriority() + 1,100);
+            // Handed out here, not in the network thread, so a burst of images keeps its order
+            prio = downloadManager->nextImagePriority();
         }
         else {
             // HTML page requested
@@ -32,7 +38,7 @@ void RequestHandler::request(QUrl u, int priority) {
     }
 
     if (downloadManager != 0) {
-        uid = downloadManager->requestDownload(this, u, prio);
+        uid = downloadManager->requestDownload(this, u, prio, conditional);
         QLOG_TRACE() << "RequestHandler :: Adding request" << uid << ":" << u.toString() << "prio" <<prio;
         requests.insert(uid, u);
     }
@@ -41,23 +47,14 @@ void RequestHandler::request(QUrl u, int priority) {
     }
 }
 
-void RequestHandler::requestFinished(qint64 uid) {
-    QByteArray ba;
+void RequestHandler::requestFinished(qint64 uid, const QByteArray& ba, bool cachedReply) {
     QUrl url;
-    bool cachedReply;
-
-    cachedReply = false;
 
     QLOG_TRACE() << "RequestHandler :: Request " << uid << " finished";
-    ba = downloadManager->getByteArray(uid);
-    QLOG_TRACE() << "RequestHandler :: " << QString(ba);
-
-    cachedReply = downloadManager->cached(uid);
+    QLOG_TRACE() << "RequestHandler :: Response size" << ba.size() << "bytes";
 
     url = requests.value(uid, QUrl("NONE"));
-
     requests.remove(uid);
-    downloadManager->freeRequest(uid);
 
     emit response(url, ba, cachedReply);
 }
@@ -69,7 +66,6 @@ void RequestHandler::error(qint64 req, int err) {
     emit responseError(url, err);
 
     requests.remove(req);
-    downloadManager->freeRequest(req);
 }
 
 void RequestHandler::cancel(QUrl url) {
@@ -80,6 +76,7 @@ void RequestHandler::cancel(QUrl url) {
     foreach(qint64 id, uids) {
         if (requests.value(id) == url) {
             downloadManager->removeRequest(id);
+            requests.remove(id);
         }
     }
 }
@@ -92,4 +89,5 @@ void RequestHandler::cancelAll() {
     foreach(qint64 id, uids) {
         downloadManager->removeRequest(id);
     }
+    requests.clear();
 }
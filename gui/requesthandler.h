@@ -17,13 +17,16 @@ class RequestHandler : public QObject
     Q_OBJECT;
 public:
     RequestHandler(std::shared_ptr<DownloadManager> downloadManager_, QObject *parent = nullptr);
-    void request(QUrl, int priority=-1);
+    ~RequestHandler();
+    // A conditional request is answered with an empty body if the page did not
+    // change since the last conditional request for it
+    void request(QUrl, int priority=-1, bool conditional=false);
     void cancel(QUrl url);
     void cancelAll();
-    void requestFinished(qint64);
+    void requestFinished(qint64, const QByteArray&, bool);
     void error(qint64, int);
 signals:
-    void response(QUrl, QByteArray, bool);
+    void response(const QUrl&, const QByteArray&, bool);
     void responseError(QUrl, int);
 
 private:
@@ -0,0 +1,238 @@
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
+#include "QsLog.h"
+#include "sessionstore.h"
+
+namespace chandl {
+  namespace {
+    const quint32 SESSION_MAGIC = 0x4348534E;     // "CHSN"
+    const quint16 SESSION_VERSION = 1;
+    const QString INDEX_FILENAME = "session.idx";
+    const QString RECORD_SUFFIX = ".thread";
+
+    bool readHeader(QDataStream& in)
+    {
+      quint32 magic;
+      quint16 version;
+
+      in >> magic >> version;
+      in.setVersion(QDataStream::Qt_5_0);
+
+      return in.status() == QDataStream::Ok && magic == SESSION_MAGIC && version <= SESSION_VERSION;
+    }
+
+    void writeHeader(QDataStream& out)
+    {
+      out << SESSION_MAGIC << SESSION_VERSION;
+      out.setVersion(QDataStream::Qt_5_0);
+    }
+  }
+
+  ThreadRecord ThreadRecord::fromValues(const QString& values)
+  {
+    ThreadRecord ret;
+    QStringList list;
+
+    list = values.split(";;");
+
+    ret.url = list.value(0);
+    ret.savepath = list.value(1);
+    ret.rescan = list.value(2).toInt() != 0;
+    ret.rescanInterval = list.value(3).toInt();
+    ret.originalFilenames = list.value(4).toInt() != 0;
+    ret.running = list.value(5) == "1";
+    ret.blocked = list.value(6).toInt() != 0;
+
+    return ret;
+  }
+
+  QString ThreadRecord::toValues() const
+  {
+    QStringList list;
+
+    list << url;
+    list << savepath;
+    list << QString("%1").arg(rescan);
+    list << QString("%1").arg(rescanInterval);
+    list << QString("%1").arg(originalFilenames);
+    list << QString("%1").arg(running);
+    list << QString("%1").arg(blocked);
+
+    return list.join(";;");
+  }
+
+  SessionStore::SessionStore(const QString& directory) :
+    dir(directory)
+  {
+
+  }
+
+  QList<ThreadRecord> SessionStore::load()
+  {
+    QList<ThreadRecord> ret;
+    QFile f(dir.filePath(INDEX_FILENAME));
+
+    order.clear();
+    written.clear();
+
+    if (!f.open(QIODevice::ReadOnly))
+      return ret;
+
+    QDataStream in(&f);
+    if (!readHeader(in)) {
+      QLOG_ERROR() << "SessionStore :: " << f.fileName() << " is not a session index";
+      return ret;
+    }
+    in >> order;
+
+    foreach (const QString& id, order) {
+      ThreadRecord record;
+
+      if (readRecord(id, &record)) {
+        // Matches the engine once the record is restored, so an untouched thread is not written again
+        written.insert(id, Stamp{record.toValues(), record.revision});
+        ret << record;
+      }
+      else
+        QLOG_WARN() << "SessionStore :: Could not read thread record " << id;
+    }
+
+    QLOG_INFO() << "SessionStore :: Loaded " << ret.count() << " threads";
+    return ret;
+  }
+
+  bool SessionStore::save(const QList<ThreadRecord>& records)
+  {
+    QStringList newOrder;
+    QString id, values;
+    int count;
+    bool ret;
+
+    ret = true;
+    count = 0;
+
+    if (!dir.exists() && !dir.mkpath(".")) {
+      QLOG_ERROR() << "SessionStore :: Could not create " << dir.absolutePath();
+      return false;
+    }
+
+    foreach (const ThreadRecord& record, records) {
+      id = recordId(record, newOrder);
+      values = record.toValues();
+      newOrder << id;
+
+      if (written.contains(id)
+          && written.value(id).revision == record.revision
+          && written.value(id).values == values)
+        continue;
+
+      if (writeRecord(id, record)) {
+        written.insert(id, Stamp{values, record.revision});
+        count++;
+      }
+      else {
+        ret = false;
+      }
+    }
+
+    // Threads that have been closed since the last save
+    foreach (const QString& old, order) {
+      if (!newOrder.contains(old)) {
+        QFile::remove(dir.filePath(old + RECORD_SUFFIX));
+        written.remove(old);
+      }
+    }
+
+    if (newOrder != order) {
+      order = newOrder;
+      ret = writeIndex() && ret;
+    }
+
+    QLOG_DEBUG() << "SessionStore :: Saved " << count << " of " << records.count() << " threads";
+    return ret;
+  }
+
+  QString SessionStore::recordId(const ThreadRecord& record, const QStringList& taken) const
+  {
+    QString base, ret;
+    int n;
+
+    base = QString(QCryptographicHash::hash(record.url.toUtf8(), QCryptographicHash::Sha1).toHex().left(16));
+    ret = base;
+    n = 1;
+
+    // Several empty tabs share the same url
+    while (taken.contains(ret))
+      ret = QString("%1-%2").arg(base).arg(n++);
+
+    return ret;
+  }
+
+  bool SessionStore::readRecord(const QString& id, ThreadRecord* record) const
+  {
+    QFile f(dir.filePath(id + RECORD_SUFFIX));
+    qint32 count;
+
+    if (!f.open(QIODevice::ReadOnly))
+      return false;
+
+    QDataStream in(&f);
+    if (!readHeader(in))
+      return false;
+
+    in >> record->url >> record->savepath >> record->rescan >> record->rescanInterval
+       >> record->originalFilenames >> record->running >> record->blocked;
+
+    in >> count;
+    record->images.clear();
+    record->images.reserve(qMax(0, count));
+
+    for (int i=0; i<count && in.status() == QDataStream::Ok; i++) {
+      _IMAGE img;
+
+      in >> img.largeURI >> img.thumbURI >> img.originalFilename >> img.savedAs >> img.downloaded;
+      img.requested = false;
+      record->images << img;
+    }
+
+    return in.status() == QDataStream::Ok;
+  }
+
+  bool SessionStore::writeRecord(const QString& id, const ThreadRecord& record) const
+  {
+    QSaveFile f(dir.filePath(id + RECORD_SUFFIX));
+
+    if (!f.open(QIODevice::WriteOnly))
+      return false;
+
+    QDataStream out(&f);
+    writeHeader(out);
+
+    out << record.url << record.savepath << record.rescan << record.rescanInterval
+        << record.originalFilenames << record.running << record.blocked;
+
+    out << (qint32)record.images.count();
+    foreach (const _IMAGE& img, record.images) {
+      out << img.largeURI << img.thumbURI << img.originalFilename << img.savedAs << img.downloaded;
+    }
+
+    return f.commit();
+  }
+
+  bool SessionStore::writeIndex() const
+  {
+    QSaveFile f(dir.filePath(INDEX_FILENAME));
+
+    if (!f.open(QIODevice::WriteOnly))
+      return false;
+
+    QDataStream out(&f);
+    writeHeader(out);
+    out << order;
+
+    return f.commit();
+  }
+}
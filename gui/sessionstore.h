@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QDir>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include "structs.h"
+
+namespace chandl {
+  static const QString SESSION_STORE_DEFAULT_DIRECTORY = "session";
+
+  // Everything needed to reopen one thread: the tab options plus the state of
+  // every image, so a restart does not have to probe the disk for each file.
+  struct ThreadRecord {
+    QString url;
+    QString savepath;
+    bool rescan = false;
+    int rescanInterval = 0;
+    bool originalFilenames = false;
+    bool running = false;
+    bool blocked = false;
+    QList<_IMAGE> images;
+
+    // Not persisted - ThreadDownloadEngine::revision() of the image list, used
+    // to skip threads that did not change since the last save. 0 is a list
+    // exactly as loaded from the session
+    quint64 revision = 0;
+
+    // Conversion from/to the ";;" joined values used by tabs and thread history
+    static ThreadRecord fromValues(const QString& values);
+    QString toValues() const;
+  };
+
+  // Binary session storage: one file per thread plus an index holding the tab
+  // order. save() only rewrites the threads that changed since the last call.
+  class SessionStore {
+  public:
+    SessionStore(const QString& directory = SESSION_STORE_DEFAULT_DIRECTORY);
+
+    QList<ThreadRecord> load();
+    bool save(const QList<ThreadRecord>& records);
+
+  private:
+    struct Stamp {
+      QString values;
+      quint64 revision;
+    };
+
+    QDir dir;
+    QStringList order;
+    QHash<QString, Stamp> written;
+
+    QString recordId(const ThreadRecord& record, const QStringList& taken) const;
+    bool readRecord(const QString& id, ThreadRecord* record) const;
+    bool writeRecord(const QString& id, const ThreadRecord& record) const;
+    bool writeIndex() const;
+  };
+}
@@ -0,0 +1,53 @@
+#include <atomic>
+
+#include "appsettings.h"
+#include "settingssnapshot.h"
+
+namespace chandl {
+  SettingsStore::SettingsStore() :
+    QObject(nullptr)
+  {
+    reload();
+  }
+
+  SettingsStore& SettingsStore::instance()
+  {
+    static SettingsStore store;
+    return store;
+  }
+
+  SettingsSnapshotPtr SettingsStore::snapshot() const
+  {
+    return std::atomic_load(&current);
+  }
+
+  void SettingsStore::reload()
+  {
+    AppSettings settings;
+    auto s = std::make_shared<SettingsSnapshot>();
+
+    s->managerConcurrentDownloads = settings.getManagerConcurrentDownloads();
+    s->managerInitialTimeout = settings.getManagerInitialTimeout();
+    s->runningTimeout = settings.getRunningTimeout();
+    s->useThreadCache = settings.getUseThreadCache();
+    s->threadCachePath = settings.getThreadCachePath();
+    s->compressCacheFile = settings.getCompressCacheFile();
+    s->userAgent = settings.getUserAgent().toLatin1();
+
+    s->thumbnailSize = settings.getThumbnailSize();
+    s->enlargeThumbnails = settings.getEnlargeThumbnails();
+    s->hqThumbnails = settings.getHQThumbnails();
+    s->thumbnailCacheFolder = settings.getThumbnailCacheFolder();
+
+    s->closeOverviewThreads = settings.getCloseOverviewThreads();
+    s->watchBoards = settings.getWatchBoards();
+    s->useInternalViewer = settings.getUseInternalViewer();
+
+    s->viewerPrefetch = settings.getViewerPrefetch();
+    s->viewerCacheSize = settings.getViewerCacheSize();
+
+    std::atomic_store(&current, SettingsSnapshotPtr(std::move(s)));
+
+    emit changed();
+  }
+}
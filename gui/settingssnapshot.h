@@ -0,0 +1,68 @@
+#pragma once
+
+#include <memory>
+
+#include <QObject>
+#include <QByteArray>
+#include <QSize>
+#include <QString>
+
+namespace chandl {
+  // Plain copy of the settings that are read on hot paths (per request, per
+  // image, per thumbnail). A snapshot is never modified after it has been
+  // published; a configuration change publishes a new one.
+  struct SettingsSnapshot {
+    // Download manager
+    int managerConcurrentDownloads = 20;
+    int managerInitialTimeout = 30;
+    int runningTimeout = 2;
+    bool useThreadCache = false;
+    QString threadCachePath;
+    bool compressCacheFile = true;
+    QByteArray userAgent;
+
+    // Thumbnails
+    QSize thumbnailSize = QSize(200, 200);
+    bool enlargeThumbnails = false;
+    bool hqThumbnails = false;
+    QString thumbnailCacheFolder;
+
+    // Threads
+    bool closeOverviewThreads = true;
+    bool watchBoards = true;
+    bool useInternalViewer = true;
+
+    // Image viewer
+    int viewerPrefetch = 2;
+    int viewerCacheSize = 256;
+  };
+
+  using SettingsSnapshotPtr = std::shared_ptr<const SettingsSnapshot>;
+
+  class SettingsStore : public QObject {
+    Q_OBJECT
+  public:
+    static SettingsStore& instance();
+
+    // Safe to call from any thread. The returned snapshot stays valid even
+    // if a newer one is published in the meantime.
+    SettingsSnapshotPtr snapshot() const;
+
+  public slots:
+    // Re-reads the INI backend and publishes a new snapshot
+    void reload();
+
+  signals:
+    void changed();
+
+  private:
+    SettingsStore();
+
+    SettingsSnapshotPtr current;
+  };
+
+  // Shortcut for SettingsStore::instance().snapshot()
+  inline SettingsSnapshotPtr settingsSnapshot() {
+    return SettingsStore::instance().snapshot();
+  }
+}
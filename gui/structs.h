@@ -29,6 +29,7 @@ struct component_information {
     QString remote_version;
     QString src;
     QString target;
+    QString sha256;
 };
 
 #endif // STRUCTS_H
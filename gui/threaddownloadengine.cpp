@@ -0,0 +1,773 @@
+#include "threaddownloadengine.h"
+
+#include <QDir>
+#include <QFile>
+#include <QRegExp>
+
+#include "HtmlEntities.h"
+#include "boardwatchengine.h"
+#include "settingssnapshot.h"
+#include "parsermetrics.h"
+#include "folderindex.h"
+
+// Shared by all engines, so a revision never repeats within one run
+quint64 ThreadDownloadEngine::lastRevision = 0;
+
+ThreadDownloadEngine::ThreadDownloadEngine(
+  std::shared_ptr<DownloadManager> downloadManager_,
+  std::shared_ptr<PluginManager> pluginManager_,
+  QObject *parent) :
+    QObject(parent),
+    downloadManager(downloadManager_),
+    pluginManager(pluginManager_)
+{
+    requestHandler = new RequestHandler(downloadManager, this);
+    iParser = 0;
+    oParser = 0;
+    blackList = 0;
+    boardWatch = 0;
+    lastImageCount = 0;
+
+    timer = new QTimer(this);
+
+    downloadedCount = 0;
+    savedCount = 0;
+    savedByteCount = 0;
+    _revision = ++lastRevision;
+
+    _originalFilenames = false;
+    _rescanInterval = 0;
+    _running = false;
+    _blocked = false;
+    _cachedResult = false;
+    downloading = false;
+    closeWhenFinished = false;
+    followRedirects = true;
+
+    connect(requestHandler, SIGNAL(responseError(QUrl, int)), this, SLOT(errorHandler(QUrl, int)));
+    connect(requestHandler, SIGNAL(response(QUrl, QByteArray, bool)), this, SLOT(processRequestResponse(QUrl, QByteArray, bool)));
+    connect(timer, SIGNAL(timeout()), this, SLOT(triggerRescan()));
+}
+
+void ThreadDownloadEngine::setUrl(QString url) {
+    _url = url;
+}
+
+bool ThreadDownloadEngine::start() {
+    QDir dir;
+    QString path;
+    bool ret;
+
+    ret = false;
+    _running = true;
+    _lastError = "";
+
+    if (_url.isEmpty())
+        return ret;
+
+    if (!_url.startsWith("http")) {
+        _url.prepend("http://");
+        emit urlChanged(_url);
+    }
+
+    // Check if we can parse this URI
+    if (selectParser()) {
+        path = savepath();
+
+        if (path.endsWith("\\")) {
+            path.chop(1);
+        }
+        QLOG_TRACE() << "ThreadDownloadEngine :: Setting save path to " << path;
+        dir.setPath(path);
+
+        if (!dir.exists()) {
+            QDir d;
+
+            d.mkpath(path);
+            QLOG_INFO() << "ThreadDownloadEngine :: Directory" << path << " does not exist. Creating...";
+        }
+
+        if (dir.exists()) {
+            startDownload();
+
+            if (_rescanInterval > 0) {
+                timer->setInterval(_rescanInterval*1000);
+                timer->start();
+            }
+            ret = true;
+        }
+        else {
+            stop();
+            _lastError = "Directory does not exist / Could not be created";
+            emit errorMessage(_lastError);
+            QLOG_ERROR() << "ThreadDownloadEngine :: Directory" << path << " does not exist and I couldn't create it.";
+        }
+    }
+    else {
+        stop();
+        _lastError = "No parser available";
+        emit errorMessage("Could not find a parser for this URL (" + _url + ")");
+        QLOG_WARN() << "ThreadDownloadEngine :: I couldn't find a parser for uri " << _url;
+    }
+
+    return ret;
+}
+
+void ThreadDownloadEngine::stop() {
+    _running = false;
+    stopDownload();
+    timer->stop();
+
+    if (boardWatch != 0) {
+        boardWatch->stop();
+        boardWatch->deleteLater();
+        boardWatch = 0;
+    }
+
+    if (oParser != 0) {
+        pluginManager->releaseParser(oParser);
+        oParser = 0;
+        iParser = 0;
+    }
+}
+
+int ThreadDownloadEngine::totalImages() const {
+    return images.count() + (boardWatch != 0 ? boardWatch->totalImages() : 0);
+}
+
+int ThreadDownloadEngine::downloadedImages() const {
+    return downloadedCount + (boardWatch != 0 ? boardWatch->downloadedImages() : 0);
+}
+
+bool ThreadDownloadEngine::isDownloadFinished() const {
+    return downloadedCount == images.count()
+            && (boardWatch == 0 || boardWatch->downloadedImages() == boardWatch->totalImages());
+}
+
+void ThreadDownloadEngine::recordParse(const QString& uri, qint64 bytes, qint64 ns, const ParsingStatus& status, bool cached) {
+    int imageCount, urlCount;
+
+    imageCount = status.hasImages ? iParser->getImageList().count() : 0;
+    urlCount = (status.isFrontpage || status.threadFragmented) ? iParser->getUrlList().count() : 0;
+    ParserMetrics::instance().parsed(iParser->getPluginName(), bytes, ns, status, imageCount, urlCount);
+
+    // A thread only grows, so a rescan listing fewer images points at deleted
+    // posts or, if it shows up across threads, at a broken parser
+    if (!cached && !status.hasErrors && !status.isFrontpage && !status.threadFragmented
+            && !fragmentPages.contains(uri)) {
+        if (imageCount < lastImageCount) {
+            QLOG_WARN() << "ThreadDownloadEngine ::" << iParser->getPluginName() << "found" << imageCount
+                        << "images in" << uri << "after" << lastImageCount << "on the last scan";
+            ParserMetrics::instance().shrunk(iParser->getPluginName());
+        }
+        lastImageCount = imageCount;
+    }
+}
+
+/**
+ * Hands a rescanned board front page over to a BoardWatchEngine, which
+ * downloads its threads without opening a tab for each of them. Returns false
+ * if the threads should be opened as tabs instead.
+ */
+bool ThreadDownloadEngine::watchBoard() {
+    if (boardWatch == 0) {
+        if (_rescanInterval <= 0 || !chandl::settingsSnapshot()->watchBoards
+                || !BoardWatchEngine::catalogUrl(QUrl(_url)).isValid())
+            return false;
+
+        boardWatch = new BoardWatchEngine(downloadManager, pluginManager, this);
+        boardWatch->setUrl(_url);
+        boardWatch->setSavepath(_savepath);
+        boardWatch->setOriginalFilenames(_originalFilenames);
+        boardWatch->setBlackList(blackList);
+        boardWatch->setPollInterval(_rescanInterval);
+
+        connect(boardWatch, SIGNAL(statusChanged(QString)), this, SIGNAL(statusChanged(QString)));
+        connect(boardWatch, SIGNAL(errorMessage(QString)), this, SIGNAL(errorMessage(QString)));
+        connect(boardWatch, SIGNAL(progressChanged(int,int)), this, SIGNAL(progressChanged(int,int)));
+
+        if (!boardWatch->start()) {
+            boardWatch->deleteLater();
+            boardWatch = 0;
+            return false;
+        }
+
+        // The board engine polls the thread list from now on
+        timer->stop();
+        QLOG_INFO() << "ThreadDownloadEngine :: Watching board" << _url;
+    }
+
+    return true;
+}
+
+QString ThreadDownloadEngine::savepath() {
+    QString ret;
+
+    if (iParser) {
+        ret = iParser->parseSavepath(_savepath);
+    }
+    else {
+        ret = _savepath;
+    }
+
+    return ret;
+}
+
+bool ThreadDownloadEngine::selectParser(QUrl url) {
+    bool ret;
+
+    if (url.isEmpty())
+        url = QUrl(_url.toLatin1());
+
+    if (oParser != 0)
+        pluginManager->releaseParser(oParser);
+
+    oParser = pluginManager->acquireParser(url);
+    iParser = qobject_cast<ParserPluginInterface*>(oParser);
+    ret = (iParser != 0);
+
+    if (ret)
+        iParser->setURL(url);
+
+    return ret;
+}
+
+void ThreadDownloadEngine::triggerRescan(void) {
+    if (!_blocked) {
+        startDownload();
+        timer->start();
+
+        emit statusChanged("rescanning");
+    }
+}
+
+void ThreadDownloadEngine::startDownload(void) {
+    createSupervisedDownload(QUrl(_url.toLatin1()));
+}
+
+void ThreadDownloadEngine::stopDownload(void) {
+    _IMAGE tmp;
+
+    download(false);                // Prevent new requests
+    requestHandler->cancelAll();    // Cancel pending downloads
+    fragmentPages.clear();
+    fragmentImages.clear();
+
+    // Reset requested, yet not finished, downloads
+    for (int i=0; i<images.length(); i++) {
+        if ((images.at(i).downloaded==false) && (images.at(i).requested == true)) {
+            tmp = images.at(i);
+            tmp.requested = false;
+            images.replace(i, tmp);
+        }
+    }
+    followRedirects = true;
+}
+
+void ThreadDownloadEngine::download(bool b) {
+    if (b) {
+        QString imgURI;
+        int from;
+
+        downloading = true;
+
+        // Requested images are never handed out again, so continue where the last one was found
+        from = 0;
+        while (getNextImage(&from, &imgURI))
+            createSupervisedDownload(QUrl(imgURI));
+    } else {
+        downloading = false;
+    }
+}
+
+void ThreadDownloadEngine::createSupervisedDownload(QUrl url) {
+    if (url.isValid()) {
+        if (!isImage(url) && iParser != 0) {
+            QLOG_DEBUG() << __func__ << "Passing url to plugin " << url.toString();
+            url = iParser->alterUrl(url);
+            QLOG_DEBUG() << __func__ << "URL altered to " << url.toString();
+        }
+        requestHandler->request(url);
+    }
+}
+
+void ThreadDownloadEngine::fetchFragments(QList<QUrl> pages) {
+    QUrl url;
+
+    fragmentPages.clear();
+    fragmentImages.clear();
+
+    // All pages are requested at once; their images are merged when the last one arrived
+    for (int i=0; i<pages.count(); i++) {
+        url = pages.at(i);
+        if (iParser != 0)
+            url = iParser->alterUrl(url);
+
+        if (url.isValid() && !fragmentPages.contains(url.toString())) {
+            fragmentPages.insert(url.toString(), i);
+            requestHandler->request(url, FRAGMENT_PRIORITY);
+        }
+    }
+}
+
+void ThreadDownloadEngine::fragmentFinished(QString uri, QList<_IMAGE> list) {
+    QList<_IMAGE> merged;
+
+    fragmentImages.insert(fragmentPages.take(uri), list);
+
+    if (fragmentPages.isEmpty()) {
+        // QMap iterates in page order
+        foreach (const QList<_IMAGE>& page, fragmentImages) {
+            merged.append(page);
+        }
+        fragmentImages.clear();
+
+        QLOG_INFO() << "ThreadDownloadEngine :: All pages of" << _url << "received," << merged.count() << "images";
+        mergeImageList(merged);
+    }
+}
+
+QString ThreadDownloadEngine::targetFilename(const _IMAGE& img) {
+    QString ret;
+
+    if (_originalFilenames) {
+        ret = savepath()+"/"+img.originalFilename;
+    }
+    else {
+        QRegExp rx(__IMAGEFILE_REGEXP__, Qt::CaseInsensitive, QRegExp::RegExp2);
+
+        if (rx.indexIn(img.largeURI) != -1) {
+            ret = savepath()+"/"+rx.cap(1)+rx.cap(2);
+        }
+    }
+
+    return ret;
+}
+
+void ThreadDownloadEngine::setDownloaded(int i, bool downloaded, QString savedAs) {
+    _IMAGE tmp;
+
+    tmp = images.at(i);
+    if (tmp.downloaded != downloaded)
+        downloadedCount += downloaded ? 1 : -1;
+
+    tmp.downloaded = downloaded;
+    tmp.requested = downloaded ? tmp.requested : false;
+    tmp.savedAs = savedAs;
+    images.replace(i, tmp);
+    _revision = ++lastRevision;
+}
+
+bool ThreadDownloadEngine::getNextImage(int* from, QString* s) {
+    int i;
+    bool ret;
+    _IMAGE tmp;
+    QString filename;
+
+    ret = false;
+
+    if (downloading) {
+        for (i=*from; i<images.length(); i++) {
+            if (!images.at(i).downloaded && !images.at(i).requested) {
+                tmp = images.at(i);
+                tmp.requested = true;
+                images.replace(i,tmp);
+
+                // Check if file already exists in destination dir
+                filename = targetFilename(tmp);
+
+                if (!filename.isEmpty() && FolderIndex::instance().contains(filename)) {
+                    setDownloaded(i, true, filename);
+
+                    emit imageAvailable(filename);
+                    setCompleted(tmp.largeURI, filename);
+                }
+                else {
+                    *s = tmp.largeURI;
+                    ret = true;
+                    break;
+                }
+            }
+        }
+        *from = i;
+    }
+
+    return ret;
+}
+
+void ThreadDownloadEngine::mergeImageList(QList<_IMAGE> list) {
+    bool imagesAdded;
+
+    imagesAdded = false;
+
+    for (int i=0; i<list.count(); i++) {
+        if(addImage(list.at(i)))
+            imagesAdded = true;
+    }
+
+    if (imagesAdded) {
+        download(true);
+    }
+    else {
+        if (isDownloadFinished()) {
+            download(false);
+            emit finished();
+        }
+    }
+
+    emit progressChanged(downloadedCount, images.count());
+}
+
+bool ThreadDownloadEngine::addImage(_IMAGE img) {
+    int k;
+    bool alreadyInList;
+    bool fileExists;
+    QString filename;
+
+    fileExists = false;
+
+    if (blackList != 0 && blackList->contains(img.largeURI)) {
+        alreadyInList = true;
+    }
+    else {
+        alreadyInList = imageIndex.contains(img.largeURI);
+
+        if (!alreadyInList) {
+            // Make the original filename unique within this thread
+            k = 2;
+            while (originalFilenames.contains(img.originalFilename)) {
+                QStringList tmp;
+                QString renamed;
+
+                tmp = img.originalFilename.split(QRegExp("\\(\\d+\\)"));
+                if  (tmp.count() > 1) // Already has a number in brackets in filename
+                    renamed = QString("%1(%2)%3").arg(tmp.at(0)).
+                                           arg(k++).
+                                           arg(tmp.at(1));
+                else
+                    renamed = QString(img.originalFilename).replace("."," (1).");
+
+                if (renamed == img.originalFilename)
+                    break;
+                img.originalFilename = renamed;
+            }
+
+            // Check if already downloaded
+            filename = targetFilename(img);
+            img.downloaded = false;
+            img.requested = false;
+
+            if (!filename.isEmpty() && FolderIndex::instance().contains(filename)) {
+                img.downloaded = true;
+                fileExists = true;
+                img.savedAs = filename;
+            }
+            else if (_cachedResult) {
+                if (blackList != 0)
+                    blackList->add(img.largeURI);
+                img.savedAs = "";
+                img.downloaded = true;
+                fileExists = true;
+
+                QLOG_INFO() << __func__ << ":: Image " << img.largeURI << " from cached result does not exists. Looked in " << savepath();
+            }
+
+            imageIndex.insert(img.largeURI, images.count());
+            originalFilenames.insert(img.originalFilename);
+            images.append(img);
+            if (img.downloaded)
+                downloadedCount++;
+            _revision = ++lastRevision;
+
+            if (fileExists && img.savedAs != "") {
+                emit imageAvailable(img.savedAs);
+            }
+        }
+    }
+
+    return (!alreadyInList && !fileExists);
+}
+
+void ThreadDownloadEngine::setCompleted(QString uri, QString filename) {
+    int i;
+
+    i = imageIndex.value(uri, -1);
+    if (i != -1) {
+        setDownloaded(i, true, filename);
+
+        emit progressChanged(downloadedCount, images.count());
+
+        if (isDownloadFinished()) {
+            download(false);
+            emit finished();
+        }
+    }
+}
+
+void ThreadDownloadEngine::errorHandler(QUrl url, int err) {
+    if (fragmentPages.contains(url.toString())) {
+        // A missing page must not hold back the images of the others
+        QLOG_WARN() << "ThreadDownloadEngine :: Could not get page" << url.toString() << "(" << err << ")";
+        fragmentFinished(url.toString(), QList<_IMAGE>());
+        if (err != 999)
+            return;
+    }
+
+    switch (err) {
+    case 202:
+    case 404:
+        if (isImage(url)) {
+            if (blackList != 0)
+                blackList->add(url.toString());
+            setCompleted(url.toString(), "");
+        }
+        else {
+            // If there are still images in the list, wait until they finished (maybe they still exist)
+            // else close immediately
+            if (isDownloadFinished()) {
+                stop();
+
+                emit errorMessage("404 - Page not found");
+                emit closeRequest(404);
+            }
+            else {
+                closeWhenFinished = true;
+            }
+        }
+        break;
+
+    case 999:
+        emit banned();
+        emit errorMessage("You are banned");
+        break;
+
+    default:
+        QLOG_ERROR() << "ThreadDownloadEngine :: Unhandled error (" << url.toString() << "," << err << ")";
+        break;
+    }
+}
+
+void ThreadDownloadEngine::processRequestResponse(const QUrl& url, const QByteArray& ba, bool cached) {
+    QString requestURI;
+    QList<_IMAGE>   imageList;
+    ParsingStatus   status;
+    qint64 bytesWritten;
+    int i;
+
+    requestURI = url.toString();
+    QLOG_TRACE() << "ThreadDownloadEngine :: Got response for " << requestURI << ":" << ba.size() << "bytes";
+
+    if (_blocked)
+        return;
+
+    if (isImage(url)) {
+        QFile f;
+
+        i = imageIndex.value(requestURI, -1);
+        if (i != -1) {
+            f.setFileName(targetFilename(images.at(i)));
+        }
+        else {
+            QRegExp rx(__IMAGEFILE_REGEXP__, Qt::CaseInsensitive, QRegExp::RegExp2);
+
+            if (rx.indexIn(requestURI) != -1)
+                f.setFileName(savepath()+"/"+rx.cap(1)+rx.cap(2));
+        }
+
+        if (!f.fileName().isEmpty()) {
+            f.open(QIODevice::ReadWrite);
+            bytesWritten = f.write(ba);
+            f.close();
+
+            if (bytesWritten == ba.size()) {
+                FolderIndex::instance().add(f.fileName());
+                savedCount++;
+                savedByteCount += bytesWritten;
+                emit imageAvailable(f.fileName());
+                setCompleted(requestURI, f.fileName());
+            }
+            else {
+                QLOG_ERROR() << "ThreadDownloadEngine :: Couldn't save file from URI " << requestURI;
+            }
+        }
+    }
+    else if (iParser != 0) {
+        emit statusChanged("Parsing");
+        iParser->setURL(url);
+        parseTime.start();
+        status = iParser->parseHTML(ba);
+        recordParse(requestURI, ba.size(), parseTime.nsecsElapsed(), status, cached);
+
+        if (status.hasErrors) {
+            QLOG_ERROR() << "ThreadDownloadEngine :: Parser error " << iParser->getErrorCode();
+            if (fragmentPages.contains(requestURI))
+                fragmentFinished(requestURI, QList<_IMAGE>());
+
+            switch (iParser->getErrorCode()) {
+            case 404:
+                stopDownload();
+                stop();
+                emit closeRequest(CLOSE_PARSER_NOT_FOUND);
+                break;
+
+            default:
+                emit parseFailed(iParser->getErrorCode());
+                break;
+            }
+        }
+        else {
+            _cachedResult = cached;
+
+            if (status.isFrontpage) {
+                if (status.hasTitle) {
+                    emit titleChanged(HTML::decode(iParser->getThreadTitle()));
+                }
+                if (!watchBoard())
+                    emit threadsFound(iParser->getUrlList());
+            }
+            else if (status.threadFragmented && followRedirects) {
+                followRedirects = false;
+                QLOG_INFO() << __func__ << ":: redirect list " << iParser->getUrlList();
+                fetchFragments(iParser->getUrlList());
+            }
+            else if (status.hasRedirect && followRedirects) {
+                QLOG_INFO() << __func__ << ":: redirecting to " << iParser->getRedirectURL().toString();
+                emit redirected(iParser->getRedirectURL());
+            }
+            else {
+                if (status.hasTitle) {
+                    emit titleChanged(HTML::decode(iParser->getThreadTitle()));
+                }
+
+                if (fragmentPages.contains(requestURI)) {
+                    fragmentFinished(requestURI, status.hasImages ? iParser->getImageList() : QList<_IMAGE>());
+                }
+                else if (status.hasImages) {
+                    imageList = iParser->getImageList();
+                    mergeImageList(imageList);
+                }
+                else {
+                    emit statusChanged("idle");
+                    if (isDownloadFinished())
+                        emit finished();
+                }
+            }
+        }
+
+        if (cached) {
+            timer->stop();
+            emit cachedResultReceived();
+        }
+    }
+}
+
+QStringList ThreadDownloadEngine::savedFiles(bool skipBlacklisted) const {
+    QStringList ret;
+
+    for (int i=0; i<images.length(); i++) {
+        if (images.at(i).downloaded && !images.at(i).savedAs.isEmpty()) {
+            if (skipBlacklisted && blackList != 0 && blackList->contains(images.at(i).largeURI))
+                continue;
+
+            ret << images.at(i).savedAs;
+        }
+    }
+
+    return ret;
+}
+
+bool ThreadDownloadEngine::urlOfFile(QString filename, QString * url) const {
+    bool ret;
+
+    ret = false;
+
+    for (int i=0; i<images.count(); i++) {
+        if (images.at(i).savedAs == filename) {
+            *url = images.at(i).largeURI;
+            ret = true;
+            break;
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * Forget that filename was downloaded and fetch it again
+ */
+bool ThreadDownloadEngine::reloadFile(QString filename) {
+    bool ret;
+    QString name;
+
+    ret = false;
+    name = filename.right(filename.count()-filename.lastIndexOf("/")-1);
+
+    for (int i=0; i<images.count(); i++) {
+        if ((_originalFilenames && images.at(i).originalFilename.endsWith(name))
+                || (!_originalFilenames && images.at(i).largeURI.endsWith(name))) {
+            setDownloaded(i, false, images.at(i).savedAs);
+            ret = true;
+            break;
+        }
+    }
+
+    if (ret)
+        download(true);
+
+    return ret;
+}
+
+void ThreadDownloadEngine::reloadAll() {
+    for (int i=0; i<images.length(); i++) {
+        if (images.at(i).downloaded) {
+            QFile::remove(images.at(i).savedAs);
+            FolderIndex::instance().remove(images.at(i).savedAs);
+            setDownloaded(i, false, images.at(i).savedAs);
+        }
+    }
+
+    download(true);
+}
+
+void ThreadDownloadEngine::clearImages() {
+    images.clear();
+    imageIndex.clear();
+    originalFilenames.clear();
+    downloadedCount = 0;
+    _revision = ++lastRevision;
+}
+
+/**
+ * Take over the image list of a saved session. The stored state is trusted, so
+ * files that are already downloaded are not looked up on disk again.
+ */
+void ThreadDownloadEngine::restoreImages(const QList<_IMAGE>& list) {
+    _IMAGE img;
+
+    clearImages();
+
+    for (int i=0; i<list.count(); i++) {
+        img = list.at(i);
+        img.requested = false;
+
+        imageIndex.insert(img.largeURI, images.count());
+        originalFilenames.insert(img.originalFilename);
+        images.append(img);
+        if (img.downloaded)
+            downloadedCount++;
+    }
+
+    // Same as the record it came from, see ThreadRecord::revision
+    _revision = 0;
+}
+
+bool ThreadDownloadEngine::isImage(QUrl url) {
+    bool ret;
+
+    ret = false;
+
+    if (url.toString().indexOf(QRegExp(__IMAGE_REGEXP__, Qt::CaseInsensitive)) != -1)
+        ret = true;
+
+    return ret;
+}
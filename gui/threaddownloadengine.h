@@ -0,0 +1,156 @@
+#ifndef THREADDOWNLOADENGINE_H
+#define THREADDOWNLOADENGINE_H
+
+#include <QObject>
+#include <QTimer>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QUrl>
+#include <QElapsedTimer>
+
+#include <memory>
+
+#include "structs.h"
+#include "blacklist.h"
+#include "downloadmanager.h"
+#include "pluginmanager.h"
+#include "requesthandler.h"
+#include "ParserPluginInterface.h"
+
+class BoardWatchEngine;
+
+// Pages of a fragmented thread are requested ahead of other pages and images
+#define FRAGMENT_PRIORITY 5
+// closeRequest() reason when the parser recognised the page as a 404 page. The
+// server answering 404 is reason 404, a finished thread 0, else the parser error
+#define CLOSE_PARSER_NOT_FOUND -404
+
+/**
+ * UI-free core of a thread download: keeps the image list, dispatches pages
+ * to the parser plugin, saves images and runs the rescan timer. Both the GUI
+ * (UIImageOverview) and the console (ImageThread) drive one engine per thread.
+ */
+class ThreadDownloadEngine : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ThreadDownloadEngine(
+      std::shared_ptr<DownloadManager> downloadManager_,
+      std::shared_ptr<PluginManager> pluginManager_,
+      QObject *parent = nullptr);
+
+    void setUrl(QString url);
+    QString url() const {return _url;}
+    void setSavepath(QString path) {_savepath = path;}
+    void setOriginalFilenames(bool b) {_originalFilenames = b;}
+    void setRescanInterval(int seconds) {_rescanInterval = seconds;}
+    int rescanInterval() const {return _rescanInterval;}
+    void setBlackList(BlackList* bl) {blackList = bl;}
+    void setBlocked(bool b) {_blocked = b;}
+
+    bool start();
+    void stop();
+    bool isRunning() const {return _running;}
+    bool isCachedResult() const {return _cachedResult;}
+    QString lastError() const {return _lastError;}
+    QString savepath();
+
+    // Include the threads of a watched board
+    int totalImages() const;
+    int downloadedImages() const;
+    bool isDownloadFinished() const;
+    bool isWatchingBoard() const {return boardWatch != 0;}
+    int savedImages() const {return savedCount;}
+    qint64 savedBytes() const {return savedByteCount;}
+
+    QStringList savedFiles(bool skipBlacklisted = true) const;
+    bool urlOfFile(QString filename, QString* url) const;
+    bool reloadFile(QString filename);
+    void reloadAll();
+    void clearImages();
+
+    // Image state for the session store
+    QList<_IMAGE> imageList() const {return images;}
+    quint64 revision() const {return _revision;}
+    void restoreImages(const QList<_IMAGE>& list);
+
+    static bool isImage(QUrl url);
+
+private:
+    std::shared_ptr<DownloadManager> downloadManager;
+    std::shared_ptr<PluginManager> pluginManager;
+    RequestHandler* requestHandler;
+    ParserPluginInterface* iParser;
+    QObject* oParser;
+    BlackList* blackList;
+    QTimer* timer;
+    BoardWatchEngine* boardWatch;
+    QElapsedTimer parseTime;
+    int lastImageCount;
+
+    QList<_IMAGE> images;
+    QHash<QString, int> imageIndex;     // largeURI -> position in images
+    QSet<QString> originalFilenames;
+    int downloadedCount;
+    int savedCount;
+    qint64 savedByteCount;
+    quint64 _revision;
+    static quint64 lastRevision;
+
+    QString _url;
+    QString _savepath;
+    QString _lastError;
+    bool _originalFilenames;
+    int _rescanInterval;
+    bool _running;
+    bool _blocked;
+    bool _cachedResult;
+    bool downloading;
+    bool closeWhenFinished;
+    bool followRedirects;
+
+    // Fragmented threads: pending page url -> page number, parsed pages
+    QHash<QString, int> fragmentPages;
+    QMap<int, QList<_IMAGE> > fragmentImages;
+
+    bool selectParser(QUrl url=QUrl());
+    bool watchBoard();
+    void recordParse(const QString& uri, qint64 bytes, qint64 ns, const ParsingStatus& status, bool cached);
+    void createSupervisedDownload(QUrl);
+    void fetchFragments(QList<QUrl> pages);
+    void fragmentFinished(QString uri, QList<_IMAGE> list);
+    bool getNextImage(int* from, QString* s);
+    void mergeImageList(QList<_IMAGE> list);
+    bool addImage(_IMAGE img);
+    void setCompleted(QString uri, QString filename);
+    void setDownloaded(int i, bool downloaded, QString savedAs);
+    QString targetFilename(const _IMAGE& img);
+
+private slots:
+    void errorHandler(QUrl, int);
+    void processRequestResponse(const QUrl& url, const QByteArray& ba, bool cached);
+
+public slots:
+    void startDownload(void);
+    void stopDownload(void);
+    void download(bool b);
+    void triggerRescan(void);
+
+signals:
+    void statusChanged(QString);
+    void errorMessage(QString);
+    void titleChanged(QString);
+    void urlChanged(QString);
+    void redirected(QUrl);
+    void threadsFound(QList<QUrl>);
+    void imageAvailable(QString filename);
+    void progressChanged(int downloaded, int total);
+    void cachedResultReceived();
+    void parseFailed(int errorCode);
+    void banned();
+    void closeRequest(int reason);
+    void finished();
+};
+
+#endif // THREADDOWNLOADENGINE_H
@@ -0,0 +1,207 @@
+#include <QFont>
+#include <QIcon>
+#include <QBrush>
+
+#include "threadoverviewmodel.h"
+#include "threadtab.h"
+
+ThreadOverviewModel::ThreadOverviewModel(QObject *parent) :
+    QAbstractTableModel(parent)
+{
+    currentRow = -1;
+    dirtyRows = 0;
+}
+
+int ThreadOverviewModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : rows.count();
+}
+
+int ThreadOverviewModel::columnCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant ThreadOverviewModel::data(const QModelIndex &index, int role) const {
+    QVariant ret;
+
+    if (!index.isValid() || index.row() >= rows.count())
+        return ret;
+
+    const Row& r = rows.at(index.row());
+
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case ColumnName:    ret = r.title; break;
+        case ColumnImages:  ret = QString("%1/%2").arg(r.downloaded).arg(r.total); break;
+        case ColumnStatus:  ret = r.status; break;
+        case ColumnUri:     ret = r.uri; break;
+        }
+        break;
+
+    case Qt::ForegroundRole:
+        if (index.column() == ColumnName)
+            ret = QBrush(r.newImages ? Qt::darkGreen : Qt::black);
+        break;
+
+    case Qt::FontRole:
+        if (index.column() == ColumnName && r.newImages) {
+            QFont f;
+            f.setBold(true);
+            ret = f;
+        }
+        break;
+
+    case Qt::DecorationRole:
+        if (index.column() == ColumnName && index.row() == currentRow)
+            ret = QIcon(":/icons/resources/go-next.png");
+        break;
+    }
+
+    return ret;
+}
+
+QVariant ThreadOverviewModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    QVariant ret;
+
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole) {
+        switch (section) {
+        case ColumnName:    ret = QString("Name"); break;
+        case ColumnImages:  ret = QString("Images"); break;
+        case ColumnStatus:  ret = QString("Status"); break;
+        case ColumnUri:     ret = QString("URI"); break;
+        }
+    }
+
+    return ret;
+}
+
+void ThreadOverviewModel::appendThread(ThreadTab* tab) {
+    Row r;
+
+    r.tab = tab;
+    r.downloaded = 0;
+    r.total = 0;
+    r.newImages = false;
+    r.dirty = false;
+
+    beginInsertRows(QModelIndex(), rows.count(), rows.count());
+    rowOf.insert(tab, rows.count());
+    rows.append(r);
+    refreshRow(rows.count()-1);
+    endInsertRows();
+
+    connect(tab, SIGNAL(changed()), this, SLOT(threadChanged()));
+}
+
+void ThreadOverviewModel::removeThread(ThreadTab* tab) {
+    int row;
+
+    row = rowOf.value(tab, -1);
+    if (row == -1)
+        return;
+
+    disconnect(tab, 0, this, 0);
+
+    beginRemoveRows(QModelIndex(), row, row);
+    if (rows.at(row).dirty)
+        dirtyRows--;
+    rows.removeAt(row);
+    endRemoveRows();
+
+    // Rows behind the removed one moved up
+    rowOf.clear();
+    for (int i=0; i<rows.count(); i++)
+        rowOf.insert(rows.at(i).tab.data(), i);
+
+    if (currentRow == row)
+        currentRow = -1;
+    else if (currentRow > row)
+        currentRow--;
+}
+
+void ThreadOverviewModel::setCurrentRow(int row) {
+    int old;
+
+    old = currentRow;
+    currentRow = row;
+
+    if (old >= 0 && old < rows.count())
+        emit dataChanged(index(old, ColumnName), index(old, ColumnName), QVector<int>() << Qt::DecorationRole);
+    if (row >= 0 && row < rows.count())
+        emit dataChanged(index(row, ColumnName), index(row, ColumnName), QVector<int>() << Qt::DecorationRole);
+}
+
+void ThreadOverviewModel::threadChanged() {
+    int row;
+
+    row = rowOf.value(qobject_cast<ThreadTab*>(sender()), -1);
+
+    if (row != -1 && !rows.at(row).dirty) {
+        rows[row].dirty = true;
+        dirtyRows++;
+    }
+}
+
+/**
+ * Re-read all rows whose tab reported a change since the last call
+ */
+void ThreadOverviewModel::update() {
+    if (dirtyRows == 0)
+        return;
+
+    for (int i=0; i<rows.count(); i++) {
+        if (rows.at(i).dirty) {
+            foreach (int column, refreshRow(i)) {
+                emit dataChanged(index(i, column), index(i, column));
+            }
+        }
+    }
+
+    dirtyRows = 0;
+}
+
+/**
+ * Reads the tab behind row and returns the columns whose content changed
+ */
+QList<int> ThreadOverviewModel::refreshRow(int row) {
+    Row& r = rows[row];
+    QList<int> changed;
+    QString s;
+    int d, t;
+    bool b;
+
+    r.dirty = false;
+
+    if (r.tab == 0)
+        return changed;
+
+    s = r.tab->getTitle();
+    b = r.tab->hasNewImages();
+    if (s != r.title || b != r.newImages) {
+        r.title = s;
+        r.newImages = b;
+        changed << ColumnName;
+    }
+
+    d = r.tab->getDownloadedImagesCount();
+    t = r.tab->getTotalImagesCount();
+    if (d != r.downloaded || t != r.total) {
+        r.downloaded = d;
+        r.total = t;
+        changed << ColumnImages;
+    }
+
+    s = r.tab->getStatus();
+    if (s != r.status) {
+        r.status = s;
+        changed << ColumnStatus;
+    }
+
+    s = r.tab->getURI();
+    if (s != r.uri) {
+        r.uri = s;
+        changed << ColumnUri;
+    }
+
+    return changed;
+}
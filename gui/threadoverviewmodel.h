@@ -0,0 +1,63 @@
+﻿#ifndef THREADOVERVIEWMODEL_H
+#define THREADOVERVIEWMODEL_H
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+
+class ThreadTab;
+
+/**
+ * Rows of the thread overview dock, one per tab in tab order. Tabs only mark
+ * their row dirty when they change; update() re-reads the dirty rows and
+ * emits dataChanged for the cells that actually differ.
+ */
+class ThreadOverviewModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    enum Column {
+        ColumnName = 0,
+        ColumnImages,
+        ColumnStatus,
+        ColumnUri,
+        ColumnCount
+    };
+
+    explicit ThreadOverviewModel(QObject *parent = 0);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+    void appendThread(ThreadTab*);
+    void removeThread(ThreadTab*);
+    void setCurrentRow(int row);
+
+private:
+    struct Row {
+        QPointer<ThreadTab> tab;
+        QString title;
+        int downloaded;
+        int total;
+        QString status;
+        QString uri;
+        bool newImages;
+        bool dirty;
+    };
+
+    QList<Row> rows;
+    QHash<ThreadTab*, int> rowOf;
+    int currentRow;
+    int dirtyRows;
+
+    QList<int> refreshRow(int row);
+
+public slots:
+    void threadChanged();
+    void update();
+};
+
+#endif // THREADOVERVIEWMODEL_H
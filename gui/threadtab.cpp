@@ -0,0 +1,312 @@
+#include "threadtab.h"
+
+ThreadTab::ThreadTab(
+  std::shared_ptr<DownloadManager> downloadManager_,
+  std::shared_ptr<PluginManager> pluginManager_,
+  std::shared_ptr<FolderShortcuts> folderShortcuts_,
+  std::shared_ptr<ThumbnailCreator> thumbnailCreator_,
+  QWidget *parent) :
+    QWidget(parent),
+    downloadManager(downloadManager_),
+    pluginManager(pluginManager_),
+    folderShortcuts(folderShortcuts_),
+    thumbnailCreator(thumbnailCreator_)
+{
+    int defaultTimeout;
+
+    engine = new ThreadDownloadEngine(downloadManager, pluginManager, this);
+    blackList = 0;
+    configured = false;
+    running = false;
+    newImages = 0;
+
+    layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+
+    // Same defaults a fresh UIImageOverview would show
+    defaultTimeout = settings.getDefaultTimeout();
+    values << ""
+           << settings.getDefaultDirectory()
+           << QString("%1").arg(defaultTimeout != 0)
+           << QString("%1").arg(defaultTimeout != 0 ? defaultTimeout : settings.getTimeoutValues().value(0).toInt())
+           << QString("%1").arg(settings.getDefaultOriginalFilename())
+           << "0"
+           << "0";
+
+    connect(engine, SIGNAL(statusChanged(QString)), this, SLOT(setStatus(QString)));
+    connect(engine, SIGNAL(errorMessage(QString)), this, SIGNAL(errorMessage(QString)));
+    connect(engine, SIGNAL(titleChanged(QString)), this, SLOT(setThreadTitle(QString)));
+    connect(engine, SIGNAL(urlChanged(QString)), this, SLOT(setUrl(QString)));
+    connect(engine, SIGNAL(redirected(QUrl)), this, SLOT(followRedirect(QUrl)));
+    connect(engine, SIGNAL(threadsFound(QList<QUrl>)), this, SLOT(openThreads(QList<QUrl>)));
+    connect(engine, SIGNAL(imageAvailable(QString)), this, SLOT(imageAvailable()));
+    connect(engine, SIGNAL(progressChanged(int,int)), this, SLOT(updateDownloadStatus(int,int)));
+    connect(engine, SIGNAL(cachedResultReceived()), this, SLOT(showCachedResult()));
+    connect(engine, SIGNAL(banned()), this, SLOT(threadBanned()));
+    connect(engine, SIGNAL(closeRequest(int)), this, SLOT(engineCloseRequest(int)));
+}
+
+/**
+ * Builds the UIImageOverview for this tab and hands the engine over to it.
+ * From here on every call is forwarded to the overview.
+ */
+UIImageOverview* ThreadTab::activate() {
+    QString v;
+
+    if (overview == 0) {
+        QLOG_TRACE() << "ThreadTab :: Activating tab for" << values.value(0);
+        v = getValues();
+
+        disconnect(engine, 0, this, 0);
+
+        overview = new UIImageOverview(downloadManager, pluginManager, folderShortcuts, thumbnailCreator, engine, this);
+        if (blackList != 0)
+            overview->setBlackList(blackList);
+
+        connect(overview, SIGNAL(errorMessage(QString)), this, SIGNAL(errorMessage(QString)));
+        connect(overview, SIGNAL(tabTitleChanged(UIImageOverview*, QString)), this, SLOT(overviewTitleChanged(UIImageOverview*, QString)));
+        connect(overview, SIGNAL(closeRequest(UIImageOverview*, int)), this, SLOT(overviewCloseRequest(UIImageOverview*, int)));
+        connect(overview, SIGNAL(directoryChanged(QString)), this, SIGNAL(directoryChanged(QString)));
+        connect(overview, SIGNAL(createTabRequest(QString)), this, SIGNAL(createTabRequest(QString)));
+        connect(overview, SIGNAL(removeFiles(QStringList)), this, SIGNAL(removeFiles(QStringList)));
+        connect(overview, SIGNAL(changed()), this, SIGNAL(changed()));
+
+        // Carry over what the headless tab already knows, the engine won't report it again
+        overview->setThreadTitle(title);
+        overview->setStatus(status);
+        if (!tabTitle.isEmpty())
+            overview->setTabTitle(tabTitle);
+
+        if (configured)
+            overview->setValues(v);
+        else
+            overview->setDirectory(values.value(1));
+
+        layout->addWidget(overview);
+    }
+
+    return overview;
+}
+
+void ThreadTab::start(void) {
+    if (overview != 0) {
+        overview->start();
+    }
+    else if (values.value(6).toInt() == 1) {
+        setStatus("Blocked");
+    }
+    else {
+        running = true;
+        setStatus("Running");
+
+        if (values.value(0) != "") {
+            engine->setUrl(values.value(0));
+            engine->setSavepath(values.value(1));
+            engine->setOriginalFilenames((bool)values.value(4).toInt());
+            if (values.value(2).toInt() != 0)
+                engine->setRescanInterval(values.value(3).toInt());
+            else
+                engine->setRescanInterval(0);
+
+            if (!engine->start()) {
+                stop();
+                setStatus(engine->lastError());
+            }
+        }
+    }
+}
+
+void ThreadTab::stop(void) {
+    if (overview != 0) {
+        overview->stop();
+    }
+    else {
+        running = false;
+        engine->stop();
+        setStatus("Stopped");
+    }
+}
+
+QString ThreadTab::getURI() {
+    return overview != 0 ? overview->getURI() : values.value(0);
+}
+
+QString ThreadTab::getTitle() {
+    return overview != 0 ? overview->getTitle() : title;
+}
+
+QString ThreadTab::getStatus() {
+    return overview != 0 ? overview->getStatus() : status;
+}
+
+bool ThreadTab::hasNewImages() {
+    return overview != 0 ? overview->hasNewImages() : newImages > 0;
+}
+
+void ThreadTab::threadViewed() {
+    if (overview != 0) {
+        overview->threadViewed();
+    }
+    else {
+        newImages = 0;
+        emit changed();
+    }
+}
+
+int ThreadTab::getTotalImagesCount() {
+    return engine->totalImages();
+}
+
+int ThreadTab::getDownloadedImagesCount() {
+    return engine->downloadedImages();
+}
+
+void ThreadTab::setDirectory(QString d) {
+    if (overview != 0)
+        overview->setDirectory(d);
+    else
+        values.replace(1, d);
+}
+
+QString ThreadTab::getValues(void) {
+    QStringList list;
+
+    if (overview != 0)
+        return overview->getValues();
+
+    list = values;
+    list.replace(5, QString("%1").arg(running));
+
+    return list.join(";;");
+}
+
+void ThreadTab::setValues(QString s) {
+    QStringList list;
+
+    if (overview != 0) {
+        overview->setValues(s);
+    }
+    else {
+        list = s.split(";;");
+        while (list.count() < values.count())
+            list << values.at(list.count());
+
+        values = list;
+        configured = true;
+
+        if (values.value(5) == "1") {
+            start();
+        }
+    }
+}
+
+chandl::ThreadRecord ThreadTab::sessionRecord() {
+    chandl::ThreadRecord ret;
+
+    ret = chandl::ThreadRecord::fromValues(getValues());
+    ret.images = engine->imageList();
+    ret.revision = engine->revision();
+
+    return ret;
+}
+
+void ThreadTab::restoreSession(const chandl::ThreadRecord& record) {
+    engine->restoreImages(record.images);
+    setValues(record.toValues());
+}
+
+void ThreadTab::updateSettings(void) {
+    if (overview != 0)
+        overview->updateSettings();
+}
+
+void ThreadTab::setBlackList(BlackList *bl) {
+    blackList = bl;
+    engine->setBlackList(bl);
+
+    if (overview != 0)
+        overview->setBlackList(bl);
+}
+
+void ThreadTab::setTabTitle(QString s) {
+    tabTitle = s;
+    emit tabTitleChanged(this, s);
+}
+
+void ThreadTab::setStatus(QString s) {
+    status = s;
+    emit changed();
+}
+
+void ThreadTab::setUrl(QString s) {
+    values.replace(0, s);
+}
+
+void ThreadTab::followRedirect(QUrl url) {
+    values.replace(0, url.toString());
+    stop();
+    start();
+}
+
+void ThreadTab::openThreads(QList<QUrl> threadList) {
+    QStringList newTab;
+
+    newTab = getValues().split(";;");
+
+    foreach (QUrl u, threadList) {
+        newTab.replace(0, u.toString());
+        emit createTabRequest(newTab.join(";;"));
+    }
+
+    if (chandl::settingsSnapshot()->closeOverviewThreads) {
+        emit closeRequest(this, 0);
+    }
+}
+
+void ThreadTab::updateDownloadStatus(int d, int t) {
+    if (!engine->isDownloadFinished()) {
+        setTabTitle(QString("%1/%2").arg(d).arg(t));
+        setStatus("downloading");
+    }
+    else if (engine->isCachedResult()) {
+        setTabTitle("Cached");
+        setStatus("Cached");
+    }
+    else {
+        setTabTitle("Finished");
+        setStatus("Finished");
+    }
+}
+
+void ThreadTab::showCachedResult() {
+    values.replace(2, "0");
+    setStatus("Cached");
+}
+
+void ThreadTab::threadBanned() {
+    setTabTitle("Banned");
+}
+
+void ThreadTab::engineCloseRequest(int reason) {
+    stop();
+
+    if (reason == 404) {
+        setTabTitle("Thread 404'ed");
+    }
+
+    emit closeRequest(this, reason);
+}
+
+void ThreadTab::showEvent(QShowEvent *event) {
+    activate();
+    QWidget::showEvent(event);
+}
+
+void ThreadTab::closeEvent(QCloseEvent *event) {
+    if (overview != 0)
+        overview->close();
+    else if (running)
+        stop();
+
+    event->accept();
+}
@@ -0,0 +1,112 @@
+﻿#ifndef THREADTAB_H
+#define THREADTAB_H
+
+#include <QWidget>
+#include <QPointer>
+#include <QStringList>
+#include <QVBoxLayout>
+#include <QShowEvent>
+#include <QCloseEvent>
+
+#include <memory>
+
+#include "threaddownloadengine.h"
+#include "uiimageoverview.h"
+#include "appsettings.h"
+#include "sessionstore.h"
+
+class UIImageOverview;
+
+/**
+ * One tab of the main window. Until the tab is shown for the first time only
+ * the ThreadDownloadEngine exists and downloads run headless; the full
+ * UIImageOverview (form, thumbnails, context menus) is built on first show and
+ * takes over the running engine. Restoring a session therefore only costs the
+ * engines plus the widgets of the tabs that are actually looked at.
+ */
+class ThreadTab : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit ThreadTab(
+      std::shared_ptr<DownloadManager> downloadManager_,
+      std::shared_ptr<PluginManager> pluginManager_,
+      std::shared_ptr<FolderShortcuts> folderShortcuts_,
+      std::shared_ptr<ThumbnailCreator> thumbnailCreator_,
+      QWidget *parent = nullptr);
+
+    bool isActivated() const {return overview != 0;}
+    UIImageOverview* activate();
+
+    QString getURI();
+    QString getTitle();
+    QString getStatus();
+    bool hasNewImages();
+    void threadViewed();
+    int getTotalImagesCount();
+    int getDownloadedImagesCount();
+
+    void setDirectory(QString);
+    QString getValues(void);
+    void setValues(QString);
+    void updateSettings(void);
+    void setBlackList(BlackList* bl);
+
+    chandl::ThreadRecord sessionRecord();
+    void restoreSession(const chandl::ThreadRecord& record);
+
+private:
+    chandl::AppSettings settings;
+    ThreadDownloadEngine* engine;
+    QPointer<UIImageOverview> overview;
+    QVBoxLayout* layout;
+    BlackList* blackList;
+
+    QStringList values;
+    bool configured;
+    bool running;
+    QString title;
+    QString status;
+    QString tabTitle;
+    int newImages;
+
+    std::shared_ptr<DownloadManager> downloadManager;
+    std::shared_ptr<PluginManager> pluginManager;
+    std::shared_ptr<FolderShortcuts> folderShortcuts;
+    std::shared_ptr<ThumbnailCreator> thumbnailCreator;
+
+    void setTabTitle(QString);
+
+private slots:
+    void setStatus(QString);
+    void setThreadTitle(QString s) {title = s;}
+    void setUrl(QString);
+    void followRedirect(QUrl);
+    void openThreads(QList<QUrl>);
+    void imageAvailable() {newImages++;}
+    void updateDownloadStatus(int, int);
+    void showCachedResult();
+    void threadBanned();
+    void engineCloseRequest(int);
+    void overviewTitleChanged(UIImageOverview*, QString s) {emit tabTitleChanged(this, s);}
+    void overviewCloseRequest(UIImageOverview*, int reason) {emit closeRequest(this, reason);}
+
+public slots:
+    void start(void);
+    void stop(void);
+
+signals:
+    void errorMessage(QString);
+    void tabTitleChanged(ThreadTab*,QString);
+    void directoryChanged(QString);
+    void closeRequest(ThreadTab*, int);
+    void createTabRequest(QString);
+    void removeFiles(QStringList);
+    void changed();
+
+protected:
+    void showEvent(QShowEvent *);
+    void closeEvent(QCloseEvent *);
+};
+
+#endif // THREADTAB_H
@@ -8,6 +8,7 @@
 #include "QsLog.h"
 
 #include "thumbnailcreator.h"
+#include "frameextractor.h"
 
 ThumbnailCreator::ThumbnailCreator() :
   QThread(nullptr)
@@ -17,6 +18,7 @@ ThumbnailCreator::ThumbnailCreator() :
 void ThumbnailCreator::run() {
   QImage original, tn;
   QDir dir;
+  auto frames = chandl::FrameExtractor::create();
 
   while (!stopped) {
     QString currentFilename;
@@ -37,6 +39,7 @@ void ThumbnailCreator::run() {
       continue;
     }
 
+    auto config = chandl::settingsSnapshot();
     auto cacheFile = getCacheFile(currentFilename);
 
     bool useCachedThumbnail = false;
@@ -45,11 +48,11 @@ void ThumbnailCreator::run() {
     int iconWidth = iconSize.width();
     int iconHeight = iconSize.height();
 
-    bool enlargeThumbnails = settings.getEnlargeThumbnails();
-    bool hqRendering = settings.getHQThumbnails();
+    bool enlargeThumbnails = config->enlargeThumbnails;
+    bool hqRendering = config->hqThumbnails;
     auto useCache = true;
 
-    auto cacheFolder = settings.getThumbnailCacheFolder();
+    auto cacheFolder = config->thumbnailCacheFolder;
 
     //        QLOG_ALWAYS() << "ThumbnailCreator :: Using thumbnail folder " << cacheFolder;
     if (useCache && !(dir.exists(cacheFolder))) {
@@ -69,7 +72,11 @@ void ThumbnailCreator::run() {
 
     if (!useCachedThumbnail) {
       QLOG_TRACE() << "ThumbnailCreator :: Creating new thumbnail for " << currentFilename;
-      if (original.load(currentFilename)) {
+      if (frames && chandl::FrameExtractor::isVideo(currentFilename)
+        && frames->extractFrame(currentFilename, iconSize, &original)) {
+        image_loaded = true;
+      }
+      else if (original.load(currentFilename)) {
         image_loaded = true;
       }
       else {
@@ -151,7 +158,7 @@ QString ThumbnailCreator::addToList(QString s) {
 QString ThumbnailCreator::getCacheFile(QString filename) {
   QString tmp, ret;
 
-  auto cacheFolder = settings.getThumbnailCacheFolder();
+  auto cacheFolder = chandl::settingsSnapshot()->thumbnailCacheFolder;
 
   tmp = filename;
   tmp.replace(QRegExp("[" + QRegExp::escape("\\/:*?\"<>|") + "]"), QString("_"));
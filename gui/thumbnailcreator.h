@@ -11,7 +11,7 @@
 #include <QWaitCondition>
 #include <QThread>
 
-#include "appsettings.h"
+#include "settingssnapshot.h"
 
 class ThumbnailCreator : public QThread
 {
@@ -35,7 +35,6 @@ private:
   QAtomicInt paused = false;
   QMutex mutex;
   QWaitCondition condition;
-  chandl::AppSettings settings;
 
 signals:
   void pendingThumbnails(int);
@@ -137,9 +137,6 @@ void UIConfig::loadSettings(void) {
     ui->cmbUserAgent->clear();
     ui->cmbUserAgent->addItems(userAgentStrings.keys());
 
-    ui->sbUpdaterPort->setValue(settings.getUpdaterPort());
-    ui->sbApplicationPort->setValue(settings.getUpdaterAppPort());
-
     timeoutValueEditor->loadSettings();
 }
 
@@ -183,9 +180,6 @@ void UIConfig::accept(void) {
   settings.setUserAgent(ui->leUserAgent->text());
   settings.setCompressCacheFile(ui->cbCompressCacheFile->isChecked());
 
-  settings.setUpdaterPort(ui->sbUpdaterPort->value());
-  settings.setUpdaterAppPort(ui->sbApplicationPort->value());
-
   settings.sync();
 
   emit configurationChanged();
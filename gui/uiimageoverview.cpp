@@ -1,11 +1,13 @@
 ﻿#include "uiimageoverview.h"
 #include "ui_uiimageoverview.h"
+#include "folderindex.h"
 
 UIImageOverview::UIImageOverview(
   std::shared_ptr<DownloadManager> downloadManager_, 
   std::shared_ptr<PluginManager> pluginManager_,
   std::shared_ptr<FolderShortcuts> folderShortcuts_,
   std::shared_ptr<ThumbnailCreator> thumbnailCreator_,
+  ThreadDownloadEngine* engine_,
   QWidget *parent) :
     QWidget(parent),
     ui(new Ui::UIImageOverview),
@@ -17,14 +19,10 @@ UIImageOverview::UIImageOverview(
     QClipboard *clipboard = QApplication::clipboard();
     QTime time;
 
-    requestHandler = new RequestHandler(downloadManager, this);
-    iParser = 0;
-    oParser = 0;
-    parserThread = new QThread();
-    _cachedResult = false;
+    engine = engine_;       // Owned by the ThreadTab, which may have started it before we exist
+    running = false;
     _threadBlocked = false;
     fresh_thread = true;
-    follow_redirects = true;
 
     pendingThumbnails.clear();
 
@@ -34,15 +32,11 @@ UIImageOverview::UIImageOverview(
     ui->btnDebug->hide();
 #endif
 
-    timer = new QTimer(this);
-
     thumbnailCheckTimer = new QTimer(this);
     thumbnailCheckTimer->setInterval(5000+time.msec());
     thumbnailCheckTimer->setSingleShot(true);
 
     thumbnailsizeLocked = false;
-    closeWhenFinished = false;
-    downloading = false;
 
     deleteFileAction = new QAction(QString("Delete File"), this);
     deleteFileAction->setIcon(QIcon(":/icons/resources/remove.png"));
@@ -62,8 +56,17 @@ UIImageOverview::UIImageOverview(
         ui->leURI->setText(clipboard->text());
     }
 
-    connect(requestHandler, SIGNAL(responseError(QUrl, int)), this, SLOT(errorHandler(QUrl, int)));
-    connect(requestHandler, SIGNAL(response(QUrl, QByteArray, bool)), this, SLOT(processRequestResponse(QUrl, QByteArray, bool)));
+    connect(engine, SIGNAL(statusChanged(QString)), this, SLOT(setStatus(QString)));
+    connect(engine, SIGNAL(errorMessage(QString)), this, SIGNAL(errorMessage(QString)));
+    connect(engine, SIGNAL(titleChanged(QString)), this, SLOT(setThreadTitle(QString)));
+    connect(engine, SIGNAL(urlChanged(QString)), ui->leURI, SLOT(setText(QString)));
+    connect(engine, SIGNAL(redirected(QUrl)), this, SLOT(followRedirect(QUrl)));
+    connect(engine, SIGNAL(threadsFound(QList<QUrl>)), this, SLOT(openThreads(QList<QUrl>)));
+    connect(engine, SIGNAL(imageAvailable(QString)), this, SLOT(createThumbnail(QString)));
+    connect(engine, SIGNAL(progressChanged(int,int)), this, SLOT(updateDownloadStatus()));
+    connect(engine, SIGNAL(cachedResultReceived()), this, SLOT(showCachedResult()));
+    connect(engine, SIGNAL(banned()), this, SLOT(threadBanned()));
+    connect(engine, SIGNAL(closeRequest(int)), this, SLOT(engineCloseRequest(int)));
 
     connect(ui->leSavepath, SIGNAL(textChanged(QString)), this, SIGNAL(directoryChanged(QString)));
     connect(ui->listWidget, SIGNAL(itemDoubleClicked(QListWidgetItem*)), this, SLOT(openFile()));
@@ -72,7 +75,6 @@ UIImageOverview::UIImageOverview(
     connect(reloadFileAction, SIGNAL(triggered()), this, SLOT(reloadFile()));
     connect(openFileAction, SIGNAL(triggered()), this, SLOT(openFile()));
 
-    connect(timer, SIGNAL(timeout()), this, SLOT(triggerRescan()));
     connect(folderShortcuts.get(), SIGNAL(shortcutsChanged()), this, SLOT(fillShortcutComboBox()));
     connect(ui->cbFolderShortcuts, SIGNAL(currentIndexChanged(QString)), this, SLOT(selectShortcut(QString)));
     connect(ui->leSavepath, SIGNAL(textChanged(QString)), this, SLOT(checkForFolderShortcut(QString)));
@@ -118,9 +120,6 @@ bool UIImageOverview::setThumbnailSize(QSize s) {
 }
 
 void UIImageOverview::start(void) {
-    QDir dir;
-    QString savepath;
-
     if (_threadBlocked) {
         setStatus("Blocked");
     }
@@ -131,75 +130,47 @@ void UIImageOverview::start(void) {
         if (ui->leURI->text() != "") {
             ui->leURI->setReadOnly(true);
 
-            if (!ui->leURI->text().startsWith("http")) {
-                QString s;
-                s = ui->leURI->text();
-                s.prepend("http://");
-                ui->leURI->setText(s);
-            }
-
-            // Check if we can parse this URI
-            if (selectParser()) {
-                savepath = getSavepath();
-
-                if (savepath.endsWith("\\")) {
-                    savepath.chop(1);
-                    //ui->leSavepath->setText(savepath);
-                }
-                QLOG_TRACE() << "UIImageOverview :: Setting save path to " << savepath;
-                dir.setPath(savepath);
-
-                if (!dir.exists()) {
-                    QDir d;
+            engine->setUrl(ui->leURI->text());
+            engine->setSavepath(ui->leSavepath->text());
+            engine->setOriginalFilenames(ui->cbOriginalFilename->isChecked());
+            if (ui->cbRescan->isChecked())
+                engine->setRescanInterval(timeoutValues.at(ui->comboBox->currentIndex()));
+            else
+                engine->setRescanInterval(0);
 
-                    d.mkpath(savepath);
-                    QLOG_INFO() << "UIImageOverview :: Directory" << savepath << " does not exist. Creating...";
-                }
-
-                if (dir.exists()) {
-                    ui->leSavepath->setEnabled(false);
-                    startDownload();
-
-                    ui->btnStart->setEnabled(false);
-                    ui->btnStop->setEnabled(true);
-                    ui->cbRescan->setEnabled(false);
-                    ui->comboBox->setEnabled(false);
-                    //                ui->progressBar->setEnabled(true);
-                    ui->cbOriginalFilename->setEnabled(false);
-                    ui->btnChoosePath->setEnabled(false);
-                    ui->cbFolderShortcuts->setEnabled(false);
-
-                    if (ui->cbRescan->isChecked()) {
-                        timer->setInterval(timeoutValues.at(ui->comboBox->currentIndex())*1000);
-
-                        timer->start();
-                    }
-                    // Hide thread settings
-                    if ((ui->btnToggleView->isChecked()))
-                        ui->btnToggleView->setChecked(false);
-                }
-                else
-                {
-                    stop();
-                    emit errorMessage("Directory does not exist / Could not be created");
-                    setStatus("Directory does not exist / Could not be created");
-                    QLOG_ERROR() << "UIImageOverview :: Directory" << savepath << " does not exist and I couldn't create it.";
-                }
+            if (engine->start()) {
+                lockThreadSettings();
             }
             else {
                 stop();
-                emit errorMessage("Could not find a parser for this URL (" + ui->leURI->text() + ")");
-                setStatus("No parser available");
-                QLOG_WARN() << "UIImageOverview :: I couldn't find a parser for uri " << ui->leURI->text();
+                setStatus(engine->lastError());
             }
         }
     }
 }
 
+void UIImageOverview::lockThreadSettings() {
+    ui->leURI->setReadOnly(true);
+    ui->leSavepath->setEnabled(false);
+    ui->btnReloadThread->setEnabled(true);
+
+    ui->btnStart->setEnabled(false);
+    ui->btnStop->setEnabled(true);
+    ui->cbRescan->setEnabled(false);
+    ui->comboBox->setEnabled(false);
+    //                ui->progressBar->setEnabled(true);
+    ui->cbOriginalFilename->setEnabled(false);
+    ui->btnChoosePath->setEnabled(false);
+    ui->cbFolderShortcuts->setEnabled(false);
+
+    // Hide thread settings
+    if ((ui->btnToggleView->isChecked()))
+        ui->btnToggleView->setChecked(false);
+}
+
 void UIImageOverview::stop(void) {
     running = false;
-    stopDownload();
-    timer->stop();
+    engine->stop();
     ui->btnStart->setEnabled(true);
     ui->btnStop->setEnabled(false);
     ui->leURI->setReadOnly(false);
@@ -215,12 +186,6 @@ void UIImageOverview::stop(void) {
     if (!(ui->btnToggleView->isChecked()))
         ui->btnToggleView->setChecked(true);
 
-    if (oParser != 0) {
-        oParser->deleteLater();
-        oParser = 0;
-        iParser = 0;
-    }
-
     setStatus("Stopped");
 }
 
@@ -237,15 +202,6 @@ void UIImageOverview::chooseLocation(void) {
     }
 }
 
-void UIImageOverview::triggerRescan(void) {
-    if (!_threadBlocked) {
-        startDownload();
-        timer->start();
-
-        setStatus("rescanning");
-    }
-}
-
 void UIImageOverview::createThumbnail(QString s) {
     QString thumbnail_location;
     if (!_threadBlocked) {
@@ -352,11 +308,12 @@ void UIImageOverview::deleteFile(void) {
 
         if (f.exists()) {
             f.remove();
+            FolderIndex::instance().remove(filename);
 
             ui->listWidget->takeItem(ui->listWidget->currentRow());
         }
 
-        if (getUrlOfFilename(filename, &uri))
+        if (engine->urlOfFile(filename, &uri))
             blackList->add(uri);
     }
 
@@ -368,10 +325,6 @@ void UIImageOverview::deleteFile(void) {
 void UIImageOverview::reloadFile(void) {
     QString filename;
     QFile f;
-    int i;
-    _IMAGE tmp;
-    bool checkOrgFilename;
-    bool checkLargeURI;
 
     filename = ui->listWidget->currentItem()->text();
     if (filename != "") {
@@ -379,28 +332,11 @@ void UIImageOverview::reloadFile(void) {
 
         if (f.exists()) {
             f.remove();
+            FolderIndex::instance().remove(filename);
 
             ui->listWidget->takeItem(ui->listWidget->currentRow());
 
-            filename = filename.right(filename.count()-filename.lastIndexOf("/")-1);
-
-            for (i=0; i<images.count(); i++) {
-                checkOrgFilename = images.at(i).originalFilename.endsWith(filename);
-                checkLargeURI = images.at(i).largeURI.endsWith(filename);
-                if ((ui->cbOriginalFilename->isChecked() && checkOrgFilename)
-                        || (!ui->cbOriginalFilename->isChecked() && checkLargeURI)) {
-                    tmp = images.at(i);
-
-                    tmp.downloaded = false;
-                    tmp.requested = false;
-
-                    images.replace(i, tmp);
-
-                    break;
-                }
-            }
-
-            download(true);
+            engine->reloadFile(filename);
         }
     }
 }
@@ -411,12 +347,8 @@ void UIImageOverview::openFile(void) {
 
     filename = ui->listWidget->currentItem()->text();
     if (filename != "") {
-        if (settings.getUseInternalViewer()) {
-            for (int i=0; i<images.length(); i++) {
-                if ((images.at(i).downloaded) && !blackList->contains(images.at(i).largeURI)) {
-                    slImageList << images.at(i).savedAs;
-                }
-            }
+        if (chandl::settingsSnapshot()->useInternalViewer) {
+            slImageList = engine->savedFiles();
             //imageViewer->setImageList(slImageList);
             //imageViewer->setCurrentImage(ui->listWidget->currentItem()->text());
 
@@ -429,47 +361,58 @@ void UIImageOverview::openFile(void) {
     }
 }
 
-void UIImageOverview::errorHandler(QUrl url, int err) {
-    switch (err) {
-    case 202:
-    case 404:
-        if (isImage(url)) {
-            blackList->add(url.toString());
-            setCompleted(url.toString(), "");
-        }
-        else {
-            // If there are still images in the list, wait until they finished (maybe they still exist)
-            // else close immediately
-            if (isDownloadFinished()) {
-                stop();
+void UIImageOverview::messageHandler(QString m) {
+    emit errorMessage(m);
+}
 
-                setTabTitle("Thread 404'ed");
-                emit errorMessage("404 - Page not found");
-                emit closeRequest(this, 404);
-            }
-            else {
-                closeWhenFinished = true;
-            }
-        }
-        break;
+void UIImageOverview::setTabTitle(QString s) {
+    emit tabTitleChanged(this, s);
+}
 
-    case 999:
-        setTabTitle("Banned");
-        emit errorMessage("You are banned");
-        break;
+void UIImageOverview::setThreadTitle(QString s) {
+    ui->lTitle->setText(s);
+    ui->lTitle2->setText(s);
+}
 
-    default:
-        QLOG_ERROR() << "ImageOverview :: Unhandled error (" << url.toString() << "," << err << ")";
-        break;
+void UIImageOverview::followRedirect(QUrl url) {
+    ui->leURI->setText(url.toString());
+    stop();
+    start();
+}
+
+void UIImageOverview::openThreads(QList<QUrl> threadList) {
+    QStringList newTab;
+
+    newTab = getValues().split(";;");
+
+    foreach (QUrl u, threadList) {
+        newTab.replace(0, u.toString());
+        emit createTabRequest(newTab.join(";;"));
+    }
+
+    if (chandl::settingsSnapshot()->closeOverviewThreads) {
+        emit closeRequest(this, 0);
     }
 }
 
-void UIImageOverview::messageHandler(QString m) {
-    emit errorMessage(m);
+void UIImageOverview::showCachedResult() {
+    ui->cbRescan->setChecked(false);
+    setStatus("Cached");
+    ui->btnReloadThread->setEnabled(false);
 }
 
-void UIImageOverview::setTabTitle(QString s) {
-    emit tabTitleChanged(this, s);
+void UIImageOverview::threadBanned() {
+    setTabTitle("Banned");
+}
+
+void UIImageOverview::engineCloseRequest(int reason) {
+    stop();
+
+    if (reason == 404) {
+        setTabTitle("Thread 404'ed");
+    }
+
+    emit closeRequest(this, reason);
 }
 
 void UIImageOverview::setDirectory(QString d) {
@@ -477,16 +420,7 @@ void UIImageOverview::setDirectory(QString d) {
 }
 
 int UIImageOverview::getDownloadedImagesCount() {
-    int ret;
-
-    ret = 0;
-
-    for (int i=0; i<images.count(); i++) {
-        if (images.at(i).downloaded)
-            ret++;
-    }
-
-    return ret;
+    return engine->downloadedImages();
 }
 
 QString UIImageOverview::getStatus() {
@@ -547,8 +481,20 @@ void UIImageOverview::setValues(QString s) {
         ui->btnBlockThread->setChecked(true);
     }
 
-    if (list.value(5) == "1") {
-        start();
+    if (engine->isRunning()) {
+        // The thread has been downloading headless, only catch up with the UI
+        running = true;
+        lockThreadSettings();
+        rebuildThumbnails();
+        updateDownloadStatus();
+    }
+    else {
+        // Images restored from the session are not announced by the engine again
+        if (engine->downloadedImages() > 0)
+            rebuildThumbnails();
+
+        if (list.value(5) == "1")
+            start();
     }
 }
 
@@ -662,6 +608,7 @@ void UIImageOverview::openDownloadFolder() {
 
 void UIImageOverview::setBlackList(BlackList *bl) {
     blackList = bl;
+    engine->setBlackList(bl);
 }
 
 void UIImageOverview::selectShortcutIndex(int idx) {
@@ -700,91 +647,6 @@ void UIImageOverview::addShortcut() {
     }
 }
 
-void UIImageOverview::startDownload(void) {
-    QUrl u;
-
-    u = QUrl(ui->leURI->text().toLatin1());
-    // Plausibility of leURI was checked before at function start()
-
-    ui->btnReloadThread->setEnabled(true);
-
-    createSupervisedDownload(u);
-}
-
-void UIImageOverview::download(bool b) {
-    if (b) {
-        QString imgURI;
-
-        downloading = true;
-
-        while (getNextImage(&imgURI) != 0)
-                createSupervisedDownload(QUrl(imgURI));
-    } else {
-        downloading = false;
-    }
-}
-
-void UIImageOverview::stopDownload(void) {
-    _IMAGE tmp;
-
-    download(false);                // Prevent new requests
-    requestHandler->cancelAll();    // Cancel pending downloads
-
-    // Reset requested, yet not finished, downloads
-    for (int i=0; i<images.length(); i++) {
-        if ((images.at(i).downloaded==false) && (images.at(i).requested == true)) {
-            tmp = images.at(i);
-            tmp.requested = false;
-            images.replace(i, tmp);
-        }
-    }
-    follow_redirects = true;
-}
-
-void UIImageOverview::createSupervisedDownload(QUrl url) {
-    if (url.isValid()) {
-        if (!isImage(url)) {
-            QLOG_DEBUG() << __func__ << "Passing url to plugin " << url.toString();
-            url = iParser->alterUrl(url);
-            QLOG_DEBUG() << __func__ << "URL altered to " << url.toString();
-        }
-        requestHandler->request(url);
-    }
-}
-
-void UIImageOverview::removeSupervisedDownload(QUrl url) {
-    requestHandler->cancel(url);
-}
-
-bool UIImageOverview::getUrlOfFilename(QString filename, QString * url) {
-    bool ret;
-    int i;
-
-    ret = false;
-
-    for (i=0; i<images.count(); i++) {
-        if (images.at(i).savedAs == filename) {
-            *url = images.at(i).largeURI;
-            ret = true;
-            break;
-        }
-    }
-
-    return ret;
-}
-
-bool UIImageOverview::isDownloadFinished() {
-    bool ret;
-
-    ret = false;
-
-    if (getDownloadedImagesCount() == getTotalImagesCount()) {
-        ret=true;
-    }
-
-    return ret;
-}
-
 void UIImageOverview::deleteAllThumbnails() {
     QStringList fileList;
 
@@ -815,340 +677,6 @@ void UIImageOverview::deleteAllFiles() {
     emit removeFiles(files);
 }
 
-void UIImageOverview::processRequestResponse(QUrl url, QByteArray ba, bool cached) {
-    QString requestURI;
-    QList<_IMAGE>   imageList;
-    QList<QUrl>     threadList;
-    ParsingStatus   status;
-    QString         path;
-    qint64 bytesWritten;
-
-    requestURI = url.toString();
-    path = url.path();
-    QLOG_TRACE() << "UIImageOverview :: Got response for " << url.toString() << ":" << QString(ba);
-    if (!_threadBlocked) {
-        if (isImage(url)) {
-            QFile f;
-            QRegExp rx(__IMAGEFILE_REGEXP__, Qt::CaseInsensitive, QRegExp::RegExp2);
-            QStringList res;
-            int pos;
-
-            pos = 0;
-
-            pos = rx.indexIn(requestURI);
-            res = rx.capturedTexts();
-
-            if (pos != -1) {
-                f.setFileName(getSavepath()+"/"+res.at(1)+res.at(2));
-
-                if (ui->cbOriginalFilename->isChecked()) {
-                    _IMAGE tmp;
-
-                    for (int i=0; i<images.count(); i++) {
-                        if (images.at(i).largeURI.endsWith("/"+res.at(1)+res.at(2))) {
-                            tmp = images.at(i);
-
-                            f.setFileName(getSavepath()+"/"+tmp.originalFilename);
-                            break;
-                        }
-                    }
-                }
-
-                f.open(QIODevice::ReadWrite);
-                bytesWritten = f.write(ba);
-                f.close();
-
-                if (bytesWritten == ba.size()) {
-                    createThumbnail(f.fileName());
-                    setCompleted(requestURI, f.fileName());
-                }
-                else {
-                    QLOG_ERROR() << "UIImageOverview :: Couldn't save file from URI " << url.toString();
-                }
-            }
-
-        }
-        else {
-            setStatus("Parsing");
-            iParser->setURL(url);
-            status = iParser->parseHTML(ba);
-
-            if (status.hasErrors) {
-                QLOG_ERROR() << "ImageOverview :: Parser error " << iParser->getErrorCode();
-                switch (iParser->getErrorCode()) {
-                case 404:
-                    stopDownload();
-                    processCloseRequest();
-                    break;
-
-                default:
-                    break;
-                }
-            }
-            else {
-                _cachedResult = cached;
-
-                if (status.isFrontpage) {
-                    QStringList newTab;
-                    QString v;
-
-                    v = getValues();
-                    newTab = v.split(";;");
-                    threadList = iParser->getUrlList();
-
-                    foreach (QUrl u, threadList) {
-                        newTab.replace(0, u.toString());
-                        emit createTabRequest(newTab.join(";;"));
-                    }
-
-                    if (settings.getCloseOverviewThreads()) {
-                        emit closeRequest(this, 0);
-                    }
-                    else {
-                        if (status.hasTitle) {
-                            ui->lTitle->setText(HTML::decode(iParser->getThreadTitle()));
-                            ui->lTitle2->setText(HTML::decode(iParser->getThreadTitle()));
-                        }
-                    }
-                }
-                else if (status.threadFragmented && follow_redirects) {
-                    follow_redirects = false;
-                    threadList = iParser->getUrlList();
-                    QLOG_INFO() << __func__ << ":: redirect list " << threadList;
-                    foreach (QUrl u, threadList) {
-                        createSupervisedDownload(u);
-                    }
-                }
-                else if (status.hasRedirect && follow_redirects) {
-                    ui->leURI->setText(iParser->getRedirectURL().toString());
-                    QLOG_INFO() << __func__ << ":: redirecting to " << iParser->getRedirectURL().toString();
-                    stop();
-                    start();
-                }
-                else {
-                    if (status.hasImages) {
-                        imageList = iParser->getImageList();
-                        mergeImageList(imageList);
-                    }
-                    else {
-                        setStatus("idle");
-                    }
-
-                    if (status.hasTitle) {
-                        ui->lTitle->setText(HTML::decode(iParser->getThreadTitle()));
-                        ui->lTitle2->setText(HTML::decode(iParser->getThreadTitle()));
-                    }
-                }
-            }
-
-            if (cached) {
-                timer->stop();
-                ui->cbRescan->setChecked(false);
-                setStatus("Cached");
-                ui->btnReloadThread->setEnabled(false);
-            }
-        }
-    }
-}
-
-void UIImageOverview::setCompleted(QString uri, QString filename) {
-    int i;
-    _IMAGE tmp;
-
-    for (i=0; i<images.length(); i++) {
-        if (images.at(i).largeURI == uri) {
-            tmp = images.at(i);
-            tmp.downloaded = true;
-            tmp.savedAs = filename;
-
-            images.replace(i,tmp);
-
-            updateDownloadStatus();
-
-            if (isDownloadFinished()) {
-                download(false);
-            }
-
-            break;
-        }
-    }
-}
-
-bool UIImageOverview::isImage(QUrl url) {
-    bool ret;
-
-    ret = false;
-
-    if (url.toString().indexOf(QRegExp(__IMAGE_REGEXP__, Qt::CaseInsensitive)) != -1)
-        ret = true;
-
-    return ret;
-}
-
-bool UIImageOverview::getNextImage(QString* s) {
-    int i;
-    bool ret;
-    _IMAGE tmp;
-    QFile f;
-    QRegExp rx(__IMAGEFILE_REGEXP__, Qt::CaseInsensitive, QRegExp::RegExp2);
-    QStringList res;
-    int pos;
-
-    ret = false;
-
-    if (downloading) {
-        for (i=0; i<images.length(); i++) {
-            if (!images.at(i).downloaded && !images.at(i).requested) {
-                tmp = images.at(i);
-                tmp.requested = true;
-                images.replace(i,tmp);
-
-                // Check if file already exists in destination dir
-                pos = 0;
-
-                pos = rx.indexIn(tmp.largeURI);
-                res = rx.capturedTexts();
-
-                if (pos != -1) {
-                    f.setFileName(getSavepath()+res.at(0));
-                }
-
-                if (f.exists()) {
-                    tmp.downloaded = true;
-                    images.replace(i, tmp);
-
-                    createThumbnail(f.fileName());
-                    setCompleted(tmp.largeURI, f.fileName());
-                }
-                else {
-                    *s = tmp.largeURI;
-                    ret = true;
-                    break;
-                }
-            }
-        }
-    }
-
-    return ret;
-}
-
-bool UIImageOverview::selectParser(QUrl url) {
-    bool ret;
-    ParserPluginInterface* tmp;
-
-    if (url.isEmpty())
-        url = QUrl(ui->leURI->text().toLatin1());
-
-    tmp = pluginManager->getParser(url, &ret);
-    if (ret) {
-        oParser = tmp->createInstance();
-        iParser = qobject_cast<ParserPluginInterface*>(oParser);
-        iParser->setURL(url);
-    }
-
-    return ret;
-}
-
-void UIImageOverview::mergeImageList(QList<_IMAGE> list) {
-    bool imagesAdded;
-
-    imagesAdded = false;
-
-    for (int i=0; i<list.count(); i++) {
-        if(addImage(list.at(i)))
-            imagesAdded = true;
-    }
-
-    if (imagesAdded) {
-        download(true);
-    }
-    else {
-        if (isDownloadFinished()) {
-            download(false);
-        }
-    }
-
-    updateDownloadStatus();
-}
-
-bool UIImageOverview::addImage(_IMAGE img) {
-    int i,k;
-    bool alreadyInList;
-    bool fileExists;
-
-    fileExists = false;
-
-    if (blackList->contains(img.largeURI)) {
-        alreadyInList = true;
-    }
-    else {
-        alreadyInList = false;
-        k = 2;
-        for (i=0; i<images.length(); i++) {
-            if (images.at(i).largeURI == img.largeURI) {
-                alreadyInList = true;
-                break;
-            }
-
-            if (images.at(i).originalFilename == img.originalFilename) {
-                QStringList tmp;
-
-                tmp = img.originalFilename.split(QRegExp("\\(\\d+\\)"));
-                if  (tmp.count() > 1) // Already has a number in brackets in filename
-                    img.originalFilename = QString("%1(%2)%3").arg(tmp.at(0)).
-                                           arg(k++).
-                                           arg(tmp.at(1));
-                else
-                    img.originalFilename = img.originalFilename.replace("."," (1).");
-            }
-        }
-
-        if (!alreadyInList) {
-            // Check if already downloaded
-            QFile f;
-            if (ui->cbOriginalFilename->isChecked()) {
-                f.setFileName(getSavepath()+"/"+img.originalFilename);
-            }
-            else {
-                QRegExp rx(__IMAGEFILE_REGEXP__, Qt::CaseInsensitive, QRegExp::RegExp2);
-                QStringList res;
-                int pos;
-
-                pos = 0;
-
-                pos = rx.indexIn(img.largeURI);
-                res = rx.capturedTexts();
-
-                if (pos != -1) {
-                    f.setFileName(getSavepath()+"/"+res.at(1)+res.at(2));
-                }
-            }
-
-            if (f.exists()) {
-                img.downloaded = true;
-                fileExists = true;
-                img.savedAs = f.fileName();
-            }
-            else if (_cachedResult) {
-                blackList->add(img.largeURI);
-                img.savedAs = "";
-                img.downloaded = true;
-                fileExists = true;
-
-                QLOG_INFO() << __func__ << ":: Image " << img.largeURI << " from cached result does not exists. Looked in " << getSavepath();
-            }
-
-            images.append(img);
-
-            if (fileExists && img.savedAs != "") {
-                createThumbnail(f.fileName());
-            }
-        }
-    }
-
-    return (!alreadyInList && !fileExists);
-}
-
 bool UIImageOverview::checkForExistingThread(QString s) {
     bool ret;
 
@@ -1179,7 +707,7 @@ void UIImageOverview::updateDownloadStatus() {
     t = getTotalImagesCount();
 //    updateExpectedThumbnailCount();
 
-    if (!isDownloadFinished()) {
+    if (!engine->isDownloadFinished()) {
         setTabTitle(QString("%1/%2").arg(d).arg(t));
         setStatus("downloading");
         ui->progressBar->setVisible(true);
@@ -1191,7 +719,7 @@ void UIImageOverview::updateDownloadStatus() {
 
         QLOG_DEBUG() << "UIImageOverview :: updateDownloadStatus() :: item count: " << ui->listWidget->count() << "; expectedThumbnailCount " << expectedThumbnailCount;
         if (missingThumbs.count() == 0) {
-            if (_cachedResult) {
+            if (engine->isCachedResult()) {
                 setTabTitle("Cached");
                 setStatus("Cached");
             }
@@ -1220,41 +748,25 @@ void UIImageOverview::rebuildThumbnails() {
     expectedThumbnailCount = 0;
     thumbnailCount = 0;
 
-    for (int i=0; i<images.length(); i++) {
-        if (images.at(i).downloaded && !images.at(i).savedAs.isEmpty()) {
-            createThumbnail(images.at(i).savedAs);
-        }
+    foreach (QString filename, engine->savedFiles(false)) {
+        createThumbnail(filename);
     }
 }
 
 void UIImageOverview::reloadThread() {
-    _IMAGE t;
     deleteAllThumbnails();
     ui->listWidget->clear();
 
-    for (int i=0; i<images.length(); i++) {
-        if (images.at(i).downloaded) {
-            t = images.at(i);
-
-            t.downloaded = false;
-            t.requested = false;
-
-            images.replace(i,t);
-            QFile::remove(t.savedAs);
-        }
-    }
-
-    download(true);
+    engine->reloadAll();
 }
 
 QString UIImageOverview::getSavepath() {
     QString ret;
 
-    if (iParser) {
-        ret = iParser->parseSavepath(ui->leSavepath->text());
+    if (engine->isRunning()) {
+        ret = engine->savepath();
     }
     else {
-        QLOG_WARN() << "UIImageOverview :: Called getSavepath() although no parser was loaded.";
         ret = ui->leSavepath->text();
     }
 
@@ -1262,24 +774,14 @@ QString UIImageOverview::getSavepath() {
 }
 
 void UIImageOverview::updateExpectedThumbnailCount() {
-    expectedThumbnailCount=0;
-    for (int i=0; i<images.length(); i++) {
-        if (images.at(i).downloaded &&
-                images.at(i).savedAs != "") {
-            expectedThumbnailCount++;
-        }
-    }
+    expectedThumbnailCount = engine->savedFiles(false).count();
 }
 
 void UIImageOverview::showImagePreview() {
     QStringList slImageList;
 
-    if (settings.getUseInternalViewer()) {
-        for (int i=0; i<images.length(); i++) {
-            if ((images.at(i).downloaded) && !blackList->contains(images.at(i).largeURI)) {
-                slImageList << images.at(i).savedAs;
-            }
-        }
+    if (chandl::settingsSnapshot()->useInternalViewer) {
+        slImageList = engine->savedFiles();
 
         //imageViewer->setImageList(slImageList);
 
@@ -1293,17 +795,18 @@ void UIImageOverview::showImagePreview() {
 
 void UIImageOverview::blockThread(bool b) {
     _threadBlocked = b;
+    engine->setBlocked(b);
     if (_threadBlocked) {
         QLOG_INFO() << "UIImageOverview :: Blocking thread";
         running = false;
-        stopDownload();
+        engine->stopDownload();
         setStatus("Blocked");
     }
     else {
         QLOG_INFO() << "UIImageOverview :: Unblocking thread";
 
         // Make it a fresh start for this images thread
-        images.clear();
+        engine->clearImages();
         deleteAllThumbnails();
         ui->listWidget->clear();
         start();
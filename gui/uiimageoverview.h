@@ -19,10 +19,11 @@
 #include "downloadmanager.h"
 #include "foldershortcuts.h"
 #include "pluginmanager.h"
-#include "requesthandler.h"
+#include "threaddownloadengine.h"
 #include "uiimageviewer.h"
 #include "HtmlEntities.h"
 #include "appsettings.h"
+#include "settingssnapshot.h"
 
 class ThumbnailCreator;
 class MainWindow;
@@ -41,6 +42,7 @@ public:
       std::shared_ptr<PluginManager> pluginManager_,
       std::shared_ptr<FolderShortcuts> folderShortcuts_,
       std::shared_ptr<ThumbnailCreator> thumbnailCreator_,
+      ThreadDownloadEngine* engine_,
       QWidget *parent = nullptr);
 
     ~UIImageOverview();
@@ -57,15 +59,14 @@ public:
     void useOriginalFilenames(bool);
     void updateSettings(void);
     void setBlackList(BlackList* bl);
-    int getTotalImagesCount() {return images.count();}
+    int getTotalImagesCount() {return engine->totalImages();}
     int getDownloadedImagesCount();
 
 private:
     Ui::UIImageOverview *ui;
-    QTimer* timer;
+    ThreadDownloadEngine* engine;
     QTimer* thumbnailCheckTimer;
     QList<int> timeoutValues;
-    QList<_IMAGE> images;
     QSize iconSize;
     QAction* deleteFileAction;
     QAction* reloadFileAction;
@@ -76,21 +77,13 @@ private:
 
     BlackList* blackList;
     QString _status;
-    RequestHandler* requestHandler;
-    ParserPluginInterface* iParser;
-    QObject* oParser;
-    QThread* parserThread;
 
     bool thumbnailsizeLocked;
     bool running;
-    bool closeWhenFinished;
-    bool downloading;
     int expectedThumbnailCount;
     int thumbnailCount;
-    bool _cachedResult;
     bool _threadBlocked;
     bool fresh_thread;
-    bool follow_redirects;
     int thumbnailCountLastViewed;
 
     std::shared_ptr<DownloadManager> downloadManager;
@@ -99,31 +92,25 @@ private:
     std::shared_ptr<ThumbnailCreator> thumbnailCreator;
 
     void loadSettings(void);
-    void setStatus(QString s);
-    void createSupervisedDownload(QUrl);
-    void removeSupervisedDownload(QUrl);
-    bool getUrlOfFilename(QString filename, QString * url);
-    bool isDownloadFinished();
     void deleteAllThumbnails();
-    bool getNextImage(QString* s);
-    bool selectParser(QUrl url=QUrl());
-    void mergeImageList(QList<_IMAGE> list);
-    bool addImage(_IMAGE img);
     QString getSavepath();
     void updateExpectedThumbnailCount();
+    void lockThreadSettings();
 
 private slots:
     void on_listWidget_customContextMenuRequested(QPoint pos);
     void chooseLocation(void);
-    void triggerRescan(void);
     void createThumbnail(QString);
     void deleteFile(void);
     void deleteAllFiles(void);
     void reloadFile(void);
     void openFile(void);
-    void errorHandler(QUrl, int);
     void messageHandler(QString);
-    void setTabTitle(QString);
+    void followRedirect(QUrl);
+    void openThreads(QList<QUrl>);
+    void showCachedResult();
+    void threadBanned();
+    void engineCloseRequest(int);
     void debugButton(void);
     void processCloseRequest();
     void openURI();
@@ -136,12 +123,6 @@ private slots:
     void rebuildThumbnails();
     void reloadThread();
 
-    void startDownload(void);
-    void stopDownload(void);
-    void download(bool b);
-    void processRequestResponse(QUrl url, QByteArray ba, bool cached);
-    void setCompleted(QString uri, QString filename);
-    bool isImage(QUrl);
     void updateDownloadStatus();
     void showImagePreview();
     void blockThread(bool);
@@ -149,6 +130,9 @@ private slots:
     void checkForMissingThumbnails();
 
 public slots:
+    void setStatus(QString s);
+    void setTabTitle(QString);
+    void setThreadTitle(QString);
     void addThumbnail(QString, QString);
     void addThumbnails(QString);
     void start(void);
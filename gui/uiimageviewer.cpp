@@ -1,5 +1,6 @@
 #include "uiimageviewer.h"
 #include "ui_uiimageviewer.h"
+#include "frameextractor.h"
 
 UIImageViewer::UIImageViewer(QWidget *parent) :
     QMainWindow(parent),
@@ -10,6 +11,7 @@ UIImageViewer::UIImageViewer(QWidget *parent) :
     imagesToDisplay.clear();
     currentImage = -1;
     rotation = 0;
+    scaledDown = false;
     runSlideshow = false;
     slideshowTimer = new QTimer(this);
     slideshowTimer->setSingleShot(false);
@@ -17,10 +19,16 @@ UIImageViewer::UIImageViewer(QWidget *parent) :
     loadSettings();
 
     connect(slideshowTimer, SIGNAL(timeout()), this, SLOT(displayNextImage()));
+
+    decoder = new ImageDecoder();
+    connect(decoder, SIGNAL(imageDecoded(QString)), this, SLOT(imageDecoded(QString)));
+    connect(decoder, SIGNAL(decodeFailed(QString)), this, SLOT(decodeFailed(QString)));
+    decoder->start(QThread::LowPriority);
 }
 
 UIImageViewer::~UIImageViewer()
 {
+    delete decoder;
     delete ui;
 }
 
@@ -87,6 +95,8 @@ void UIImageViewer::loadImage(int i) {
             f.setFileName(filename);
             ui->statusbar->showMessage("Working...");
             if (ui->image->movie() != 0) ui->image->movie()->stop();
+            pendingImage.clear();
+            scaledDown = false;
 
             if (filename.endsWith(".gif")) {
                 // Always assume gifs are animated -> therefore use QMovie for playback
@@ -97,9 +107,14 @@ void UIImageViewer::loadImage(int i) {
                 ui->lCurrentImage->setText(QString("%1/%2").arg(currentImage+1).arg(imagesToDisplay.count()));
                 ui->lImageInfo->setText("");
             }
+            else if (filename.endsWith(".webm") && chandl::FrameExtractor::available()) {
+                // Poster frame, playback is left to the external viewer
+                requestImage(filename);
+            }
             else if (filename.endsWith(".webm")) {
                 p.load(":/icons/resources/image-missing.png");
                 originalPixmap = p;
+                originalSize = p.size();
                 transformPixmap();
                 fitImage();
                 ui->statusbar->showMessage("webm is not supported", 2000);
@@ -107,21 +122,7 @@ void UIImageViewer::loadImage(int i) {
                 ui->lImageInfo->setText(filename);
             }
             else {
-                if (p.load(filename)) {
-                    originalPixmap = p;
-                    transformPixmap();
-                    fitImage();
-                    ui->statusbar->showMessage("Loaded image " + filename, 2000);
-                    ui->lCurrentImage->setText(QString("%1/%2").arg(currentImage+1).arg(imagesToDisplay.count()));
-                    ui->lImageInfo->setText(QString("Resolution: %1x%2, Size: %3kB")
-                                            .arg(originalPixmap.width())
-                                            .arg(originalPixmap.height())
-                                            .arg(f.size()/1024)
-                                            );
-                }
-                else {
-                    QLOG_ERROR() << "ImageViewer :: Error loading image" << filename;
-                }
+                requestImage(filename);
             }
         }
 
@@ -131,6 +132,70 @@ void UIImageViewer::loadImage(int i) {
     }
 }
 
+void UIImageViewer::requestImage(QString filename) {
+    QImage image;
+    QSize size;
+
+    decoder->setTargetSize(decodeSize());
+    decoder->setWindow(imagesToDisplay, currentImage, chandl::settingsSnapshot()->viewerPrefetch);
+
+    if (decoder->lookup(filename, &image, &size)) {
+        showImage(filename, image, size);
+    }
+    else {
+        // Shown as soon as the decoder is done with it
+        pendingImage = filename;
+    }
+}
+
+void UIImageViewer::showImage(QString filename, QImage image, QSize size) {
+    QFile f(filename);
+
+    originalPixmap = QPixmap::fromImage(image);
+    originalSize = size;
+    scaledDown = (image.size() != size);
+    transformPixmap();
+    fitImage();
+    ui->statusbar->showMessage("Loaded image " + filename, 2000);
+    ui->lCurrentImage->setText(QString("%1/%2").arg(currentImage+1).arg(imagesToDisplay.count()));
+    ui->lImageInfo->setText(QString("Resolution: %1x%2, Size: %3kB")
+                            .arg(originalSize.width())
+                            .arg(originalSize.height())
+                            .arg(f.size()/1024)
+                            );
+}
+
+void UIImageViewer::imageDecoded(QString filename) {
+    QImage image;
+    QSize size;
+
+    if (!pendingImage.isEmpty() && filename == pendingImage
+            && decoder->lookup(filename, &image, &size)) {
+        pendingImage.clear();
+        showImage(filename, image, size);
+    }
+}
+
+void UIImageViewer::decodeFailed(QString filename) {
+    if (!pendingImage.isEmpty() && filename == pendingImage) {
+        pendingImage.clear();
+        QLOG_ERROR() << "ImageViewer :: Error loading image" << filename;
+    }
+}
+
+QSize UIImageViewer::decodeSize() {
+    QSize ret;
+    int side;
+
+    // A square keeps the image large enough after it has been rotated
+    if (ui->btnFitImage->isChecked()) {
+        side = qMax(ui->scrollArea->width(), ui->scrollArea->height());
+        ret = QSize(side, side);
+    }
+
+    return ret;
+}
+
 void UIImageViewer::setCurrentImage(int i) {
     if (i < imagesToDisplay.count() && i >= 0) {
         currentImage = i;
@@ -151,6 +216,14 @@ void UIImageViewer::setCurrentImage(QString filename) {
 void UIImageViewer::fitImage() {
     QPixmap p;
 
+    if (!ui->btnFitImage->isChecked() && scaledDown && pendingImage.isEmpty()
+            && currentImage != -1 && imagesToDisplay.count() > currentImage) {
+        // The image was decoded to fit the window, get it at full resolution
+        requestImage(imagesToDisplay.value(currentImage));
+        if (!pendingImage.isEmpty())
+            return;
+    }
+
     p = QPixmap(2,2);
     ui->image->setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Preferred);
     ui->image->setPixmap(p);
@@ -9,8 +9,10 @@
 #include <QSettings>
 #include <QMovie>
 #include <QTimer>
+#include <QImage>
 
 #include "appsettings.h"
+#include "imagedecoder.h"
 #include "QsLog.h"
 
 namespace Ui {
@@ -35,6 +37,10 @@ private:
     int currentImage;
     QPixmap originalPixmap;
     QPixmap transformedPixmap;
+    QSize originalSize;
+    bool scaledDown;
+    ImageDecoder* decoder;
+    QString pendingImage;
     int rotation;
     QTimer* slideshowTimer;
     bool runSlideshow;
@@ -42,6 +48,9 @@ private:
     void loadImage(int);
     void loadSettings();
     void transformPixmap();
+    void requestImage(QString filename);
+    void showImage(QString filename, QImage image, QSize size);
+    QSize decodeSize();
 
 public slots:
   void saveSettings();
@@ -55,6 +64,8 @@ private slots:
     void rotateCCW();
     void toggleSlideshow(bool);
     void setSlideshowTimeout(int);
+    void imageDecoded(QString);
+    void decodeFailed(QString);
 
 };
 
@@ -84,9 +84,15 @@ void UIInfo::updateDebugInformation() {
     QString str;
 
     str = QString("Pending requests: %1<br />" \
-                  "Running requests: %2")
+                  "Running requests: %2<br />" \
+                  "Connections opened: %3 for %4 requests (%5 HTTP/2 hosts)<br />" \
+                  "Connections in use: %6")
             .arg(downloadManager->getPendingRequests())
-            .arg(downloadManager->getRunningRequests());
+            .arg(downloadManager->getRunningRequests())
+            .arg(downloadManager->getOpenedConnections())
+            .arg(downloadManager->getServedRequests())
+            .arg(downloadManager->getHttp2Hosts())
+            .arg(downloadManager->getOpenConnections());
 
     ui->lDebugInformation->setText(str);
 }
@@ -201,4 +207,6 @@ void UIInfo::showRequests() {
 
 void UIInfo::reloadRequests() {
     uiPendingRequests->showPendingRequestList(downloadManager->getPendingRequestsMap());
+    uiPendingRequests->showMetrics(downloadManager->getMetrics());
+    uiPendingRequests->showParserMetrics(ParserMetrics::instance());
 }
@@ -27,6 +27,70 @@ void UIPendingRequests::showPendingRequestList(QMap<qint64, QString> list) {
     }
 }
 
+void UIPendingRequests::showMetrics(const DownloadMetrics& metrics) {
+    QTreeWidgetItem* parent;
+    QStringList data;
+
+    ui->twMetrics->clear();
+
+    foreach (const QString& host, metrics.hosts().keys()) {
+        const HostMetrics& h = metrics.hosts()[host];
+
+        parent = new QTreeWidgetItem(ui->twMetrics, QStringList() << host
+                                     << QString("%1 KB/s").arg(h.bytesPerSecond()/1024));
+        new QTreeWidgetItem(parent, QStringList() << "Requests" << QString::number(h.requests));
+        new QTreeWidgetItem(parent, QStringList() << "Downloaded" << QString("%1 KB").arg(h.bytes/1024));
+        new QTreeWidgetItem(parent, QStringList() << "Time to first byte"
+                            << QString("avg %1 ms, p95 %2").arg(h.ttfb.mean()).arg(h.ttfb.percentileText(95)));
+        new QTreeWidgetItem(parent, QStringList() << "Total time"
+                            << QString("avg %1 ms, p95 %2").arg(h.total.mean()).arg(h.total.percentileText(95)));
+        new QTreeWidgetItem(parent, QStringList() << "Retries / Timeouts / Errors"
+                            << QString("%1 / %2 / %3").arg(h.retries).arg(h.timeouts).arg(h.errors));
+    }
+
+    const ThroughputMetrics& t = metrics.throughput();
+
+    parent = new QTreeWidgetItem(ui->twMetrics, QStringList() << "Images"
+                                 << QString("%1/s, %2 KB/s").arg(metrics.imagesPerSecond()).arg(metrics.bytesPerSecond()/1024));
+    new QTreeWidgetItem(parent, QStringList() << "Downloaded"
+                        << QString("%1 images, %2 KB").arg(t.images).arg(t.bytes/1024));
+    new QTreeWidgetItem(parent, QStringList() << "Queued until finished"
+                        << QString("p50 %1, p99 %2").arg(t.completion.percentileText(50)).arg(t.completion.percentileText(99)));
+    new QTreeWidgetItem(parent, QStringList() << "Peak memory"
+                        << QString("%1 MB").arg(DownloadMetrics::peakRss()/1024));
+
+    for (int i=0; i<DownloadMetrics::BandCount; i++) {
+        const PriorityBandMetrics& b = metrics.band((DownloadMetrics::PriorityBand)i);
+
+        data.clear();
+        data << QString("Queue: %1").arg(DownloadMetrics::bandName((DownloadMetrics::PriorityBand)i))
+             << QString("%1 waiting").arg(b.queueDepth);
+        parent = new QTreeWidgetItem(ui->twMetrics, data);
+        new QTreeWidgetItem(parent, QStringList() << "Started" << QString::number(b.started));
+        new QTreeWidgetItem(parent, QStringList() << "Wait time"
+                            << QString("avg %1 ms, p95 %2").arg(b.wait.mean()).arg(b.wait.percentileText(95)));
+    }
+}
+
+// Appended to the download metrics, call after showMetrics()
+void UIPendingRequests::showParserMetrics(const ParserMetrics& metrics) {
+    QTreeWidgetItem* parent;
+
+    foreach (const QString& plugin, metrics.plugins().keys()) {
+        const ParserPluginMetrics& p = metrics.plugins()[plugin];
+
+        parent = new QTreeWidgetItem(ui->twMetrics, QStringList() << QString("Parser: %1").arg(plugin)
+                                     << QString("%1 pages/s, %2 KB/s").arg(p.pagesPerSecond()).arg(p.bytesPerSecond()/1024));
+        new QTreeWidgetItem(parent, QStringList() << "Pages" << QString::number(p.pages));
+        new QTreeWidgetItem(parent, QStringList() << "Parsed" << QString("%1 KB").arg(p.bytes/1024));
+        new QTreeWidgetItem(parent, QStringList() << "Parse time"
+                            << QString("avg %1 ms, p95 %2").arg(p.time.mean()).arg(p.time.percentileText(95)));
+        new QTreeWidgetItem(parent, QStringList() << "Images / Threads found"
+                            << QString("%1 / %2").arg(p.images).arg(p.urls));
+        new QTreeWidgetItem(parent, QStringList() << "Errors / Empty / Shrunk pages"
+                            << QString("%1 / %2 / %3").arg(p.errors).arg(p.emptyPages).arg(p.shrunkPages));
+    }
+}
 
 void UIPendingRequests::reload() {
     emit reloadRequested();
@@ -5,6 +5,9 @@
 #include <QMap>
 #include <QString>
 
+#include "downloadmetrics.h"
+#include "parsermetrics.h"
+
 namespace Ui {
 class UIPendingRequests;
 }
@@ -25,6 +28,8 @@ private slots:
 
 public slots:
     void showPendingRequestList(QMap<qint64, QString>);
+    void showMetrics(const DownloadMetrics&);
+    void showParserMetrics(const ParserMetrics&);
 
 signals:
     void reloadRequested();
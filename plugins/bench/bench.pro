@@ -0,0 +1,31 @@
+#-------------------------------------------------
+#
+# Parser regression and throughput bench. Loads the
+# parser plugins built next to it, runs them on the
+# recorded pages in fixtures/ and compares the output
+# to the golden files.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = parserbench
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+INCLUDEPATH += ../../gui
+
+# The plugins end up in the parent of their project directory, see parser4chan.pro
+win32:DEFINES += BENCH_PLUGIN_DIR="\\\"../..\\\""
+else:DEFINES += BENCH_PLUGIN_DIR="\\\"..\\\""
+DEFINES += BENCH_FIXTURE_DIR="\\\"$$PWD/fixtures\\\""
+
+SOURCES += main.cpp \
+    parserbench.cpp
+
+HEADERS += parserbench.h
+
+OTHER_FILES += fixtures/cases.json
@@ -0,0 +1,70 @@
+#include <QCoreApplication>
+#include <QDir>
+#include <QStringList>
+#include <QTextStream>
+
+#include "parserbench.h"
+
+/*
+ * parserbench [--plugins DIR] [--fixtures DIR] [--plugin CLASS]... [--iterations N] [--update]
+ *
+ * Checks the parser plugins against the golden files, then measures them.
+ * Exits with 1 if any output differs. --update rewrites the golden files from
+ * the current output, review the diff before committing them.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QTextStream out(stdout);
+    QString pluginDir;
+    QString fixtureDir;
+    QStringList only;
+    int iterations;
+    bool update;
+    int failed;
+
+    pluginDir = QDir(a.applicationDirPath()).filePath(BENCH_PLUGIN_DIR);
+    fixtureDir = BENCH_FIXTURE_DIR;
+    iterations = 200;
+    update = false;
+
+    for (int i=1; i<argc; i++) {
+        QString arg = QString::fromLocal8Bit(argv[i]);
+
+        if (arg == "--update") {
+            update = true;
+        }
+        else if (i+1 < argc && arg == "--plugins") {
+            pluginDir = QString::fromLocal8Bit(argv[++i]);
+        }
+        else if (i+1 < argc && arg == "--fixtures") {
+            fixtureDir = QString::fromLocal8Bit(argv[++i]);
+        }
+        else if (i+1 < argc && arg == "--plugin") {
+            only << QString::fromLocal8Bit(argv[++i]);
+        }
+        else if (i+1 < argc && arg == "--iterations") {
+            iterations = QString::fromLocal8Bit(argv[++i]).toInt();
+        }
+        else {
+            out << "Unknown argument " << arg << "\n";
+            return 2;
+        }
+    }
+
+    ParserBench bench(pluginDir, fixtureDir);
+
+    if (!bench.loadCases() || !bench.loadPlugins(only))
+        return 2;
+
+    failed = bench.check(update);
+    if (failed > 0) {
+        out << failed << " case(s) differ from their golden file\n";
+        return 1;
+    }
+
+    if (!update && iterations > 0)
+        bench.measure(iterations);
+
+    return 0;
+}
@@ -0,0 +1,302 @@
+#include "parserbench.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPluginLoader>
+#include <QTextStream>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static QTextStream out(stdout);
+static std::atomic<qint64> allocationCount(0);
+
+#if defined(__GLIBC__)
+// Count at the malloc level, Qt's containers do not allocate through operator new.
+// Being part of the executable, these are used by Qt and the plugins as well.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* p, size_t size);
+
+void* malloc(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* p, size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+}
+#else
+// Elsewhere only operator new can be replaced portably, so QString and friends are missing from the count
+void* operator new(std::size_t size) {
+    void* p;
+
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    p = std::malloc(size ? size : 1);
+    if (p == 0)
+        throw std::bad_alloc();
+
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+#endif
+
+ParserBench::ParserBench(QString pluginDir, QString fixtureDir) :
+    pluginDir(pluginDir),
+    fixtureDir(fixtureDir)
+{
+}
+
+ParserBench::~ParserBench() {
+    // Created by createInstance(), the loaders keep the root instances
+    qDeleteAll(parsers);
+}
+
+bool ParserBench::loadCases() {
+    QFile f(fixtureDir.filePath("cases.json"));
+    QJsonDocument doc;
+
+    if (!f.open(QIODevice::ReadOnly)) {
+        out << "Could not open " << f.fileName() << "\n";
+        return false;
+    }
+    doc = QJsonDocument::fromJson(f.readAll());
+
+    foreach (const QJsonValue& v, doc.object().value("cases").toArray()) {
+        QJsonObject o = v.toObject();
+        BenchCase c;
+        QFile page;
+
+        c.plugin = o.value("plugin").toString();
+        c.url = QUrl(o.value("url").toString());
+        c.page = o.value("page").toString();
+        c.golden = o.value("golden").toString();
+
+        page.setFileName(fixtureDir.filePath(c.page));
+        if (!page.open(QIODevice::ReadOnly)) {
+            out << "Could not open " << page.fileName() << "\n";
+            return false;
+        }
+        c.data = page.readAll();
+
+        cases.append(c);
+    }
+
+    return !cases.isEmpty();
+}
+
+/**
+ * Loads every plugin in the plugin directory that a case refers to. With
+ * only set, the cases of all other plugins are dropped.
+ */
+bool ParserBench::loadPlugins(QStringList only) {
+    QStringList wanted;
+    bool ret;
+
+    ret = true;
+    for (int i=cases.count()-1; i>=0; i--) {
+        if (!only.isEmpty() && !only.contains(cases.at(i).plugin))
+            cases.removeAt(i);
+        else if (!wanted.contains(cases.at(i).plugin))
+            wanted << cases.at(i).plugin;
+    }
+
+    foreach (QString fileName, pluginDir.entryList(QDir::Files)) {
+        QPluginLoader loader(pluginDir.absoluteFilePath(fileName));
+        QString className;
+        ParserPluginInterface* interface;
+
+        className = loader.metaData().value("className").toString();
+        if (!wanted.contains(className) || parsers.contains(className))
+            continue;
+
+        interface = qobject_cast<ParserPluginInterface *>(loader.instance());
+        if (interface == 0) {
+            out << "Could not load plugin " << fileName << ": " << loader.errorString() << "\n";
+            continue;
+        }
+
+        interface->initPlugin();
+        parsers.insert(className, interface->createInstance());
+    }
+
+    foreach (QString plugin, wanted) {
+        if (!parsers.contains(plugin)) {
+            out << "Plugin " << plugin << " not found in " << pluginDir.path() << "\n";
+            ret = false;
+        }
+    }
+
+    return ret;
+}
+
+ParserPluginInterface* ParserBench::parser(QString plugin) {
+    return qobject_cast<ParserPluginInterface *>(parsers.value(plugin));
+}
+
+// Everything a parser reports about a page, in the format of the golden files
+QString ParserBench::render(ParserPluginInterface* parser, ParsingStatus status) {
+    QString ret;
+    QString title;
+    QUrl redirect;
+
+    ret = "status:";
+    if (status.hasImages)           ret += " images";
+    if (status.hasTitle)            ret += " title";
+    if (status.isFrontpage)         ret += " frontpage";
+    if (status.hasErrors)           ret += " errors";
+    if (status.hasRedirect)         ret += " redirect";
+    if (status.threadFragmented)    ret += " fragmented";
+    ret += "\n";
+
+    ret += QString("error: %1\n").arg(parser->getErrorCode());
+
+    title = parser->getThreadTitle();
+    ret += title.isEmpty() ? QString("title:\n") : QString("title: %1\n").arg(title);
+
+    redirect = parser->getRedirectURL();
+    if (!redirect.isEmpty())
+        ret += QString("redirect: %1\n").arg(redirect.toString());
+
+    foreach (const _IMAGE& img, parser->getImageList())
+        ret += QString("image: %1 %2\n").arg(img.largeURI).arg(img.originalFilename);
+
+    foreach (const QUrl& u, parser->getUrlList())
+        ret += QString("url: %1\n").arg(u.toString());
+
+    return ret;
+}
+
+/**
+ * Parses every case once, in order, and compares the output with its golden
+ * file. With update set, the golden files are rewritten instead. Returns the
+ * number of mismatches.
+ */
+int ParserBench::check(bool update) {
+    int ret;
+
+    ret = 0;
+    foreach (const BenchCase& c, cases) {
+        ParserPluginInterface* p;
+        ParsingStatus status;
+        QString result;
+        QString expected;
+        QFile golden(fixtureDir.filePath(c.golden));
+
+        p = parser(c.plugin);
+        p->setURL(c.url);
+        status = p->parseHTML(QString::fromUtf8(c.data));
+        result = render(p, status);
+
+        if (update) {
+            if (golden.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                golden.write(result.toUtf8());
+                out << "updated " << c.golden << "\n";
+            }
+            else {
+                out << "Could not write " << golden.fileName() << "\n";
+                ret++;
+            }
+        }
+        else {
+            if (golden.open(QIODevice::ReadOnly))
+                expected = QString::fromUtf8(golden.readAll()).replace("\r\n", "\n");
+
+            if (result == expected) {
+                out << "ok      " << c.page << "\n";
+            }
+            else {
+                out << "FAILED  " << c.page << "\n";
+                out << "--- expected (" << c.golden << ")\n" << expected;
+                out << "--- got\n" << result;
+                ret++;
+            }
+        }
+    }
+    out.flush();
+
+    return ret;
+}
+
+/**
+ * Parses the cases of each plugin iterations times and prints pages/s, MB/s
+ * and heap allocations per page. The image and url lists are fetched as well,
+ * as the ThreadDownloadEngine does after every page.
+ */
+void ParserBench::measure(int iterations) {
+    QElapsedTimer timer;
+
+    out << QString("%1 %2 %3 %4 %5\n")
+           .arg("plugin", -24)
+           .arg("pages", 8)
+           .arg("pages/s", 10)
+           .arg("MB/s", 9)
+           .arg("allocs/page", 12);
+
+    foreach (QString plugin, parsers.keys()) {
+        ParserPluginInterface* p;
+        BenchResult r;
+        qint64 allocations;
+
+        p = parser(plugin);
+        allocations = allocationCount.load();
+        timer.start();
+
+        for (int i=0; i<iterations; i++) {
+            foreach (const BenchCase& c, cases) {
+                if (c.plugin != plugin)
+                    continue;
+
+                p->setURL(c.url);
+                p->parseHTML(QString::fromUtf8(c.data));
+                p->getImageList();
+                p->getUrlList();
+
+                r.pages++;
+                r.bytes += c.data.size();
+            }
+        }
+
+        r.ns = timer.nsecsElapsed();
+        r.allocations = allocationCount.load() - allocations;
+
+        out << QString("%1 %2 %3 %4 %5\n")
+               .arg(plugin, -24)
+               .arg(r.pages, 8)
+               .arg(r.ns > 0 ? r.pages * 1000000000.0 / r.ns : 0.0, 10, 'f', 0)
+               .arg(r.ns > 0 ? r.bytes * 1000.0 / r.ns : 0.0, 9, 'f', 2)
+               .arg(r.pages > 0 ? (double)r.allocations / r.pages : 0.0, 12, 'f', 1);
+    }
+    out.flush();
+}
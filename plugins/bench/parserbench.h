@@ -0,0 +1,64 @@
+#ifndef PARSERBENCH_H
+#define PARSERBENCH_H
+
+#include <QDir>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+
+#include "ParserPluginInterface.h"
+
+// One recorded page, parsed by plugin (its class name) as if it was fetched from url
+struct BenchCase
+{
+    QString plugin;
+    QUrl url;
+    QString page;       // file names relative to the fixture directory
+    QString golden;
+    QByteArray data;
+};
+
+struct BenchResult
+{
+    int pages = 0;
+    qint64 bytes = 0;
+    qint64 ns = 0;
+    qint64 allocations = 0;
+};
+
+/**
+ * Runs the parser plugins on recorded pages. check() compares their output
+ * with the golden files, measure() reports pages/s, MB/s and heap
+ * allocations per page for each plugin.
+ *
+ * Each plugin gets a single instance from createInstance() that parses all
+ * of its cases in the order of cases.json, the way the PluginManager reuses
+ * pooled instances. A case that depends on state left over from the previous
+ * one therefore fails here as well.
+ */
+class ParserBench
+{
+public:
+    ParserBench(QString pluginDir, QString fixtureDir);
+    ~ParserBench();
+
+    bool loadCases();
+    bool loadPlugins(QStringList only);
+    int check(bool update);
+    void measure(int iterations);
+
+    static QString render(ParserPluginInterface* parser, ParsingStatus status);
+
+private:
+    QDir pluginDir;
+    QDir fixtureDir;
+    QList<BenchCase> cases;
+    QMap<QString, QObject*> parsers;
+
+    ParserPluginInterface* parser(QString plugin);
+};
+
+#endif // PARSERBENCH_H
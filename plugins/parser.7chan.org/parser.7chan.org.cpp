@@ -54,6 +54,8 @@ ParsingStatus Parser7ChanOrg::parseHTML(QString html) {
     _statusCode.hasTitle = false;
     _statusCode.isFrontpage = false;
     _statusCode.hasRedirect = false;
+    _statusCode.threadFragmented = false;
+    _errorCode = 0;
 
     pos = 0;
     i.downloaded = false;
@@ -176,6 +178,10 @@ QList<QUrl> Parser7ChanOrg::getUrlList() {
 }
 
 void Parser7ChanOrg::setURL(QUrl url) {
+    // Instances are pooled by the PluginManager and reused for other threads
+    if (url != _url)
+        _threadTitle.clear();
+
     _url = url;
 
     boardName = _url.path().section("/",2,2);
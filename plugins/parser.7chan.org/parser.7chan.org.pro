@@ -11,8 +11,11 @@ else:TARGET = ../parser.7chan.org
 TEMPLATE = lib
 CONFIG += dll plugin
 
+# The manifest is read without loading the plugin, keep its version in sync
 DEFINES += _LIB_VERSION="\\\"0.4\\\""
 
 SOURCES += parser.7chan.org.cpp
 
 HEADERS += parser.7chan.org.h
+
+OTHER_FILES += Parser7chanOrg.json
@@ -51,6 +51,9 @@ ParsingStatus ParserArchiveFoolzUs::parseHTML(QString html) {
     _statusCode.hasImages = false;
     _statusCode.hasTitle = false;
     _statusCode.isFrontpage = false;
+    _statusCode.hasRedirect = false;
+    _statusCode.threadFragmented = false;
+    _errorCode = 0;
 
     pos = 0;
     i.downloaded = false;
@@ -137,6 +140,10 @@ QList<QUrl> ParserArchiveFoolzUs::getUrlList() {
 }
 
 void ParserArchiveFoolzUs::setURL(QUrl url) {
+    // Instances are pooled by the PluginManager and reused for other threads
+    if (url != _url)
+        _threadTitle.clear();
+
     _url = url;
 
     boardName = _url.path().section("/",2,2);
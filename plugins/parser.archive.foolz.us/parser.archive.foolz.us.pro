@@ -11,8 +11,11 @@ else:TARGET = ../parser.archive.foolz.us
 TEMPLATE = lib
 CONFIG += dll plugin
 
+# The manifest is read without loading the plugin, keep its version in sync
 DEFINES += _LIB_VERSION="\\\"0.5\\\""
 
 SOURCES += parser.archive.foolz.us.cpp
 
 HEADERS += parser.archive.foolz.us.h
+
+OTHER_FILES += ParserArchiveFoolzUs.json
@@ -50,6 +50,9 @@ ParsingStatus Parser2chan::parseHTML(QString html) {
     _statusCode.hasImages = false;
     _statusCode.hasTitle = false;
     _statusCode.isFrontpage = false;
+    _statusCode.hasRedirect = false;
+    _statusCode.threadFragmented = false;
+    _errorCode = 0;
 
     pos = 0;
     i.downloaded = false;
@@ -144,6 +147,10 @@ QList<QUrl> Parser2chan::getUrlList() {
 }
 
 void Parser2chan::setURL(QUrl url) {
+    // Instances are pooled by the PluginManager and reused for other threads
+    if (url != _url)
+        _threadTitle.clear();
+
     _url = url;
 }
 
@@ -11,8 +11,11 @@ else:TARGET = ../parser2chan
 TEMPLATE = lib
 CONFIG += dll plugin
 
+# The manifest is read without loading the plugin, keep its version in sync
 DEFINES += PARSER2CHAN_LIBRARY _LIB_VERSION="\\\"0.7\\\""
 
 SOURCES += parser2chan.cpp
 
 HEADERS += parser2chan.h
+
+OTHER_FILES += Parser2chan.json
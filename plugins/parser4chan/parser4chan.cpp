@@ -55,6 +55,9 @@ ParsingStatus Parser4chan::parseHTML(QString html) {
     _statusCode.hasImages = false;
     _statusCode.hasTitle = false;
     _statusCode.isFrontpage = false;
+    _statusCode.hasRedirect = false;
+    _statusCode.threadFragmented = false;
+    _errorCode = 0;
 
     pos = 0;
     img.downloaded = false;
@@ -291,6 +294,10 @@ void Parser4chan::setURL(QUrl url) {
 
     s_url = url.toString();
 
+    // Instances are pooled by the PluginManager and reused for other threads
+    if (QString(s_url).remove(QRegExp("\\.json$")) != _url.toString())
+        _threadTitle.clear();
+
     if (s_url.endsWith(".json")) {
         s = url.toString();
         s.replace(".json", "");
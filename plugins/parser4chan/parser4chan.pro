@@ -11,8 +11,11 @@ else:TARGET = ../parser4chan
 TEMPLATE = lib
 CONFIG += dll plugin
 
+# The manifest is read without loading the plugin, keep its version in sync
 DEFINES += FOURCHANPARSER_LIBRARY _LIB_VERSION="\\\"1.16\\\""
 
 SOURCES += parser4chan.cpp
 
 HEADERS += parser4chan.h
+
+OTHER_FILES += Parser4chan.json
@@ -56,6 +56,9 @@ ParsingStatus ParserKrautchan::parseHTML(QString html) {
   _statusCode.hasImages = false;
   _statusCode.hasTitle = false;
   _statusCode.isFrontpage = false;
+  _statusCode.hasRedirect = false;
+  _statusCode.threadFragmented = false;
+  _errorCode = 0;
 
   pos = 0;
   i.downloaded = false;
@@ -160,6 +163,10 @@ QList<QUrl> ParserKrautchan::getUrlList() {
 }
 
 void ParserKrautchan::setURL(QUrl url) {
+  // Instances are pooled by the PluginManager and reused for other threads
+  if (url != _url)
+    _threadTitle.clear();
+
   _url = url;
 
   boardName = _url.path().section("/",1,1);
@@ -11,8 +11,11 @@ else:TARGET = ../parserKrautchan
 TEMPLATE = lib
 CONFIG += dll plugin
 
+# The manifest is read without loading the plugin, keep its version in sync
 DEFINES += KRAUTCHANPARSER_LIBRARY _LIB_VERSION="\\\"0.13\\\""
 
 SOURCES += parserKrautchan.cpp
 
 HEADERS += parserKrautchan.h
+
+OTHER_FILES += parserKrautchan.json
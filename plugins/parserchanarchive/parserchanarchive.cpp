@@ -68,6 +68,9 @@ ParsingStatus ParserChanArchive::parseHTML(QString html) {
     _statusCode.hasImages = false;
     _statusCode.hasTitle = false;
     _statusCode.isFrontpage = false;
+    _statusCode.hasRedirect = false;
+    _statusCode.threadFragmented = false;
+    _errorCode = 0;
 
     pos = 0;
     i.downloaded = false;
@@ -162,6 +165,10 @@ QList<QUrl> ParserChanArchive::getUrlList() {
 }
 
 void ParserChanArchive::setURL(QUrl url) {
+    // Instances are pooled by the PluginManager and reused for other threads
+    if (url != _url)
+        _threadTitle.clear();
+
     _url = url;
 
     boardName = _url.path().section("/",2,2);
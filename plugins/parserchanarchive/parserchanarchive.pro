@@ -11,8 +11,11 @@ else:TARGET = ../parserchanarchive
 TEMPLATE = lib
 CONFIG += dll plugin
 
+# The manifest is read without loading the plugin, keep its version in sync
 DEFINES += _LIB_VERSION="\\\"0.6\\\""
 
 SOURCES += parserchanarchive.cpp
 
 HEADERS += parserchanarchive.h
+
+OTHER_FILES += ParserChanArchive.json
@@ -5,4 +5,8 @@ SUBDIRS       = \
 				parserchanarchive \
 				parser.archive.foolz.us \
 				parserKrautchan \
-				parser.7chan.org
+				parser.7chan.org \
+                bench
+
+# The bench loads the plugins at run time, it only has to be built after them
+bench.depends = parser2chan parser4chan parserchanarchive parser.archive.foolz.us parserKrautchan parser.7chan.org
@@ -5,31 +5,26 @@
 ApplicationInterface::ApplicationInterface(QObject *parent) :
     QObject(parent)
 {
-    udpSocket = new QUdpSocket(this);
+    socket = new QLocalSocket(this);
     timer = new QTimer();
     timer->setSingleShot(true);
-    timeout = new QTimer();
-    timeout->setSingleShot(true);
     _connected = false;
     _updateFinished = true;
+    closingApplication = false;
 
-    connect(udpSocket, SIGNAL(readyRead()), this, SLOT(readPendingDatagrams()));
-    connect(timer, SIGNAL(timeout()), this, SLOT(timerTrigger()));
-    connect(timeout, SIGNAL(timeout()), this, SLOT(timeoutOccured()));
+    connect(socket, SIGNAL(connected()), this, SLOT(socketConnected()));
+    connect(socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
+    connect(socket, SIGNAL(error(QLocalSocket::LocalSocketError)), this, SLOT(socketError(QLocalSocket::LocalSocketError)));
+    connect(socket, SIGNAL(readyRead()), this, SLOT(readCommands()));
+    connect(timer, SIGNAL(timeout()), this, SLOT(connectToApplication()));
 
-    if (!(udpSocket->bind(QHostAddress(HOST_ADDRESS), settings->value("updater/updater_port", 60000).toInt())))
-        p(QString("Could not bind to %1:%2").arg(HOST_ADDRESS).arg(settings->value("updater/updater_port", 60000).toInt()));
-    else {
-        p(QString("Listening on %1:%2").arg(HOST_ADDRESS).arg(settings->value("updater/updater_port", 60000).toInt()));
-
-        timer->start(1000);
-    }
+    // First attempt once the event loop runs and the updater has connected its slots
+    timer->start(0);
 }
 
-void ApplicationInterface::timerTrigger(void) {
-    udpSocket->writeDatagram(createCommand(PING), QHostAddress(HOST_ADDRESS), settings->value("updater/application_port", 60001).toInt());
-    pinging = true;
-    timeout->start(TIMEOUT_VALUE);
+void ApplicationInterface::connectToApplication(void) {
+    if (socket->state() == QLocalSocket::UnconnectedState)
+        socket->connectToServer(ipcServerName());
 }
 
 void ApplicationInterface::p(QString msg) {
@@ -39,31 +34,64 @@ void ApplicationInterface::p(QString msg) {
     foutput->flush();
 }
 
-void ApplicationInterface::timeoutOccured() {
+void ApplicationInterface::socketConnected() {
+    p(QString("Connected to %1").arg(ipcServerName()));
+    _connected = true;
+    buffer.clear();
+
+    sendFailedFiles();
+
+    if (_updateFinished) {
+        writeCommand(UPDATE_FINISHED);
+    }
+
+    emit applicationClosed(false);
+}
+
+void ApplicationInterface::socketDisconnected() {
     if (_connected) p("Not connected");
 
     _connected = false;
 
-    timer->start(PING_INTERVAL);
+    timer->start(RECONNECT_INTERVAL);
 
     emit applicationClosed(true);
 }
 
-void ApplicationInterface::readPendingDatagrams() {
-    while (udpSocket->hasPendingDatagrams()) {
-        QByteArray datagram;
-        QHostAddress sender;
-        quint16 senderPort;
+void ApplicationInterface::socketError(QLocalSocket::LocalSocketError) {
+    // A dropped connection is handled in socketDisconnected(), this is a failed attempt
+    if (!_connected) {
+        timer->start(RECONNECT_INTERVAL);
 
-        datagram.resize(udpSocket->pendingDatagramSize());
+        emit applicationClosed(true);
+    }
+}
 
-        udpSocket->readDatagram(datagram.data(), datagram.size(),
-                                &sender, &senderPort);
+void ApplicationInterface::readCommands() {
+    QByteArray command;
 
-        processCommand(datagram);
+    buffer.append(socket->readAll());
+
+    while (takeCommand(&buffer, &command)) {
+        processCommand(command);
     }
 }
 
+void ApplicationInterface::writeCommand(int c, QByteArray a) {
+    if (socket->state() == QLocalSocket::ConnectedState) {
+        socket->write(createCommand(c, a));
+        socket->flush();
+    }
+}
+
+void ApplicationInterface::writeCommand(int c, QString s) {
+    writeCommand(c, s.toLatin1());
+}
+
+void ApplicationInterface::writeCommand(int c) {
+    writeCommand(c, QByteArray());
+}
+
 void ApplicationInterface::processCommand(QByteArray a) {
     int command;
     QByteArray payload;
@@ -76,37 +104,17 @@ void ApplicationInterface::processCommand(QByteArray a) {
 
     switch (command) {
     case PING:
-        udpSocket->writeDatagram(createCommand(PONG), QHostAddress(HOST_ADDRESS), settings->value("updater/application_port", 60001).toInt());
+        writeCommand(PONG);
         break;
 
     case PONG:
-        if (pinging) {
-            if (!_connected) {
-                p("Connected");
-                _connected = true;
-
-                sendFailedFiles();
-            }
-
-            if (_updateFinished) {
-                udpSocket->writeDatagram(createCommand(UPDATE_FINISHED), QHostAddress(HOST_ADDRESS), settings->value("updater/application_port", 60001).toInt());
-            }
-
-            pinging = false;
-            timeout->stop();
-            timer->start(PING_INTERVAL);
-
-            emit applicationClosed(false);
-        }
-        else {
-            p("Received unwanted PONG");
-        }
         break;
 
     case CLEAR:
         if (_connected) {
             fu.filename = "";
             fu.uri = "";
+            fu.sha256 = "";
             updateList.clear();
         }
         break;
@@ -116,6 +124,7 @@ void ApplicationInterface::processCommand(QByteArray a) {
             updateList.append(fu);
             fu.filename = "";
             fu.uri = "";
+            fu.sha256 = "";
         }
         break;
 
@@ -131,6 +140,12 @@ void ApplicationInterface::processCommand(QByteArray a) {
         }
         break;
 
+    case SET_CHECKSUM:
+        if (_connected) {
+            fu.sha256 = QString(payload);
+        }
+        break;
+
     case SET_EXE:
         if (_connected) {
             emit executableChanged(QString(payload));
@@ -155,7 +170,7 @@ void ApplicationInterface::processCommand(QByteArray a) {
         break;
 
     case GET_VERSION:
-        udpSocket->writeDatagram(createCommand(VERSION, QString(PROGRAM_VERSION)), QHostAddress(HOST_ADDRESS), settings->value("updater/application_port", 60001).toInt());
+        writeCommand(VERSION, QString(PROGRAM_VERSION));
         break;
 
     case STOP:
@@ -165,7 +180,7 @@ void ApplicationInterface::processCommand(QByteArray a) {
 }
 
 void ApplicationInterface::sendCloseRequest() {
-    udpSocket->writeDatagram(createCommand(CLOSE_REQUEST), QHostAddress(HOST_ADDRESS), settings->value("updater/application_port", 60001).toInt());
+    writeCommand(CLOSE_REQUEST);
 
     closingApplication = true;
 
@@ -173,11 +188,11 @@ void ApplicationInterface::sendCloseRequest() {
 }
 
 void ApplicationInterface::sendMessage(QString s) {
-    udpSocket->writeDatagram(createCommand(DISPLAY_MSG, s), QHostAddress(HOST_ADDRESS), settings->value("updater/application_port", 60001).toInt());
+    writeCommand(DISPLAY_MSG, s);
 }
 
 void ApplicationInterface::sendError(QString s) {
-    udpSocket->writeDatagram(createCommand(ERROR_CMD, s), QHostAddress(HOST_ADDRESS), settings->value("updater/application_port", 60001).toInt());
+    writeCommand(ERROR_CMD, s);
 }
 
 void ApplicationInterface::setFailedFiles(QList<FileUpdate> l) {
@@ -191,12 +206,12 @@ void ApplicationInterface::setFailedFiles(QList<FileUpdate> l) {
 
 void ApplicationInterface::sendFailedFiles() {
     if (_connected && (failedFiles.count() > 0)) {
-        udpSocket->writeDatagram(createCommand(CLEAR), QHostAddress(HOST_ADDRESS), settings->value("updater/application_port", 60001).toInt());
+        writeCommand(CLEAR);
 
         for (int i=0; i<failedFiles.count(); i++) {
-            udpSocket->writeDatagram(createCommand(SET_URI, failedFiles.at(i).tmpFilename), QHostAddress(HOST_ADDRESS), settings->value("updater/application_port", 60001).toInt());
-            udpSocket->writeDatagram(createCommand(SET_TARGET, failedFiles.at(i).filename), QHostAddress(HOST_ADDRESS), settings->value("updater/application_port", 60001).toInt());
-            udpSocket->writeDatagram(createCommand(ADD_SET), QHostAddress(HOST_ADDRESS), settings->value("updater/application_port", 60001).toInt());
+            writeCommand(SET_URI, failedFiles.at(i).tmpFilename);
+            writeCommand(SET_TARGET, failedFiles.at(i).filename);
+            writeCommand(ADD_SET);
         }
         failedFiles.clear();
 
@@ -206,4 +221,7 @@ void ApplicationInterface::sendFailedFiles() {
 
 void ApplicationInterface::setUpdateFinished(bool b) {
     _updateFinished = b;
+
+    if (_connected && _updateFinished)
+        writeCommand(UPDATE_FINISHED);
 }
@@ -2,19 +2,17 @@
 #define APPLICATIONINTERFACE_H
 
 #include <QObject>
-#include <QtNetwork/QUdpSocket>
+#include <QtNetwork/QLocalSocket>
 #include <iostream>
 #include <QTimer>
-#include <QSettings>
+#include <QTextStream>
 #include "commands.h"
 #include "types.h"
 
-#define TIMEOUT_VALUE   1000       // 1s
-#define PING_INTERVAL   500        // 500ms
+#define RECONNECT_INTERVAL  500        // 500ms, only while the application is not running
 
 extern QTextStream* output;
 extern QTextStream* foutput;
-extern QSettings*   settings;
 
 class ApplicationInterface : public QObject
 {
@@ -25,11 +23,10 @@ public:
     void setFailedFiles(QList<FileUpdate> l);
     void setUpdateFinished(bool b);
 private:
-    QUdpSocket* udpSocket;
+    QLocalSocket* socket;
     QTimer* timer;
-    QTimer* timeout;
+    QByteArray buffer;
     bool _connected;
-    bool pinging;
     bool closingApplication;
     bool _updateFinished;
     FileUpdate fu;
@@ -38,13 +35,18 @@ private:
 
     void p(QString);
     void sendFailedFiles();
+    void writeCommand(int c, QByteArray a);
+    void writeCommand(int c, QString s);
+    void writeCommand(int c);
 signals:
 
 private slots:
-    void readPendingDatagrams(void);
+    void readCommands(void);
     void processCommand(QByteArray);
-    void timerTrigger(void);
-    void timeoutOccured();
+    void connectToApplication(void);
+    void socketConnected();
+    void socketDisconnected();
+    void socketError(QLocalSocket::LocalSocketError);
 
 public slots:
     void sendMessage(QString);
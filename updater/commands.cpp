@@ -1,9 +1,19 @@
 #include "commands.h"
 
+#include <QRegExp>
+
+/*
+  A frame is the big endian length of what follows, the command byte and
+  the payload. The stream sockets may deliver frames split or batched.
+*/
 QByteArray createCommand(int c, QByteArray a) {
     QByteArray ba;
+    quint32 length;
+
+    length = qToBigEndian<quint32>(a.size() + 1);
 
-    ba[0] = c;
+    ba.append((const char*)&length, sizeof(length));
+    ba.append((char)c);
     ba.append(a);
 
     return ba;
@@ -17,3 +27,41 @@ QByteArray createCommand(int c) {
     return createCommand(c, QByteArray());
 }
 
+// Removes the first complete frame from buffer and returns its command byte and payload
+bool takeCommand(QByteArray* buffer, QByteArray* command) {
+    quint32 length;
+    bool ret;
+
+    ret = false;
+
+    if (buffer->size() >= (int)sizeof(length)) {
+        length = qFromBigEndian<quint32>((const uchar*)buffer->constData());
+
+        if (length == 0 || length > MAX_COMMAND_SIZE) {
+            // Not our protocol, nothing after this can be trusted
+            buffer->clear();
+        }
+        else if ((quint32)buffer->size() >= sizeof(length) + length) {
+            *command = buffer->mid(sizeof(length), length);
+            buffer->remove(0, sizeof(length) + length);
+            ret = true;
+        }
+    }
+
+    return ret;
+}
+
+/*
+  Socket names are machine wide (named pipes on Windows, /tmp on Unix), so the
+  name carries the user. Every user's instance gets its own updater channel.
+*/
+QString ipcServerName() {
+    QString user;
+
+    user = QString::fromLocal8Bit(qgetenv("USER"));
+    if (user.isEmpty())
+        user = QString::fromLocal8Bit(qgetenv("USERNAME"));
+    user.replace(QRegExp("[^A-Za-z0-9_.-]"), "_");
+
+    return QString("%1-%2").arg(IPC_SERVER_NAME).arg(user);
+}
@@ -1,12 +1,13 @@
 #ifndef COMMANDS_H
 #define COMMANDS_H
 
-//#define APPLICATION_PORT    60001
-//#define UPDATER_PORT        60000
-#define HOST_ADDRESS        QHostAddress::LocalHost
+// The application listens on a local socket / named pipe with this prefix, see ipcServerName()
+#define IPC_SERVER_NAME     "fourchan-dl-updater"
+#define MAX_COMMAND_SIZE    (1024*1024)
 
 #include <QByteArray>
 #include <QString>
+#include <QtEndian>
 
 enum COMMANDS { PING=0,
                 PONG,
@@ -22,10 +23,13 @@ enum COMMANDS { PING=0,
                 ERROR_CMD,     // Indicate an error
                 UPDATE_FINISHED, //
                 GET_VERSION,
-                VERSION
+                VERSION,
+                SET_CHECKSUM    // Set expected SHA-256 of the current URI/TARGET set
               };
 
 QByteArray createCommand(int c, QByteArray a);
 QByteArray createCommand(int c, QString s);
 QByteArray createCommand(int c);
+bool takeCommand(QByteArray* buffer, QByteArray* command);
+QString ipcServerName();
 #endif // COMMANDS_H
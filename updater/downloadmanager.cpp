@@ -6,6 +6,7 @@ DownloadManager::DownloadManager(QObject *parent) :
     manager = new QNetworkAccessManager();
     cookies = new QNetworkCookieJar();
     manager->setCookieJar(cookies);
+    failed = false;
 
     connect(manager, SIGNAL(finished(QNetworkReply*)),
             this, SLOT(replyFinished(QNetworkReply*)));
@@ -14,109 +15,291 @@ DownloadManager::DownloadManager(QObject *parent) :
 
 void DownloadManager::replyFinished(QNetworkReply* r) {
     QString requestURI;
-    QString tmpFilename;
-    QUuid uuid;
-    QFile f;
-
-    if (r->bytesAvailable() < r->header(QNetworkRequest::ContentLengthHeader).toLongLong()) {
-//        p(QString("Received only partial data of %1. Reinitiating download.").arg(r->url().toString()));
+    QString mimeType;
+    QString redirectTo;
+    QByteArray data;
+    int i;
+    int status;
 
-        manager->get(QNetworkRequest(r->url()));
+    if (!activeReplies.contains(r)) {
         r->deleteLater();
+        return;
+    }
+
+    i = activeReplies.take(r);
+
+    if (!writeBody.contains(r))
+        writeBody.insert(r, acceptReply(r, i));
+
+    if (writeBody.take(r)) {
+        data = r->readAll();
+        files.value(i)->write(data);
+        hashes.value(i)->addData(data);
+    }
+
+    redirectTo = r->header(QNetworkRequest::LocationHeader).toString();
+    mimeType = r->header(QNetworkRequest::ContentTypeHeader).toString();
+    status = r->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    requestURI = r->request().url().toString();
+
+    if (redirectTo != "") {
+        FileUpdate fu;
+        int n;
+
+        n = redirects.value(i, 0) + 1;
+        redirects.insert(i, n);
+
+        if (failed) {
+            // Another file gave up already
+        }
+        else if (n > MAX_REDIRECTS) {
+            p(QString("%1: more than %2 redirects - giving up").arg(updateList.at(i).uri).arg(MAX_REDIRECTS));
+            emit error("Could not download " + updateList.at(i).uri + " (redirect loop)");
+            failed = true;
+        }
+        else {
+            fu = updateList.at(i);
+            fu.uri = redirectTo;
+            updateList.replace(i, fu);
+
+            p("Following redirect to "+redirectTo);
+            request(i);
+        }
+    }
+    else if (mimeType.startsWith("text/html")) {
+        p("Received HTML content. Don't know what to do.");
+        emit error("There is a problem downloading " + r->url().toString() + ". Exiting.");
+        cleanup(true);
+        exit(1);
+    }
+    else if (r->error() != QNetworkReply::NoError) {
+        if (status == 416) {
+            // Our partial file does not fit the one on the server anymore
+            restartFile(i);
+        }
+        retry(i, r->errorString());
+    }
+    else if (expectedSize.contains(i) && files.value(i)->size() < expectedSize.value(i)) {
+        retry(i, QString("Received only %1 of %2 bytes").arg(files.value(i)->size()).arg(expectedSize.value(i)));
     }
     else {
-        if (r->isFinished()) {
-            QString mimeType;
-            QString redirectTo;
-
-            redirectTo = r->header(QNetworkRequest::LocationHeader).toString();
-            mimeType = r->header(QNetworkRequest::ContentTypeHeader).toString();
-            requestURI = r->request().url().toString();
-
-            if (redirectTo != "") {
-                FileUpdate fu;
-                for (int i=0; i<updateList.count(); i++) {
-                    if (updateList.at(i).uri == requestURI) {
-                        fu = updateList.at(i);
-                        fu.uri = redirectTo;
-                        updateList.replace(i, fu);
-
-                        break;
-                    }
-                }
-
-                p("Following redirect to "+redirectTo);
-                initiateDownload();
-            }
-            else if (mimeType.startsWith("text/html")) {
-                p("Received HTML content. Don't know what to do.");
-                emit error("There is a problem downloading " + r->url().toString() + ". Exiting.");
-                exit(1);
-            }
-            else {
-                p("Finished download "+requestURI);
-                tmpFilename = uuid.createUuid().toString()+".file";
-
-                f.setFileName(tmpFilename);
-                f.open(QIODevice::ReadWrite);
-                f.write(r->readAll());
-                f.close();
-                p("Saved as "+tmpFilename);
-
-                for (int i=0; i<updateList.count(); i++) {
-                    if (updateList.at(i).uri == requestURI) {
-                        FileUpdate fu;
-
-                        fu = updateList.at(i);
-                        fu.tmpFilename = tmpFilename;
-
-                        updateList.replace(i, fu);
-                        break;
-                    }
-                }
-                initiateDownload();
-            }
+        finishFile(i);
+    }
+
+    r->deleteLater();
+    initiateDownload();
+}
+
+void DownloadManager::replyReadyRead() {
+    QNetworkReply* r;
+    QByteArray data;
+    int i;
+
+    r = qobject_cast<QNetworkReply*>(sender());
+
+    if (r == 0 || !activeReplies.contains(r))
+        return;
+
+    i = activeReplies.value(r);
+
+    if (!writeBody.contains(r))
+        writeBody.insert(r, acceptReply(r, i));
+
+    data = r->readAll();
+
+    if (writeBody.value(r)) {
+        if (files.value(i)->write(data) != data.size()) {
+            p("Could not write to "+files.value(i)->fileName()+" ("+files.value(i)->errorString()+")");
+            r->abort();
         }
+        else {
+            hashes.value(i)->addData(data);
+        }
+    }
+}
+
+bool DownloadManager::acceptReply(QNetworkReply* r, int i) {
+    QRegExp rx("/(\\d+)$");
+    QFile* f;
+    int status;
+    bool ret;
+
+    f = files.value(i);
+    status = r->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    ret = false;
+
+    if (r->header(QNetworkRequest::ContentTypeHeader).toString().startsWith("text/html")) {
+        ret = false;
+    }
+    else if (status == 206) {
+        // Content-Range: bytes <from>-<to>/<total>
+        if (rx.indexIn(QString(r->rawHeader("Content-Range"))) != -1)
+            expectedSize.insert(i, rx.cap(1).toLongLong());
+
+        ret = true;
+    }
+    else if (status == 200) {
+        if (f->size() > 0) {
+            p("Server ignored range request for "+updateList.at(i).uri+", starting over");
+            restartFile(i);
+        }
+
+        if (r->header(QNetworkRequest::ContentLengthHeader).isValid())
+            expectedSize.insert(i, r->header(QNetworkRequest::ContentLengthHeader).toLongLong());
+
+        ret = true;
     }
+
+    return ret;
 }
 
 void DownloadManager::startDownload(QList<FileUpdate> l) {
     updateList = l;
+    failed = false;
+    pending.clear();
+    attempts.clear();
+    redirects.clear();
+
+    for (int i=0; i<updateList.count(); i++) {
+        pending.enqueue(i);
+    }
+
     initiateDownload();
 }
 
 void DownloadManager::initiateDownload() {
+    while (!failed && !pending.isEmpty() && activeReplies.count() < MAX_PARALLEL_DOWNLOADS) {
+        request(pending.dequeue());
+    }
+
+    if (activeReplies.isEmpty()) {
+        if (failed) {
+            // Never hand incomplete or unverified files to the exchange
+            cleanup(true);
+            p("Update aborted, no files have been changed");
+            emit error("The update could not be downloaded completely. No files have been changed.");
+            exit(1);
+        }
+        else if (pending.isEmpty()) {
+            cleanup(false);
+            emit downloadsFinished(updateList);
+        }
+    }
+}
+
+void DownloadManager::request(int i) {
+    QNetworkRequest req;
     QNetworkReply* nr;
     QString uri;
-    bool downloadsAvailable;
+    QFile* f;
+    QUuid uuid;
 
-    downloadsAvailable = false;
+    uri = updateList.at(i).uri;
+    f = files.value(i, 0);
 
-    for (int i=0; i<updateList.count(); i++) {
-        if (updateList.at(i).tmpFilename == "") {
-            uri = updateList.at(i).uri;
-            downloadsAvailable = true;
-            break;
+    if (f == 0) {
+        f = new QFile(uuid.createUuid().toString()+".file");
+
+        if (!f->open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+            p("Could not create "+f->fileName()+" ("+f->errorString()+")");
+            emit error("Could not create temporary file "+f->fileName());
+            delete f;
+            failed = true;
+            return;
         }
+
+        files.insert(i, f);
+        hashes.insert(i, new QCryptographicHash(QCryptographicHash::Sha256));
     }
 
-    if (downloadsAvailable) {
-        QNetworkRequest req;
+    req.setUrl(QUrl(uri));
+    req.setAttribute(QNetworkRequest::CookieSaveControlAttribute, QNetworkRequest::Automatic);
+    req.setRawHeader("User-Agent", "Wget/1.12");
 
-        req.setUrl(QUrl(uri));
-        req.setAttribute(QNetworkRequest::CookieSaveControlAttribute, QNetworkRequest::Automatic);
-        req.setRawHeader("User-Agent", "Wget/1.12");
-        nr = manager->get(req);
+    if (f->size() > 0) {
+        // Continue where the last attempt stopped
+        req.setRawHeader("Range", QString("bytes=%1-").arg(f->size()).toLatin1());
+        p(QString("Resuming %1 at %2 bytes").arg(uri).arg(f->size()));
+    }
+    else {
+        p("Downloading "+uri);
+    }
 
-        connect(nr,SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(replyError(QNetworkReply::NetworkError)));
+    nr = manager->get(req);
+    activeReplies.insert(nr, i);
 
-        p("Downloading "+uri);
+    connect(nr, SIGNAL(readyRead()), this, SLOT(replyReadyRead()));
+    connect(nr, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(replyError(QNetworkReply::NetworkError)));
+}
+
+void DownloadManager::restartFile(int i) {
+    QFile* f;
+
+    f = files.value(i);
+    f->resize(0);
+    f->seek(0);
+    hashes.value(i)->reset();
+    expectedSize.remove(i);
+}
+
+void DownloadManager::retry(int i, QString reason) {
+    int n;
+
+    n = attempts.value(i, 0) + 1;
+    attempts.insert(i, n);
+
+    if (failed) {
+        return;
+    }
+    else if (n < MAX_DOWNLOAD_ATTEMPTS) {
+        p(QString("%1: %2 - retrying (%3/%4)").arg(updateList.at(i).uri).arg(reason).arg(n).arg(MAX_DOWNLOAD_ATTEMPTS-1));
+        request(i);
     }
     else {
-        emit downloadsFinished(updateList);
+        p(QString("%1: %2 - giving up").arg(updateList.at(i).uri).arg(reason));
+        emit error("Could not download " + updateList.at(i).uri + " (" + reason + ")");
+        failed = true;
     }
 }
 
+void DownloadManager::finishFile(int i) {
+    FileUpdate fu;
+    QByteArray checksum;
+    QFile* f;
+
+    fu = updateList.at(i);
+    f = files.value(i);
+    checksum = hashes.value(i)->result().toHex();
+
+    if (!fu.sha256.isEmpty() && checksum != fu.sha256.toLower().toLatin1()) {
+        restartFile(i);
+        retry(i, "SHA-256 mismatch");
+    }
+    else {
+        f->close();
+        fu.tmpFilename = f->fileName();
+        updateList.replace(i, fu);
+
+        p("Finished download "+fu.uri);
+        p("Saved as "+fu.tmpFilename+(fu.sha256.isEmpty() ? " (no checksum to verify)" : " (SHA-256 verified)"));
+    }
+}
+
+void DownloadManager::cleanup(bool removeFiles) {
+    foreach (QFile* f, files) {
+        if (removeFiles)
+            f->remove();
+        delete f;
+    }
+
+    qDeleteAll(hashes);
+
+    files.clear();
+    hashes.clear();
+    expectedSize.clear();
+    writeBody.clear();
+}
+
 void DownloadManager::replyError(QNetworkReply::NetworkError e) {
     p("Reply error "+QString::number(e));
 }
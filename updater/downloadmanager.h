@@ -4,8 +4,14 @@
 #include <QObject>
 #include <QtNetwork>
 #include <QRegExp>
+#include <QCryptographicHash>
+#include <QQueue>
 #include "types.h"
 
+#define MAX_PARALLEL_DOWNLOADS  4
+#define MAX_DOWNLOAD_ATTEMPTS   5
+#define MAX_REDIRECTS           10
+
 extern QTextStream* output;
 extern QTextStream* foutput;
 
@@ -24,11 +30,28 @@ private:
     QNetworkCookieJar* cookies;
     QList<FileUpdate> updateList;
 
+    QQueue<int> pending;                            // Indices into updateList not yet requested
+    QHash<QNetworkReply*, int> activeReplies;
+    QHash<QNetworkReply*, bool> writeBody;          // Whether a reply carries file content
+    QHash<int, QFile*> files;
+    QHash<int, QCryptographicHash*> hashes;
+    QHash<int, qint64> expectedSize;
+    QHash<int, int> attempts;
+    QHash<int, int> redirects;                      // Counted apart from attempts, a redirect is no failure
+    bool failed;
+
     void p(QString);
     void initiateDownload();
+    void request(int i);
+    bool acceptReply(QNetworkReply* r, int i);
+    void restartFile(int i);
+    void retry(int i, QString reason);
+    void finishFile(int i);
+    void cleanup(bool removeFiles);
 
 private slots:
     void replyFinished(QNetworkReply*);
+    void replyReadyRead();
     void replyError(QNetworkReply::NetworkError e);
 
 signals:
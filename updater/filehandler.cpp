@@ -5,66 +5,255 @@ FileHandler::FileHandler(QObject *parent) :
 {
 }
 
+/*
+  The exchange runs in two phases. First every download is verified and
+  moved into a fresh staging directory, nothing installed is touched yet.
+  Then each installed file is renamed into the staging directory and the
+  new one renamed into its place. Every rename is written to the journal
+  before it happens, so an aborted or crashed exchange can be rolled back
+  by replaying the journal backwards. Moving the journal into the staging
+  directory commits the update and keeps it around for revertLastUpdate().
+*/
 void FileHandler::startExchange(QList<FileUpdate> l) {
-    //bool filesRemaining;
     bool errors;
-    QString sourceFilename;
-    QString targetFilename;
+    bool restored;
+    QString stageDir;
+    QString stagedFilename;
+    QString backupFilename;
+    QFile journal;
+    QTextStream js;
+    QDir dir;
     FileUpdate fu;
 
     updateList = l;
+    failedFiles.clear();
     errors = false;
+    restored = true;
 
-    //filesRemaining = false;
+    stageDir = QString("%1/%2").arg(UPDATE_DIR).arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+    dir.mkpath(stageDir+"/new");
+    dir.mkpath(stageDir+"/old");
 
-    for (int i=0; i<updateList.count(); i++) {
-            sourceFilename = updateList.at(i).tmpFilename;
-            targetFilename = updateList.at(i).filename;
+    for (int i=0; i<updateList.count() && !errors; i++) {
+        fu = updateList.at(i);
+        stagedFilename = QString("%1/new/%2-%3").arg(stageDir).arg(i).arg(QFileInfo(fu.filename).fileName());
 
-        p("Exchanging "+sourceFilename+" with "+targetFilename);
+        p("Staging "+fu.tmpFilename+" as "+stagedFilename);
 
-        QFile source;
-        QFile target;
+        if (!verify(fu)) {
+            p("Checksum of "+fu.tmpFilename+" does not match");
+            error("Download of "+fu.filename+" is damaged, no files were updated");
+            errors = true;
+        }
+        else if (!QFile::rename(fu.tmpFilename, stagedFilename)) {
+            p("Could not move "+fu.tmpFilename+" to "+stagedFilename);
+            error("Could not stage "+fu.filename+", no files were updated");
+            errors = true;
+        }
+        else {
+            fu.tmpFilename = stagedFilename;
+            updateList.replace(i, fu);
+        }
+    }
 
-        source.setFileName(sourceFilename);
-        target.setFileName(targetFilename);
+    if (!errors) {
+        journal.setFileName(JOURNAL_FILE);
 
-        source.open(QIODevice::ReadWrite);
+        if (!journal.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            p("Cannot create "+journal.fileName()+" ("+journal.errorString()+")");
+            error("Cannot create "+journal.fileName()+", no files were updated");
+            errors = true;
+        }
+        js.setDevice(&journal);
 
-        if (target.exists()) {
-            if  (!target.remove()) {
-                p("Cannot remove "+targetFilename);
-                error("Cannot remove "+targetFilename+" ("+target.errorString()+")");
+        for (int i=0; i<updateList.count() && !errors; i++) {
+            fu = updateList.at(i);
+            backupFilename = QString("%1/old/%2-%3").arg(stageDir).arg(i).arg(QFileInfo(fu.filename).fileName());
 
-                fu.tmpFilename = sourceFilename;
-                fu.filename = targetFilename;
-                failedFiles.append(fu);
+            p("Exchanging "+fu.tmpFilename+" with "+fu.filename);
+
+            if (QFile::exists(fu.filename) && !move(fu.filename, backupFilename, &js)) {
+                error("Cannot replace "+fu.filename);
                 errors = true;
             }
+            else if (!move(fu.tmpFilename, fu.filename, &js)) {
+                error("Could not install "+fu.filename);
+                errors = true;
+            }
+#ifdef Q_OS_LINUX
+            else {
+                // On Linux we have to set executable rights
+                QFile::setPermissions(fu.filename, QFile::permissions(fu.filename) | QFile::ExeOther);
+            }
+#endif
         }
 
-        if (!source.rename(targetFilename)) {
-            p("Could not rename "+sourceFilename+" to "+targetFilename);
-            error("Could not rename "+sourceFilename+" to "+targetFilename+" ("+target.errorString()+")");
+        journal.close();
 
-            fu.tmpFilename = sourceFilename;
-            fu.filename = targetFilename;
-            failedFiles.append(fu);
+        if (errors) {
+            p("Rolling back exchange");
+            restored = rollback(JOURNAL_FILE);
+            if (restored)
+                QFile::remove(JOURNAL_FILE);
+        }
+        else if (!QFile::rename(JOURNAL_FILE, stageDir+"/exchange.journal")) {
+            // The exchange is complete, it just can't be reverted later
+            QFile::remove(JOURNAL_FILE);
+        }
+    }
 
-            errors = true;
+    if (errors && restored) {
+        p("Exchange failed - installed files are unchanged");
+        dir.setPath(stageDir);
+        dir.removeRecursively();
+    }
+    else if (errors) {
+        // Leave journal and backups in place, recover() retries on the next start
+        p("Exchange failed and could not be rolled back completely");
+    }
+    else {
+        pruneUpdates();
+    }
+
+    p("Updating finished - If this window doesn't close it save to close it manually.");
+    emit exchangingFinished(errors);
+}
+
+bool FileHandler::move(QString from, QString to, QTextStream* journal) {
+    QDir dir;
+    bool ret;
+
+    // Record the intent first, rollback() skips renames that never happened
+    *journal << from << "\t" << to << "\n";
+    journal->flush();
+
+    dir.mkpath(QFileInfo(to).absolutePath());
+    ret = QFile::rename(from, to);
+
+    if (!ret)
+        p("Could not rename "+from+" to "+to);
+
+    return ret;
+}
+
+bool FileHandler::rollback(QString journalFilename) {
+    QFile journal;
+    QStringList lines;
+    QStringList entry;
+    bool ret;
+
+    ret = true;
+    journal.setFileName(journalFilename);
+
+    if (journal.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        lines = QString(journal.readAll()).split("\n");
+        journal.close();
+
+        for (int i=lines.count()-1; i>=0; i--) {
+            entry = lines.at(i).split("\t");
+
+            if (entry.count() != 2)
+                continue;
+
+            if (QFile::exists(entry.at(1)) && !QFile::exists(entry.at(0))) {
+                p("Restoring "+entry.at(0));
+
+                if (!QFile::rename(entry.at(1), entry.at(0))) {
+                    p("Could not restore "+entry.at(0)+" from "+entry.at(1));
+                    ret = false;
+                }
+            }
         }
+    }
+    else {
+        // Without a journal there is nothing to undo
+        ret = !journal.exists();
+    }
 
-#ifdef Q_OS_LINUX
-        // On Linux we have to set executable rights
-        target.setPermissions(target.permissions() | QFile::ExeOther);
-#endif
+    return ret;
+}
+
+bool FileHandler::recover() {
+    bool ret;
+
+    ret = true;
 
+    if (QFile::exists(JOURNAL_FILE)) {
+        p("Found an unfinished exchange, rolling back");
+        ret = rollback(JOURNAL_FILE);
+
+        if (ret)
+            QFile::remove(JOURNAL_FILE);
+        else
+            p("Rollback incomplete, keeping "+QString(JOURNAL_FILE));
     }
 
-    if (errors) p("Rename had errors");
+    return ret;
+}
 
-    p("Updating finished - If this window doesn't close it save to close it manually.");
-    emit exchangingFinished(errors);
+bool FileHandler::revertLastUpdate() {
+    QDir dir(UPDATE_DIR);
+    QStringList updates;
+    QString stageDir;
+    bool ret;
+
+    ret = false;
+    updates = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+
+    for (int i=updates.count()-1; i>=0; i--) {
+        stageDir = QString("%1/%2").arg(UPDATE_DIR).arg(updates.at(i));
+
+        if (QFile::exists(stageDir+"/exchange.journal")) {
+            p("Reverting update "+updates.at(i));
+            ret = rollback(stageDir+"/exchange.journal");
+
+            if (ret) {
+                dir.setPath(stageDir);
+                dir.removeRecursively();
+            }
+            break;
+        }
+    }
+
+    if (!ret)
+        p("No update to revert");
+
+    return ret;
+}
+
+void FileHandler::pruneUpdates() {
+    QDir dir(UPDATE_DIR);
+    QStringList updates;
+    QDir stageDir;
+
+    updates = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+
+    for (int i=0; i<updates.count()-KEEP_UPDATES; i++) {
+        stageDir.setPath(QString("%1/%2").arg(UPDATE_DIR).arg(updates.at(i)));
+        stageDir.removeRecursively();
+    }
+}
+
+bool FileHandler::verify(FileUpdate fu) {
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    QFile f;
+    bool ret;
+
+    ret = false;
+
+    if (fu.sha256.isEmpty()) {
+        ret = true;
+    }
+    else {
+        f.setFileName(fu.tmpFilename);
+
+        if (f.open(QIODevice::ReadOnly) && hash.addData(&f)) {
+            ret = (hash.result().toHex() == fu.sha256.toLower().toLatin1());
+        }
+        f.close();
+    }
+
+    return ret;
 }
 
 void FileHandler::p(QString msg) {
@@ -3,9 +3,17 @@
 
 #include <QObject>
 #include <QFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
 #include <QTextStream>
+#include <QCryptographicHash>
 #include "types.h"
 
+#define UPDATE_DIR      "updates"                   // Holds one staging directory per update
+#define JOURNAL_FILE    "updates/exchange.journal"  // Only exists while an exchange is in progress
+#define KEEP_UPDATES    2                           // Staging directories kept for reverting
+
 extern QTextStream* output;
 extern QTextStream* foutput;
 
@@ -15,12 +23,18 @@ class FileHandler : public QObject
 public:
     explicit FileHandler(QObject *parent = 0);
     QList<FileUpdate> getFailedFiles() {return failedFiles;}
+    bool recover();
+    bool revertLastUpdate();
 
 private:
     QList<FileUpdate> updateList;
     QList<FileUpdate> failedFiles;
 
     void p(QString);
+    bool verify(FileUpdate fu);
+    bool move(QString from, QString to, QTextStream* journal);
+    bool rollback(QString journalFilename);
+    void pruneUpdates();
 
 signals:
     void exchangingFinished(bool);
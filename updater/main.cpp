@@ -3,20 +3,16 @@
 #include <QFile>
 #include <QDateTime>
 #include <QtNetwork>
-#include <QSettings>
 #include "updater.h"
 
 QTextStream* output;
 QTextStream* foutput;
-QSettings* settings;
 
 int main(int argc, char *argv[])
 {
     QCoreApplication a(argc, argv);
     output = new QTextStream(stdout);
 
-    settings = new QSettings("../settings.ini", QSettings::IniFormat);
-
     QFile f;
 
     f.setFileName("update.log");
@@ -27,6 +23,12 @@ int main(int argc, char *argv[])
     *foutput << "Started " << QDateTime::currentDateTime().toString("dd.MM.yyyy hh:mm:ss") << "\n";
     foutput->flush();
 
+    if (a.arguments().contains("--revert")) {
+        FileHandler fh;
+
+        return fh.revertLastUpdate() ? 0 : 1;
+    }
+
     Updater updater;
     updater.run();
 
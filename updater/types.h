@@ -5,6 +5,7 @@ struct FileUpdate {
     QString filename;
     QString uri;
     QString tmpFilename;
+    QString sha256;         // Expected checksum (hex), empty if the release tree has none
 };
 
 #endif // TYPES_H
@@ -13,6 +13,8 @@ Updater::Updater(QObject *parent) :
 }
 
 void Updater::run() {
+    fh->recover();
+
     connect(ai, SIGNAL(startUpdate(QList<FileUpdate>)), this, SLOT(startUpdate(QList<FileUpdate>)));
     connect(dm, SIGNAL(downloadsFinished(QList<FileUpdate>)), this, SLOT(downloadFinished(QList<FileUpdate>)));
     connect(ai, SIGNAL(applicationClosed(bool)), this, SLOT(startExchange(bool)));